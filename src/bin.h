@@ -0,0 +1,130 @@
+/*** bin.h -- binary record format of blpcli output
+ *
+ * Copyright (C) 2009-2015 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of blpcli.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if !defined INCLUDED_bin_h_
+#define INCLUDED_bin_h_
+#include <stdint.h>
+
+/**
+ * Binary output is a sequence of length-prefixed records, all integers
+ * are in host byte order, the file header's magic and version double
+ * as byte order mark.  Every record starts with a struct bin_rec_s.
+ *
+ * A stream begins with a BIN_RT_HDR record, followed by the field
+ * dictionary (BIN_RT_FLD records) and the topic dictionary (BIN_RT_TOP
+ * records).  Topic records may reappear at any time later on.
+ *
+ * Publications (BIN_RT_PUB) carry the receive time in nanoseconds since
+ * the epoch, the topic id and a presence bitmap of NFLD bits, bit I set
+ * iff field I is present.  The bitmap is followed by the values of the
+ * present fields in field order, each a one-byte BIN_VT_* tag and the
+ * value proper, unaligned. */
+#define BIN_MAGIC	"BLPB"
+#define BIN_VERSION	(1U)
+
+typedef enum {
+	BIN_RT_UNK,
+	BIN_RT_HDR = 'H',
+	BIN_RT_FLD = 'F',
+	BIN_RT_TOP = 'T',
+	BIN_RT_PUB = 'P',
+} bin_rt_t;
+
+typedef enum {
+	BIN_VT_UNK,
+	/* int64_t */
+	BIN_VT_I64,
+	/* double */
+	BIN_VT_F64,
+	/* float */
+	BIN_VT_F32,
+	/* struct bin_dt_s */
+	BIN_VT_DT,
+	/* uint16_t length, followed by that many bytes */
+	BIN_VT_STR,
+} bin_vt_t;
+
+struct bin_rec_s {
+	/* length of the whole record, this header included */
+	uint32_t len;
+	uint8_t typ;
+	uint8_t rsv[3U];
+};
+
+struct bin_hdr_s {
+	struct bin_rec_s rec;
+	char magic[4U];
+	uint16_t ver;
+	uint16_t nfld;
+};
+
+struct bin_fld_s {
+	struct bin_rec_s rec;
+	uint32_t fid;
+	/* followed by the name, not nul-terminated */
+};
+
+struct bin_top_s {
+	struct bin_rec_s rec;
+	uint32_t tid;
+	/* followed by the name, not nul-terminated */
+};
+
+struct bin_pub_s {
+	struct bin_rec_s rec;
+	uint64_t stmp;
+	uint32_t tid;
+	uint32_t nfld;
+	/* followed by (NFLD + 7) / 8 bytes of presence bitmap and values */
+};
+
+#define BIN_DT_DATE	(1U)
+#define BIN_DT_TIME	(2U)
+#define BIN_DT_FRAC	(4U)
+
+struct bin_dt_s {
+	uint16_t year;
+	uint8_t mon;
+	uint8_t mday;
+	uint8_t hour;
+	uint8_t min;
+	uint8_t sec;
+	/* BIN_DT_* bits, which of the above are meaningful */
+	uint8_t parts;
+	uint32_t nsec;
+};
+
+#endif	/* INCLUDED_bin_h_ */
@@ -0,0 +1,495 @@
+/*** blp-rd.c -- read binary blpcli output
+ *
+ * Copyright (C) 2009-2015 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of blpcli.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include "bin.h"
+#include "obuf.h"
+#include "fmt.h"
+#include "nifty.h"
+
+#include "blp-rd.yucc"
+
+/* input buffer size, no record can be larger than this */
+#define IBUF_SIZE	(1024U * 1024U)
+
+struct dict_s {
+	size_t n;
+	size_t z;
+	char **v;
+};
+
+struct ctx_s {
+	obuf_t out;
+	struct dict_s flds;
+	struct dict_s tops;
+	bool hdrp;
+	int prec;
+
+	/* receive stamp cache */
+	char stmp[32U];
+	uint64_t sec;
+};
+
+
+static __attribute__((format(printf, 1, 2))) void
+error(const char *fmt, ...)
+{
+	va_list vap;
+	va_start(vap, fmt);
+	vfprintf(stderr, fmt, vap);
+	va_end(vap);
+	if (errno) {
+		fputc(':', stderr);
+		fputc(' ', stderr);
+		fputs(strerror(errno), stderr);
+	}
+	fputc('\n', stderr);
+	return;
+}
+
+static int
+dict_put(struct dict_s *d, size_t id, const char *s, size_t z)
+{
+	char *str;
+
+	if (id >= d->z) {
+		size_t nu = d->z ? d->z : 64U;
+		char **v;
+
+		while (nu <= id) {
+			nu *= 2U;
+		}
+		if (UNLIKELY((v = realloc(d->v, nu * sizeof(*v))) == NULL)) {
+			return -1;
+		}
+		memset(v + d->z, 0, (nu - d->z) * sizeof(*v));
+		d->v = v;
+		d->z = nu;
+	}
+	if (UNLIKELY((str = strndup(s, z)) == NULL)) {
+		return -1;
+	}
+	free(d->v[id]);
+	d->v[id] = str;
+	if (id >= d->n) {
+		d->n = id + 1U;
+	}
+	return 0;
+}
+
+static void
+dict_free(struct dict_s *d)
+{
+	for (size_t i = 0U; i < d->n; i++) {
+		free(d->v[i]);
+	}
+	free(d->v);
+	memset(d, 0, sizeof(*d));
+	return;
+}
+
+
+static void
+rd_stmp(struct ctx_s *ctx, uint64_t ns)
+{
+	const uint64_t sec = ns / 1000000000U;
+	char *p = ctx->stmp;
+
+	if (sec != ctx->sec) {
+		const time_t t = sec;
+		struct tm tm;
+
+		gmtime_r(&t, &tm);
+		fmt_u32_pad(p + 0U, tm.tm_year + 1900, 4U);
+		p[4U] = '-';
+		fmt_u32_pad(p + 5U, tm.tm_mon + 1, 2U);
+		p[7U] = '-';
+		fmt_u32_pad(p + 8U, tm.tm_mday, 2U);
+		p[10U] = 'T';
+		fmt_u32_pad(p + 11U, tm.tm_hour, 2U);
+		p[13U] = ':';
+		fmt_u32_pad(p + 14U, tm.tm_min, 2U);
+		p[16U] = ':';
+		fmt_u32_pad(p + 17U, tm.tm_sec, 2U);
+		p[19U] = '.';
+		p[29U] = 'Z';
+		ctx->sec = sec;
+	}
+	fmt_u32_pad(p + 20U, ns % 1000000000U, 9U);
+	obuf_write(ctx->out, p, 30U);
+	return;
+}
+
+static void
+rd_dt(obuf_t out, const struct bin_dt_s *dt)
+{
+	char *p = obuf_prep(out, 32U);
+	size_t n = 0U;
+
+	if (dt->parts & BIN_DT_DATE) {
+		n += fmt_u32_pad(p + n, dt->year, 4U);
+		p[n++] = '-';
+		n += fmt_u32_pad(p + n, dt->mon, 2U);
+		p[n++] = '-';
+		n += fmt_u32_pad(p + n, dt->mday, 2U);
+		if (dt->parts & BIN_DT_TIME) {
+			p[n++] = 'T';
+		}
+	}
+	if (dt->parts & BIN_DT_TIME) {
+		n += fmt_u32_pad(p + n, dt->hour, 2U);
+		p[n++] = ':';
+		n += fmt_u32_pad(p + n, dt->min, 2U);
+		p[n++] = ':';
+		n += fmt_u32_pad(p + n, dt->sec, 2U);
+		if (dt->parts & BIN_DT_FRAC) {
+			p[n++] = '.';
+			n += fmt_u32_pad(p + n, dt->nsec, 9U);
+		}
+	}
+	obuf_adv(out, n);
+	return;
+}
+
+static const char*
+rd_val(struct ctx_s *ctx, const char *vp, const char *ep)
+{
+/* print value at VP, return pointer past it or NULL if malformed */
+	obuf_t out = ctx->out;
+	uint8_t vt;
+	char *p;
+
+	if (UNLIKELY(vp >= ep)) {
+		return NULL;
+	}
+	switch ((vt = *vp++)) {
+		union {
+			int64_t i64;
+			double f64;
+			float f32;
+			struct bin_dt_s dt;
+			uint16_t z;
+		} tmp;
+
+	case BIN_VT_I64:
+		if (UNLIKELY(vp + sizeof(tmp.i64) > ep)) {
+			return NULL;
+		}
+		memcpy(&tmp.i64, vp, sizeof(tmp.i64));
+		vp += sizeof(tmp.i64);
+		p = obuf_prep(out, FMT_INT_MAXLEN);
+		obuf_adv(out, fmt_i64(p, tmp.i64));
+		break;
+	case BIN_VT_F64:
+		if (UNLIKELY(vp + sizeof(tmp.f64) > ep)) {
+			return NULL;
+		}
+		memcpy(&tmp.f64, vp, sizeof(tmp.f64));
+		vp += sizeof(tmp.f64);
+		p = obuf_prep(out, FMT_FLT_MAXLEN);
+		if (ctx->prec < 0) {
+			obuf_adv(out, fmt_f64(p, tmp.f64));
+		} else {
+			obuf_adv(out, fmt_f64_fixed(p, tmp.f64, ctx->prec));
+		}
+		break;
+	case BIN_VT_F32:
+		if (UNLIKELY(vp + sizeof(tmp.f32) > ep)) {
+			return NULL;
+		}
+		memcpy(&tmp.f32, vp, sizeof(tmp.f32));
+		vp += sizeof(tmp.f32);
+		p = obuf_prep(out, FMT_FLT_MAXLEN);
+		if (ctx->prec < 0) {
+			obuf_adv(out, fmt_f32(p, tmp.f32));
+		} else {
+			obuf_adv(out, fmt_f64_fixed(p, tmp.f32, ctx->prec));
+		}
+		break;
+	case BIN_VT_DT:
+		if (UNLIKELY(vp + sizeof(tmp.dt) > ep)) {
+			return NULL;
+		}
+		memcpy(&tmp.dt, vp, sizeof(tmp.dt));
+		vp += sizeof(tmp.dt);
+		rd_dt(out, &tmp.dt);
+		break;
+	case BIN_VT_STR:
+		if (UNLIKELY(vp + sizeof(tmp.z) > ep)) {
+			return NULL;
+		}
+		memcpy(&tmp.z, vp, sizeof(tmp.z));
+		vp += sizeof(tmp.z);
+		if (UNLIKELY(vp + tmp.z > ep)) {
+			return NULL;
+		}
+		obuf_write(out, vp, tmp.z);
+		vp += tmp.z;
+		break;
+	default:
+		return NULL;
+	}
+	return vp;
+}
+
+static int
+rd_pub(struct ctx_s *ctx, const char *rp, const char *ep)
+{
+	obuf_t out = ctx->out;
+	struct bin_pub_s p;
+	const uint8_t *bm;
+	const char *vp;
+
+	if (UNLIKELY(rp + sizeof(p) > ep)) {
+		return -1;
+	}
+	memcpy(&p, rp, sizeof(p));
+	bm = (const uint8_t*)rp + sizeof(p);
+	vp = rp + sizeof(p) + (p.nfld + 7U) / 8U;
+	if (UNLIKELY(vp > ep)) {
+		return -1;
+	}
+
+	rd_stmp(ctx, p.stmp);
+	obuf_putc(out, '\t');
+	if (LIKELY(p.tid < ctx->tops.n && ctx->tops.v[p.tid] != NULL)) {
+		obuf_puts(out, ctx->tops.v[p.tid]);
+	}
+	for (size_t i = 0U; i < p.nfld; i++) {
+		obuf_putc(out, '\t');
+		if (!(bm[i / 8U] & (1U << (i % 8U)))) {
+			continue;
+		} else if (UNLIKELY((vp = rd_val(ctx, vp, ep)) == NULL)) {
+			obuf_undo(out);
+			return -1;
+		}
+	}
+	obuf_putc(out, '\n');
+	obuf_rec(out);
+	return 0;
+}
+
+static void
+rd_hdr(struct ctx_s *ctx)
+{
+/* print a header line once the dictionaries are known */
+	obuf_t out = ctx->out;
+
+	obuf_puts(out, "stamp\ttopic");
+	for (size_t i = 0U; i < ctx->flds.n; i++) {
+		obuf_putc(out, '\t');
+		if (ctx->flds.v[i] != NULL) {
+			obuf_puts(out, ctx->flds.v[i]);
+		}
+	}
+	obuf_putc(out, '\n');
+	obuf_rec(out);
+	return;
+}
+
+static int
+rd_rec(struct ctx_s *ctx, const char *rp, size_t rz)
+{
+	const char *ep = rp + rz;
+
+	switch (((const struct bin_rec_s*)(const void*)rp)->typ) {
+		struct bin_hdr_s h;
+		struct bin_fld_s f;
+		struct bin_top_s t;
+
+	case BIN_RT_HDR:
+		if (UNLIKELY(rz < sizeof(h))) {
+			return -1;
+		}
+		memcpy(&h, rp, sizeof(h));
+		if (UNLIKELY(memcmp(h.magic, BIN_MAGIC, sizeof(h.magic)))) {
+			errno = 0, error("\
+Error: bad magic, not a blpcli binary stream");
+			return -1;
+		} else if (UNLIKELY(h.ver != BIN_VERSION)) {
+			errno = 0, error("\
+Error: unsupported version %u", h.ver);
+			return -1;
+		}
+		/* new stream, new dictionaries */
+		dict_free(&ctx->flds);
+		dict_free(&ctx->tops);
+		ctx->hdrp = false;
+		break;
+	case BIN_RT_FLD:
+		if (UNLIKELY(rz < sizeof(f))) {
+			return -1;
+		}
+		memcpy(&f, rp, sizeof(f));
+		return dict_put(&ctx->flds, f.fid, rp + sizeof(f), rz - sizeof(f));
+	case BIN_RT_TOP:
+		if (UNLIKELY(rz < sizeof(t))) {
+			return -1;
+		}
+		memcpy(&t, rp, sizeof(t));
+		return dict_put(&ctx->tops, t.tid, rp + sizeof(t), rz - sizeof(t));
+	case BIN_RT_PUB:
+		if (!ctx->hdrp) {
+			rd_hdr(ctx);
+			ctx->hdrp = true;
+		}
+		return rd_pub(ctx, rp, ep);
+	default:
+		/* skip unknown records */
+		break;
+	}
+	return 0;
+}
+
+static int
+rd_fd(struct ctx_s *ctx, int fd)
+{
+	static char buf[IBUF_SIZE];
+	size_t nbuf = 0U;
+	ssize_t nrd;
+
+	while ((nrd = read(fd, buf + nbuf, sizeof(buf) - nbuf)) > 0) {
+		const char *bp = buf;
+		const char *const ep = buf + nbuf + nrd;
+
+		/* consume all complete records */
+		for (uint32_t rz; bp + sizeof(struct bin_rec_s) <= ep; bp += rz) {
+			memcpy(&rz, bp, sizeof(rz));
+			if (UNLIKELY(rz < sizeof(struct bin_rec_s) ||
+				     rz > sizeof(buf))) {
+				errno = 0, error("\
+Error: corrupt record of length %u", rz);
+				return -1;
+			} else if (bp + rz > ep) {
+				break;
+			} else if (UNLIKELY(rd_rec(ctx, bp, rz) < 0)) {
+				errno = 0, error("\
+Error: cannot decode record at offset %zu", (size_t)(bp - buf));
+				return -1;
+			}
+		}
+		/* keep the partial record for the next read */
+		nbuf = ep - bp;
+		memmove(buf, bp, nbuf);
+	}
+	if (UNLIKELY(nrd < 0)) {
+		error("\
+Error: cannot read input");
+		return -1;
+	} else if (UNLIKELY(nbuf)) {
+		errno = 0, error("\
+Warning: %zu trailing bytes in input", nbuf);
+	}
+	return 0;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+	static yuck_t argi[1U];
+	static struct ctx_s ctx = {.prec = -1};
+	int rc = 0;
+
+	if (yuck_parse(argi, argc, argv) < 0) {
+		rc = 1;
+		goto out;
+	}
+
+	if (argi->precision_arg) {
+		ctx.prec = strtol(argi->precision_arg, NULL, 10);
+		if (UNLIKELY(ctx.prec < 0 || ctx.prec > 9)) {
+			errno = 0, error("\
+Error: precision must be between 0 and 9");
+			rc = 1;
+			goto out;
+		}
+	}
+
+	if (UNLIKELY((ctx.out = make_obuf(
+			      STDOUT_FILENO, 64U * 1024U, 16U)) == NULL)) {
+		error("\
+Error: cannot allocate output buffer");
+		rc = 1;
+		goto out;
+	}
+	/* we're a batch tool, size is all that matters */
+	obuf_set_thresh(ctx.out, 64U * 1024U, 0U);
+
+	if (!argi->nargs) {
+		rc = rd_fd(&ctx, STDIN_FILENO) < 0;
+	}
+	for (size_t i = 0U; i < argi->nargs; i++) {
+		const char *fn = argi->args[i];
+		int fd;
+
+		if ((fd = open(fn, O_RDONLY)) < 0) {
+			error("\
+Error: cannot open file `%s'", fn);
+			rc = 1;
+			continue;
+		}
+		rc |= rd_fd(&ctx, fd) < 0;
+		close(fd);
+	}
+
+	obuf_flush(ctx.out);
+	if (UNLIKELY(ctx.out->err)) {
+		errno = ctx.out->err, error("\
+Error: cannot write output");
+		rc = 1;
+	}
+	free_obuf(ctx.out);
+	dict_free(&ctx.flds);
+	dict_free(&ctx.tops);
+out:
+	yuck_free(argi);
+	return rc;
+}
+
+/* blp-rd.c ends here */
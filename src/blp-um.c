@@ -45,6 +45,7 @@
 #include <signal.h>
 #include <setjmp.h>
 #include <errno.h>
+#include <inttypes.h>
 #include <sys/time.h>
 #include <time.h>
 #include <pthread.h>
@@ -58,15 +59,30 @@
 #include <blpapi_element.h>
 #include <blpapi_event.h>
 #include <blpapi_message.h>
+#include <blpapi_name.h>
 #include <blpapi_request.h>
 #include <blpapi_session.h>
 #include <blpapi_subscriptionlist.h>
+#include "fldtab.h"
+#include "fmt.h"
+#include "clk.h"
+#include "lat.h"
+#include "sopt.h"
+#include "topt.h"
+#include "dur.h"
+#include "rstat.h"
 #include "nifty.h"
 
 #include "blp-um.yucc"
 
 #define MCAST_ADDR	"ff05::134"
 #define MCAST_PORT	7878
+/* instruments per subscription batch, and nanoseconds between batches */
+#define SUB_BATCH	(1000U)
+#define SUB_TICK	(10000000L)
+/* first and longest nanoseconds between reconnect attempts */
+#define REC_NAP		(100000000ULL)
+#define REC_MAXNAP	(30000000000ULL)
 
 typedef struct {
 	blpapi_Float64_t bid;
@@ -91,11 +107,62 @@ struct ctx_s {
 	uint8_t *touched;
 	int rc;
 	int sok;
+
+	/* this session's share of the instruments, see strhash() */
+	size_t shard;
+	size_t nshard;
+
+	/* name handles for BID and ASK */
+	fldtab_t ftab;
+
+	/* subscription options for all instruments, and the comma-separated
+	 * options of every instrument (or NULL), see topt_split() */
+	char *const *gopts;
+	size_t ngopt;
+	char **topts;
+	/* how full blpapi's queue for this session got */
+	struct sopt_qst_s qst;
+
+	/* subscription batches and reconnects, guarded by sublk */
+	struct {
+		/* whether batches can go out, and the next instrument */
+		bool gop;
+		bool donep;
+		size_t next;
+		size_t nsub;
+		size_t nown;
+		/* set when the session has died, and attempts to revive it */
+		bool deadp;
+		unsigned int ntry;
+		/* monotonic time of the next attempt and of the death */
+		uint64_t due;
+		uint64_t t0;
+	} rec;
 };
 
 #define LOG(x)		fputs(x, stderr)
 #define LOGF(fmt, ...)	fprintf(stderr, fmt, __VA_ARGS__)
 
+/* latency histograms, printed on SIGUSR1 and at exit */
+static struct lat_s lat;
+/* servers, queue sizes and timeouts of every session */
+static struct sopt_s sopt;
+/* whether to shed data while blpapi warns of a slow consumer */
+static bool slow_drop_p;
+/* whether to count things, see --stats, and per-instrument sums */
+static bool statp;
+static uint64_t *stat_tops;
+/* counters and time of the previous line on stderr (0) and
+ * of the previous snapshot off the socket (1), rates are since then */
+static struct rstat_s stat_prev[2U];
+static uint64_t stat_tprev[2U];
+/* serialises latency accounting of several sessions */
+static pthread_mutex_t latlk = PTHREAD_MUTEX_INITIALIZER;
+/* serialises subscription batches of the main thread and the sessions */
+static pthread_mutex_t sublk = PTHREAD_MUTEX_INITIALIZER;
+/* whether we're shutting down, sessions terminating are ours then */
+static bool endp;
+
 
 static __attribute__((format(printf, 1, 2))) void
 error(const char *fmt, ...)
@@ -125,6 +192,8 @@ block_sigs(void)
 	sigaddset(fatal_signal_set, SIGTERM);
 	sigaddset(fatal_signal_set, SIGXCPU);
 	sigaddset(fatal_signal_set, SIGXFSZ);
+	sigaddset(fatal_signal_set, SIGUSR1);
+	sigaddset(fatal_signal_set, SIGUSR2);
 	(void)pthread_sigmask(SIG_BLOCK, fatal_signal_set, (sigset_t*)NULL);
 	return;
 }
@@ -221,22 +290,35 @@ send_quo(int sok, const char *instr, quo_t q)
 	memcpy(buf, instr, (len = strlen(instr)));
 	buf[len++] = '\t';
 	if (!isnan(q.bid)) {
-		len += snprintf(buf + len, sizeof(buf) - len, "%f", q.bid);
+		len += fmt_f64(buf + len, q.bid);
 	}
 	buf[len++] = '\t';
 	if (!isnan(q.ask)) {
-		len += snprintf(buf + len, sizeof(buf) - len, "%f", q.ask);
+		len += fmt_f64(buf + len, q.ask);
 	}
 	/* and finalise */
 	buf[len++] = '\n';
 	buf[len] = '\0';
-	send(sok, buf, len, 0);
+	if (!statp) {
+		send(sok, buf, len, 0);
+	} else with (struct rstat_s *rs = rstat_self()) {
+		const ssize_t nsnt = send(sok, buf, len, 0);
+
+		if (UNLIKELY(rs == NULL)) {
+			;
+		} else if (UNLIKELY(nsnt < 0)) {
+			rs->nerr++;
+		} else {
+			rs->nbyt += nsnt;
+		}
+	}
 	return;
 }
 
 static void
 dump_pub(const struct ctx_s ctx[static 1U], blpapi_Message_t *msg)
 {
+	blpapi_Element_t *cols[countof(flds)];
 	blpapi_Element_t *els;
 	blpapi_Element_t *el;
 	blpapi_CorrelationId_t cid;
@@ -256,15 +338,16 @@ dump_pub(const struct ctx_s ctx[static 1U], blpapi_Message_t *msg)
 		goto nop;
 	}
 
-	if (!blpapi_Element_getElement(els, &el, flds[0U], NULL)) {
+	fldtab_scan(ctx->ftab, cols, els);
+	if ((el = cols[0U]) != NULL) {
 		blpapi_Element_getValueAsFloat64(el, &ctx->book[ix].bid, 0U);
 		ctx->touched[ix] = 1U;
 	}
-	if (!blpapi_Element_getElement(els, &el, flds[1U], NULL)) {
+	if ((el = cols[1U]) != NULL) {
 		blpapi_Element_getValueAsFloat64(el, &ctx->book[ix].ask, 0U);
 		ctx->touched[ix] = 1U;
 	}
-	if (!isnan(ctx->book[ix].bid && !isnan(ctx->book[ix].ask))) {
+	if (!isnan(ctx->book[ix].bid) && !isnan(ctx->book[ix].ask)) {
 		send_quo(ctx->sok, ctx->instr[ix], ctx->book[ix]);
 		ctx->touched[ix] = 0U;
 	}
@@ -277,10 +360,30 @@ static void
 dump_evs(const struct ctx_s ctx[static 1U], blpapi_MessageIterator_t *iter)
 {
 	blpapi_Message_t *msg;
+	struct rstat_s *rs = statp ? rstat_self() : NULL;
+	/* books are per session and datagrams go out whole, only the
+	 * latency histograms are shared */
+	const bool mtp = ctx->nshard > 1U;
+	uint64_t t0;
 
+	t0 = clk_rt();
 	memset(ctx->book, -1, sizeof(*ctx->book) * ctx->ninstr);
 	memset(ctx->touched, 0, sizeof(*ctx->touched) * ctx->ninstr);
 	while (!blpapi_MessageIterator_next(iter, &msg)) {
+		if (UNLIKELY(mtp)) {
+			pthread_mutex_lock(&latlk);
+			lat_msg(&lat, msg, t0);
+			pthread_mutex_unlock(&latlk);
+		} else {
+			lat_msg(&lat, msg, t0);
+		}
+		if (rs != NULL) {
+			blpapi_CorrelationId_t cid =
+				blpapi_Message_correlationId(msg, 0);
+
+			rs->nmsg++;
+			rstat_top(rs, cid.value.intValue - 1U);
+		}
 		dump_pub(ctx, msg);
 	}
 	/* send the touched ones now */
@@ -290,39 +393,92 @@ dump_evs(const struct ctx_s ctx[static 1U], blpapi_MessageIterator_t *iter)
 		}
 		send_quo(ctx->sok, ctx->instr[i], ctx->book[i]);
 	}
+	if (UNLIKELY(mtp)) {
+		pthread_mutex_lock(&latlk);
+		lat_evw(&lat, t0, clk_rt());
+		pthread_mutex_unlock(&latlk);
+	} else {
+		lat_evw(&lat, t0, clk_rt());
+	}
 	return;
 }
 
 
-static int
-svc_sta_sub(blpapi_Session_t *s, char *const *instr, size_t ninstr)
+static bool
+sub_batch(blpapi_Session_t *s, struct ctx_s *ctx)
 {
+/* subscribe the next batch of instruments out of CTX's share,
+ * return whether there are more, to be called with sublk held */
+	char *const *instr = ctx->instr;
+	const size_t ninstr = ctx->ninstr;
 	blpapi_SubscriptionList_t *subs;
-	const char *opts[] = {};
+	size_t i = ctx->rec.next;
+	size_t n = 0U;
 
 	if (UNLIKELY((subs = blpapi_SubscriptionList_create()) == NULL)) {
-		errno = 0, error("\
-Error: cannot instantiate subscriptions");
-		return -1;
+		/* next time then */
+		return true;
 	}
-
-	/* subscribe */
-	for (size_t i = 0U; i < ninstr; i++) {
+	for (; i < ninstr && n < SUB_BATCH; i++) {
 		const char *top = instr[i];
+		const char *topt = ctx->topts ? ctx->topts[i] : NULL;
+		const size_t z = topt ? strlen(topt) : 0U;
 		blpapi_CorrelationId_t cid = {
 			.size = sizeof(cid),
 			.valueType = BLPAPI_CORRELATION_TYPE_INT,
 			.value.intValue = i + 1U,
 		};
 
-		blpapi_SubscriptionList_add(
-			subs, top, &cid, flds, opts, countof(flds), countof(opts));
+		if (ctx->nshard > 1U &&
+		    strhash(top) % ctx->nshard != ctx->shard) {
+			continue;
+		}
+		/* global options first, the instrument's own ones override */
+		with (const char *opts[ctx->ngopt + (z + 1U) / 2U + 1U]) {
+			char buf[z + 1U];
+			size_t nopts = ctx->ngopt;
+
+			memcpy(opts, ctx->gopts, nopts * sizeof(*opts));
+			if (topt != NULL) {
+				memcpy(buf, topt, z + 1U);
+				nopts = topt_add(opts, nopts, buf);
+				ctx->rec.nown++;
+			}
+			blpapi_SubscriptionList_add(
+				subs, top, &cid, flds, opts, countof(flds), nopts);
+		}
+		n++;
 	}
-	if (blpapi_Session_subscribe(s, subs, NULL, NULL, 0)) {
+	if (n && blpapi_Session_subscribe(s, subs, NULL, NULL, 0)) {
 		errno = 0, error("\
 Error: cannot subscribe");
 	}
 	blpapi_SubscriptionList_destroy(subs);
+	ctx->rec.next = i;
+	ctx->rec.nsub += n;
+	return i < ninstr;
+}
+
+static int
+svc_sta_sub(blpapi_Session_t *UNUSED(s), struct ctx_s *ctx)
+{
+	/* resolve field names once and for all */
+	if (ctx->ftab == NULL &&
+	    UNLIKELY((ctx->ftab = make_fldtab(flds, countof(flds))) == NULL)) {
+		errno = 0, error("\
+Error: cannot resolve field names");
+		return -1;
+	}
+
+	/* the main thread sends our instruments in batches */
+	pthread_mutex_lock(&sublk);
+	ctx->rec.gop = true;
+	ctx->rec.donep = false;
+	ctx->rec.next = 0U;
+	ctx->rec.nsub = 0U;
+	ctx->rec.nown = 0U;
+	pthread_mutex_unlock(&sublk);
+	kill(getpid(), SIGUSR2);
 	return 0;
 }
 
@@ -371,7 +527,20 @@ sess_end(blpapi_Session_t *UNUSED(sess), struct ctx_s *ctx)
 	/* indicate success */
 	LOG("ST<-FIN\n");
 	ctx->st = ST_FIN;
-	kill(0, SIGQUIT);
+	/* the queue's gone, a revived session mustn't count as slow */
+	sopt_qlo(&ctx->qst, clk_mono());
+	if (__atomic_load_n(&endp, __ATOMIC_ACQUIRE)) {
+		return 0;
+	}
+	/* books live on, the main thread revives the session */
+	pthread_mutex_lock(&sublk);
+	ctx->rec.gop = false;
+	if (!ctx->rec.t0) {
+		ctx->rec.t0 = clk_mono();
+	}
+	pthread_mutex_unlock(&sublk);
+	__atomic_store_n(&ctx->rec.deadp, true, __ATOMIC_RELEASE);
+	kill(getpid(), SIGUSR2);
 	return 0;
 }
 
@@ -391,7 +560,7 @@ Warning: service message received but we are past the session state");
 		return -1;
 	}
 
-	if (svc_sta_sub(sess, ctx->instr, ctx->ninstr) < 0) {
+	if (svc_sta_sub(sess, ctx) < 0) {
 		return -1;
 	}
 	/* success */
@@ -423,6 +592,7 @@ sub_sta(blpapi_Session_t *UNUSED(sess), struct ctx_s *ctx)
 static void
 beef(blpapi_Event_t *e, blpapi_Session_t *sess, void *ctx)
 {
+	const uint64_t t0 = statp ? clk_mono() : 0U;
 	blpapi_MessageIterator_t *iter;
 	unsigned int typ;
 
@@ -431,17 +601,39 @@ beef(blpapi_Event_t *e, blpapi_Session_t *sess, void *ctx)
 		return;
 	}
 	switch ((typ = blpapi_Event_eventType(e))) {
+	case BLPAPI_EVENTTYPE_ADMIN:
+		for (blpapi_Message_t *msg;
+		     (!blpapi_MessageIterator_next(iter, &msg));) {
+			static const char hi[] = "SlowConsumerWarning";
+			static const char lo[] = "SlowConsumerWarningCleared";
+			static const char los[] = "DataLoss";
+			const char *msgstr = blpapi_Message_typeString(msg);
+			struct sopt_qst_s *q = &((struct ctx_s*)ctx)->qst;
+
+			if (!strcmp(msgstr, hi)) {
+				/* we're not keeping up */
+				sopt_qhi(q, clk_mono());
+			} else if (!strcmp(msgstr, lo)) {
+				sopt_qlo(q, clk_mono());
+			} else if (!strcmp(msgstr, los)) {
+				/* we didn't keep up */
+				q->nloss++;
+			}
+		}
+		break;
 	case BLPAPI_EVENTTYPE_SESSION_STATUS:
 		for (blpapi_Message_t *msg;
 		     (!blpapi_MessageIterator_next(iter, &msg));) {
 			static const char sta[] = "SessionStarted";
 			static const char end[] = "SessionTerminated";
+			static const char ftl[] = "SessionStartupFailure";
 			const char *msgstr = blpapi_Message_typeString(msg);
 
 			if (!strcmp(msgstr, sta)) {
 				/* yay!!! */
 				sess_sta(sess, ctx);
-			} else if (!strcmp(msgstr, end)) {
+			} else if (!strcmp(msgstr, end) ||
+				   !strcmp(msgstr, ftl)) {
 				/* nawww :( */
 				sess_end(sess, ctx);
 			} else {
@@ -477,6 +669,17 @@ beef(blpapi_Event_t *e, blpapi_Session_t *sess, void *ctx)
 	case BLPAPI_EVENTTYPE_PARTIAL_RESPONSE:
 	case BLPAPI_EVENTTYPE_RESPONSE:
 	case BLPAPI_EVENTTYPE_SUBSCRIPTION_DATA:
+		if (UNLIKELY(slow_drop_p) &&
+		    typ == BLPAPI_EVENTTYPE_SUBSCRIPTION_DATA &&
+		    sopt_qhip(&((struct ctx_s*)ctx)->qst)) {
+			/* skip the messages, the queue drains oldest first */
+			struct sopt_qst_s *q = &((struct ctx_s*)ctx)->qst;
+
+			for (blpapi_Message_t *msg;
+			     !blpapi_MessageIterator_next(iter, &msg);
+			     q->ndrop++);
+			break;
+		}
 		dump_evs(ctx, iter);
 
 		if (UNLIKELY(typ == BLPAPI_EVENTTYPE_RESPONSE)) {
@@ -493,16 +696,172 @@ Warning: unknown event %u", typ);
 	}
 	blpapi_MessageIterator_destroy(iter);
 	blpapi_Event_release(e);
+
+	if (statp) {
+		struct rstat_s *rs;
+
+		if (LIKELY((rs = rstat_self()) != NULL)) {
+			rs->nev[typ < RSTAT_NEVT ? typ : 0U]++;
+			hist_rec(&rs->cbk, clk_mono() - t0);
+		}
+	}
 	return;
 }
 
+static void
+stat_prnt(int fd, bool topp, void *clo)
+{
+/* write a line of statistics to FD, and a line per instrument if TOPP */
+	const struct ctx_s *ctx = clo;
+	struct rstat_s *prev = stat_prev + topp;
+	uint64_t *tprev = stat_tprev + topp;
+	struct rstat_s cur = {.ntop = topp ? stat_tops : NULL};
+	const uint64_t now = clk_mono();
+	char buf[4096U];
+	size_t n;
+
+	rstat_sum(&cur);
+	with (const uint64_t ts = clk_rt(), dt = now - *tprev) {
+		n = snprintf(buf, sizeof(buf), "\
+stats ts=%" PRIu64 ".%09" PRIu64 " dt=%" PRIu64 ".%03" PRIu64 " ",
+			     ts / 1000000000U, ts % 1000000000U,
+			     dt / 1000000000U, dt / 1000000U % 1000U);
+	}
+	n += rstat_prnt(buf + n, sizeof(buf) - n, &cur, prev, now - *tprev);
+	if (n >= sizeof(buf) - 1U) {
+		n = sizeof(buf) - 2U;
+	}
+	buf[n++] = '\n';
+	if (UNLIKELY(rstat_write(fd, buf, n) < 0)) {
+		/* they didn't get it, rates stay relative to the last one */
+		return;
+	}
+
+	for (size_t i = 0U, m = 0U; cur.ntop != NULL && i < ctx->ninstr; i++) {
+		const size_t z = strlen(ctx->instr[i]);
+
+		if (m + z + FMT_INT_MAXLEN + 8U > sizeof(buf)) {
+			if (UNLIKELY(rstat_write(fd, buf, m) < 0)) {
+				break;
+			}
+			m = 0U;
+		}
+		memcpy(buf + m, "top\t", 4U);
+		m += 4U;
+		memcpy(buf + m, ctx->instr[i], z);
+		m += z;
+		buf[m++] = '\t';
+		m += fmt_u64(buf + m, cur.ntop[i]);
+		buf[m++] = '\n';
+		if (i + 1U >= ctx->ninstr) {
+			rstat_write(fd, buf, m);
+		}
+	}
+	*prev = cur;
+	prev->ntop = NULL;
+	*tprev = now;
+	return;
+}
+
+static blpapi_Session_t*
+sess_make(struct ctx_s *ctx)
+{
+	blpapi_SessionOptions_t *opt;
+	blpapi_Session_t *r;
+
+	if (UNLIKELY((opt = sopt_make(&sopt)) == NULL)) {
+		errno = 0, error("\
+Error: cannot create session options");
+		return NULL;
+	}
+	r = blpapi_Session_create(opt, beef, NULL, ctx);
+	blpapi_SessionOptions_destroy(opt);
+	return r;
+}
+
+static bool
+rec_tick(struct ctx_s *ctx, struct ctx_s *sctx,
+	 blpapi_Session_t **sess, size_t nsess)
+{
+/* revive dead sessions whose time has come, and send everyone's next
+ * batch of subscriptions, return whether there is more to do */
+	const uint64_t now = clk_mono();
+	bool morep = false;
+
+	for (size_t i = 0U; i < nsess; i++) {
+		struct ctx_s *c = i ? sctx + i : ctx;
+		uint64_t nap;
+
+		if (!__atomic_load_n(&c->rec.deadp, __ATOMIC_ACQUIRE)) {
+			continue;
+		} else if (now < c->rec.due) {
+			morep = true;
+			continue;
+		}
+		/* back off exponentially, up to a limit */
+		nap = c->rec.ntry < 16U ? REC_NAP << c->rec.ntry : REC_MAXNAP;
+		c->rec.due = now + (nap < REC_MAXNAP ? nap : REC_MAXNAP);
+		c->rec.ntry++;
+		LOGF("session %zu: reconnecting, attempt %u\n", i, c->rec.ntry);
+
+		if (sess[i] != NULL) {
+			blpapi_Session_stop(sess[i]);
+			blpapi_Session_destroy(sess[i]);
+		}
+		__atomic_store_n(&c->rec.deadp, false, __ATOMIC_RELEASE);
+		if (UNLIKELY((sess[i] = sess_make(c)) == NULL ||
+			     blpapi_Session_start(sess[i]))) {
+			errno = 0, error("\
+Warning: cannot restart session %zu", i);
+			__atomic_store_n(&c->rec.deadp, true, __ATOMIC_RELEASE);
+		}
+		morep = true;
+	}
+
+	pthread_mutex_lock(&sublk);
+	for (size_t i = 0U; i < nsess; i++) {
+		struct ctx_s *c = i ? sctx + i : ctx;
+
+		if (!c->rec.gop || c->rec.donep) {
+			continue;
+		} else if (sub_batch(sess[i], c)) {
+			morep = true;
+			continue;
+		}
+		c->rec.donep = true;
+		LOGF("\
+session %zu: %zu instruments, %zu with options of their own\n",
+		     i, c->rec.nsub, c->rec.nown);
+		if (c->rec.t0) {
+			const uint64_t d = now - c->rec.t0;
+
+			LOGF("\
+session %zu: recovered after %u attempts in %" PRIu64 ".%03" PRIu64 "s\n",
+			     i, c->rec.ntry,
+			     d / 1000000000U, d / 1000000U % 1000U);
+			c->rec.t0 = 0U;
+			c->rec.ntry = 0U;
+			c->rec.due = 0U;
+		}
+	}
+	pthread_mutex_unlock(&sublk);
+	return morep;
+}
+
 int
 main(int argc, char *argv[])
 {
 	static yuck_t argi[1U];
-	static struct ctx_s ctx;
-	blpapi_Session_t *sess = NULL;
+	static struct ctx_s ctx = {.nshard = 1U};
+	/* sessions and their contexts, the first one is CTX itself */
+	blpapi_Session_t **sess = NULL;
+	struct ctx_s *sctx = NULL;
+	size_t nsess = 1U;
 	int sok = -1;
+	/* statistics and the thread serving them */
+	static struct rstat_srv_s srv = {.sok = -1};
+	pthread_t stat;
+	bool statt = false;
 	int rc = 0;
 
 	/* parse options, set up longjmp target and
@@ -514,9 +873,95 @@ Fatal: cannot parse options");
 		goto out;
 	}
 
+	if (argi->sessions_arg &&
+	    !(nsess = strtoul(argi->sessions_arg, NULL, 10))) {
+		errno = 0, error("\
+Error: number of sessions must be positive");
+		rc = 1;
+		goto out;
+	}
+
+	if (UNLIKELY(sopt_init(
+			     &sopt, argi->server_args, argi->server_nargs) < 0)) {
+		errno = 0, error("\
+Error: servers must be given as HOST, HOST:PORT or [ADDR]:PORT");
+		rc = 1;
+		goto out;
+	} else if (argi->queue_size_arg &&
+		   !(sopt.qz = strtoul(argi->queue_size_arg, NULL, 10))) {
+		errno = 0, error("\
+Error: queue size must be positive");
+		rc = 1;
+		goto out;
+	} else if (argi->queue_marks_arg &&
+		   (sscanf(argi->queue_marks_arg, "%f,%f",
+			   &sopt.hiwat, &sopt.lowat) != 2 ||
+		    !(sopt.lowat > 0.f && sopt.lowat < sopt.hiwat &&
+		      sopt.hiwat <= 1.f))) {
+		errno = 0, error("\
+Error: queue marks must be HI,LO with 0 < LO < HI <= 1");
+		rc = 1;
+		goto out;
+	} else if (argi->connect_timeout_arg) {
+		const int64_t tmo = dur_strp(argi->connect_timeout_arg);
+
+		if (tmo <= 0) {
+			errno = 0, error("\
+Error: cannot read connect timeout, use 500ms, 2s, etc.");
+			rc = 1;
+			goto out;
+		}
+		/* blpapi wants milliseconds, at least one */
+		sopt.tmo = (tmo + 999999) / 1000000;
+	}
+	sopt_prnt(&sopt);
+
+	if (argi->stats_arg &&
+	    (int64_t)(srv.ivl = dur_strp(argi->stats_arg)) <= 0) {
+		errno = 0, error("\
+Error: statistics interval must be a duration like 500ms or 10s");
+		rc = 1;
+		goto out;
+	} else if (argi->stats_socket_arg &&
+		   (srv.sok = rstat_listen(argi->stats_socket_arg)) < 0) {
+		error("\
+Error: cannot listen on statistics socket `%s'",
+		      argi->stats_socket_arg);
+		rc = 1;
+		goto out;
+	}
+	statp = srv.ivl || srv.sok >= 0;
+
+	if (argi->slow_arg == NULL || !strcmp(argi->slow_arg, "block")) {
+		;
+	} else if (!strcmp(argi->slow_arg, "drop")) {
+		slow_drop_p = true;
+	} else {
+		errno = 0, error("\
+Error: slow consumer policy must be one of `block' or `drop'");
+		rc = 1;
+		goto out;
+	}
+
 	ctx.instr = argi->args, ctx.ninstr = argi->nargs;
-	ctx.book = malloc(argi->nargs * sizeof(*ctx.book));
-	ctx.touched = malloc(argi->nargs * sizeof(*ctx.touched));
+
+	/* subscription options, for all instruments and per instrument */
+	if (UNLIKELY(ctx.ninstr && (ctx.topts = calloc(
+			ctx.ninstr, sizeof(*ctx.topts))) == NULL)) {
+		error("\
+Error: cannot allocate subscription options");
+		rc = 1;
+		goto out;
+	}
+	ctx.gopts = argi->option_args;
+	ctx.ngopt = argi->option_nargs;
+	for (size_t i = 0U; i < ctx.ninstr; i++) {
+		ctx.topts[i] = topt_split(ctx.instr[i]);
+	}
+	for (size_t i = 0U; i < ctx.ngopt; i++) {
+		LOGF("subscription option for all instruments: %s\n",
+		     ctx.gopts[i]);
+	}
 
 	/* we can't do with interruptions */
 	block_sigs();
@@ -536,43 +981,95 @@ Error: cannot activate publishing mode on socket %d", sok);
 	/* this can be considered ready */
 	ctx.sok = sok;
 
-	/* get ourselves a session handle */
-	with (blpapi_SessionOptions_t *opt) {
-		/* suppress blpapi messages */
-		setbuf(stdout, NULL);
+	/* one context per session, each with a book of its own */
+	if (UNLIKELY((sess = calloc(nsess, sizeof(*sess))) == NULL ||
+		     (sctx = calloc(nsess, sizeof(*sctx))) == NULL)) {
+		error("\
+Error: cannot allocate sessions");
+		rc = 1;
+		goto out;
+	} else if (UNLIKELY((ctx.ftab = make_fldtab(
+				     flds, countof(flds))) == NULL)) {
+		errno = 0, error("\
+Error: cannot resolve field names");
+		rc = 1;
+		goto out;
+	}
+	ctx.nshard = nsess;
+	for (size_t i = 0U; i < nsess; i++) {
+		struct ctx_s *c = i ? sctx + i : &ctx;
 
-		if (UNLIKELY((opt = blpapi_SessionOptions_create()) == NULL)) {
+		if (i) {
+			*c = ctx;
+			c->shard = i;
+		}
+		c->book = malloc(ctx.ninstr * sizeof(*c->book));
+		c->touched = malloc(ctx.ninstr * sizeof(*c->touched));
+		if (UNLIKELY(c->book == NULL || c->touched == NULL)) {
 			error("\
-Error: cannot create session options");
+Error: cannot allocate books");
 			rc = 1;
 			goto out;
 		}
-		/* otherwise set them according to our command-line flags */
-		blpapi_SessionOptions_setServerHost(opt, "localhost");
-		blpapi_SessionOptions_setServerPort(opt, 8194);
-		blpapi_SessionOptions_setMaxEventQueueSize(opt, 8192);
-
-		sess = blpapi_Session_create(opt, beef, NULL, &ctx);
-		blpapi_SessionOptions_destroy(opt);
 	}
 
-	/* check session handle before we continue with the setup*/
-	if (UNLIKELY(sess == NULL)) {
-		errno = 0, error("\
-Error: cannot set up session");
+	/* counters for every instrument */
+	if (statp && UNLIKELY(rstat_init(ctx.ninstr) < 0 ||
+			      (ctx.ninstr && (stat_tops = calloc(
+				      ctx.ninstr, sizeof(*stat_tops))) == NULL))) {
+		error("\
+Error: cannot allocate statistics");
 		rc = 1;
 		goto out;
-	} else if (blpapi_Session_start(sess)) {
-		errno = 0, error("\
+	} else if (statp) {
+		srv.prnt = stat_prnt;
+		srv.clo = &ctx;
+		/* first rates are since now */
+		stat_tprev[0U] = stat_tprev[1U] = clk_mono();
+		if (UNLIKELY(pthread_create(&stat, NULL, rstat_loop, &srv))) {
+			error("\
+Error: cannot start statistics thread");
+			rc = 1;
+			goto out;
+		}
+		statt = true;
+	}
+
+	/* suppress blpapi messages */
+	setbuf(stdout, NULL);
+
+	/* get ourselves session handles */
+	for (size_t i = 0U; i < nsess; i++) {
+		struct ctx_s *c = i ? sctx + i : &ctx;
+
+		sess[i] = sess_make(c);
+
+		/* check session handle before we continue with the setup*/
+		if (UNLIKELY(sess[i] == NULL)) {
+			errno = 0, error("\
+Error: cannot set up session");
+			rc = 1;
+			goto out;
+		} else if (blpapi_Session_start(sess[i])) {
+			errno = 0, error("\
 Error: cannot start session");
-		rc = 1;
-		goto out;
+			rc = 1;
+			goto out;
+		}
 	}
 
 	/* sleep and let the bloomberg thread do the hard work */
 	with (sigset_t sigs[1U]) {
+		const struct timespec tick = {.tv_nsec = SUB_TICK};
+		bool morep = false;
+
 		sigfillset(sigs);
-		for (int sig; !sigwait(sigs, &sig);) {
+		for (int sig;; morep = rec_tick(&ctx, sctx, sess, nsess)) {
+			/* wake up for batches and reconnects */
+			if ((sig = sigtimedwait(
+				     sigs, NULL, morep ? &tick : NULL)) < 0) {
+				continue;
+			}
 			switch (sig) {
 			case SIGQUIT:
 			case SIGINT:
@@ -580,6 +1077,14 @@ Error: cannot start session");
 				LOG("GOT INT\n");
 				goto out;
 
+			case SIGUSR1:
+				lat_prnt(&lat);
+				break;
+
+			case SIGUSR2:
+				/* see rec_tick() */
+				break;
+
 			default:
 				LOGF("GOT SIG %d\n", sig);
 				break;
@@ -588,20 +1093,59 @@ Error: cannot start session");
 	}
 
 out:
+	/* sessions terminating from now on are ours */
+	__atomic_store_n(&endp, true, __ATOMIC_RELEASE);
+	signal(SIGUSR2, SIG_IGN);
 	unblock_sigs();
+	if (statt) {
+		pthread_cancel(stat);
+		pthread_join(stat, NULL);
+	}
+	if (srv.sok >= 0) {
+		close(srv.sok);
+		unlink(argi->stats_socket_arg);
+	}
 	if (sok >= 0) {
 		mc6_unset_pub(sok);
 		close(sok);
 	}
+	for (size_t i = 0U; sess != NULL && i < nsess; i++) {
+		if (sess[i] != NULL) {
+			blpapi_Session_stop(sess[i]);
+			blpapi_Session_destroy(sess[i]);
+		}
+	}
+	for (size_t i = 0U; sctx != NULL && i < nsess; i++) {
+		struct ctx_s *c = i ? sctx + i : &ctx;
+
+		sopt_qlo(&c->qst, clk_mono());
+		sopt_qprnt(&c->qst, i);
+		if (c->book) {
+			free(c->book);
+		}
+		if (c->touched) {
+			free(c->touched);
+		}
+	}
 	if (sess != NULL) {
-		blpapi_Session_stop(sess);
-		blpapi_Session_destroy(sess);
-		sess = NULL;
+		free(sess);
+	}
+	if (sctx != NULL) {
+		free(sctx);
 	}
-	if (ctx.book) {
-		free(ctx.book);
+	if (ctx.ftab != NULL) {
+		free_fldtab(ctx.ftab);
 	}
+	if (ctx.topts != NULL) {
+		free(ctx.topts);
+	}
+	lat_prnt(&lat);
 
+	if (statp) {
+		rstat_fini();
+		free(stat_tops);
+	}
+	sopt_fini(&sopt);
 	yuck_free(argi);
 	return rc;
 }
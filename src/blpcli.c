@@ -45,16 +45,35 @@
 #include <signal.h>
 #include <setjmp.h>
 #include <errno.h>
+#include <limits.h>
+#include <inttypes.h>
 #include <sys/time.h>
 #include <time.h>
 #include <pthread.h>
 #include <blpapi_correlationid.h>
 #include <blpapi_element.h>
 #include <blpapi_event.h>
+#include <blpapi_eventdispatcher.h>
 #include <blpapi_message.h>
+#include <blpapi_name.h>
 #include <blpapi_request.h>
 #include <blpapi_session.h>
 #include <blpapi_subscriptionlist.h>
+#include "obuf.h"
+#include "fldtab.h"
+#include "fmt.h"
+#include "clk.h"
+#include "strv.h"
+#include "bin.h"
+#include "lat.h"
+#include "tcol.h"
+#include "ring.h"
+#include "ttab.h"
+#include "sopt.h"
+#include "topt.h"
+#include "dur.h"
+#include "rstat.h"
+#include "rcache.h"
 #include "nifty.h"
 
 #include "blpcli.yucc"
@@ -73,11 +92,215 @@ struct ctx_s {
 	} st;
 	const yuck_t *argi;
 	int rc;
+
+	/* this session's share of the topics, see strhash() */
+	size_t shard;
+	size_t nshard;
+
+	/* output buffer, flushed once per event */
+	obuf_t out;
+
+	/* bulk requests, chunk size, window and their schedule */
+	blpapi_Service_t *svc;
+	size_t chunk;
+	size_t win;
+	struct rsch_s {
+		size_t nreq;
+		size_t nsent;
+		size_t ndone;
+		size_t nfail;
+		size_t win;
+		int(*send)(blpapi_Session_t*, struct ctx_s*, size_t);
+		/* called once a request is done or has failed, may be NULL */
+		void(*fini)(struct ctx_s*, size_t);
+		enum {
+			RQ_PEND,
+			RQ_SENT,
+			RQ_DONE,
+			RQ_FAIL,
+		} *st;
+	} rsch;
+	/* name handles of the field list, resolved at subscribe time */
+	fldtab_t ftab;
+	/* records on their way to the writer thread, NULL if we write
+	 * from the blpapi thread, shared by all sessions, one ring per
+	 * dispatcher thread (plus a spare) if there are several */
+	ring_t *ring;
+	size_t nring;
+	/* nanoseconds records of several rings are held back for */
+	uint64_t hold;
+	/* number of dispatcher threads, 0 for blpapi's own */
+	size_t ndisp;
+	/* last values per topic, written once per interval, shared by all
+	 * sessions, NULL if we don't conflate */
+	struct cfl_s {
+		pthread_mutex_t lk;
+		/* interval in nanoseconds */
+		uint64_t ivl;
+		/* a struct rrec_s per topic, and a copy for the writer */
+		size_t slotz;
+		size_t nslot;
+		char *slot;
+		char *snap;
+		/* topics updated this interval, in order of first update */
+		uint8_t *dirtp;
+		size_t *dirt;
+		size_t ndirt;
+		size_t nupd;
+		size_t nout;
+		/* whether we only conflate while a session is slow (see
+		 * --slow), how many are, and whether we're conflating,
+		 * set and cleared under LK */
+		bool autop;
+		size_t nslow;
+		bool onp;
+	} *cfl;
+
+	/* time range [FROM, TILL) and span of requests, seconds since epoch */
+	struct rng_s {
+		int64_t from;
+		int64_t till;
+		int64_t span;
+		size_t nspan;
+	} rng;
+	/* bar length (in minutes) and event type of bar requests */
+	struct {
+		long ivl;
+		const char *evt;
+	} bars;
+	/* event types and output directory of tick requests, and one
+	 * tick buffer per request in flight */
+	struct {
+		char *const *evts;
+		size_t nevt;
+		const char *dir;
+		size_t nslot;
+		struct tslot_s {
+			tcol_t tc;
+			/* the request (plus 1) the slot serves, 0 if idle */
+			size_t k;
+		} *slot;
+		size_t nfile;
+		size_t ntick;
+	} ticks;
+
+	/* topics and fields, from the command line and from files */
+	struct strv_s tops;
+	struct strv_s flds;
+	/* subscription options for all topics, and the comma-separated
+	 * options of every topic (or NULL), see topt_split() */
+	char *const *gopts;
+	size_t ngopt;
+	char **topts;
+	/* topics we want subscribed, shared by all sessions */
+	uint8_t *subp;
+	/* how full blpapi's queue for this session got */
+	struct sopt_qst_s qst;
+
+	/* subscription batches and reconnects, guarded by sublk */
+	struct {
+		/* whether batches can go out, and the next topic to send */
+		bool gop;
+		bool donep;
+		size_t next;
+		size_t nsub;
+		size_t nown;
+		/* set when the session has died, and attempts to revive it */
+		bool deadp;
+		unsigned int ntry;
+		/* monotonic time of the next attempt and of the death */
+		uint64_t due;
+		uint64_t t0;
+	} rec;
 };
 
 #define LOG(x)		fputs(x, stderr)
 #define LOGF(fmt, ...)	fprintf(stderr, fmt, __VA_ARGS__)
 
+/* output chunks, their number and the flush thresholds */
+#define OBUF_CHNZ	(64U * 1024U)
+#define OBUF_NCHN	(64U)
+#define OBUF_HIWAT	(4U * OBUF_CHNZ)
+#define OBUF_MAXLAT	(100000000ULL)
+
+/* securities per request and requests in flight, by default */
+#define DFLT_CHUNK	(100U)
+#define DFLT_WIN	(4U)
+/* how long cached reference data keeps, see --ttl */
+#define DFLT_TTL	(86400000000000LL)
+/* days of history per request, by default */
+#define DFLT_SPAN	(365)
+/* minutes per bar and minutes of bars per request, by default */
+#define DFLT_BARS_IVL	(1)
+#define DFLT_BARS_SPAN	(7 * 1440)
+/* bar fields, in the absence of -F */
+static const char *const bars_flds[] = {
+	"open", "high", "low", "close", "volume", "numEvents",
+};
+/* ticks per block of tick files */
+#define TICK_CAP	(65536U)
+/* nanoseconds the writer thread naps when its ring runs dry */
+#define WRT_NAP		(100000L)
+/* longest nap of the conflating writer, so it notices when to quit */
+#define CFL_NAP		(10000000U)
+/* topics per subscription batch, and nanoseconds between batches */
+#define SUB_BATCH	(1000U)
+#define SUB_TICK	(10000000L)
+/* first and longest nanoseconds between reconnect attempts */
+#define REC_NAP		(100000000ULL)
+#define REC_MAXNAP	(30000000000ULL)
+/* conflation interval of --slow=conflate */
+#define SLOW_IVL	(100000000U)
+/* topics --control can add on top of those from the command line */
+#define CTL_ROOM	(65536U)
+/* slots per ring, in the absence of --ring */
+#define DFLT_RING	(16384U)
+/* nanoseconds by which the receive times in different rings may be
+ * out of order, that's how long records wait for older ones */
+#define WRT_HOLD	(1000000U)
+
+/* decimals to print floats with, or -1 for shortest round-trip */
+static int prec = -1;
+/* whether to stamp every message rather than every event */
+static bool stamp_msg_p;
+/* whether to write binary records (see bin.h) rather than text */
+static bool bin_out_p;
+/* whether to print bulk fields of get in rows of their own */
+static bool bulk_rows_p;
+/* reference data cache of get, see --cache, and how long values keep */
+static rcache_t cache;
+static int64_t cache_ttl = DFLT_TTL;
+/* what to do while blpapi warns of a slow consumer, see --slow */
+static enum {
+	SLOW_BLOCK,
+	SLOW_DROP,
+	SLOW_CFL,
+} slow_pol;
+/* latency histograms, printed on SIGUSR1 and at exit */
+static struct lat_s lat;
+/* servers, queue sizes and timeouts of every session */
+static struct sopt_s sopt;
+/* whether to count things, see --stats, and per-topic sums */
+static bool statp;
+static uint64_t *stat_tops;
+/* counters and time of the previous line on stderr (0) and
+ * of the previous snapshot off the socket (1), rates are since then */
+static struct rstat_s stat_prev[2U];
+static uint64_t stat_tprev[2U];
+/* serialises latency accounting of several callback threads */
+static pthread_mutex_t latlk = PTHREAD_MUTEX_INITIALIZER;
+/* tells the writer thread to write what's left and quit */
+static bool wrt_quit;
+/* serialises subscription batches and changes made by --control */
+static pthread_mutex_t sublk = PTHREAD_MUTEX_INITIALIZER;
+/* whether we're shutting down, sessions terminating are ours then */
+static bool endp;
+/* rings claimed by dispatcher threads so far, and this thread's one */
+static size_t nclaim;
+static __thread ring_t self;
+/* records the writer merged in after newer ones, see wrt_loop() */
+static size_t nlate;
+
 
 static __attribute__((format(printf, 1, 2))) void
 error(const char *fmt, ...)
@@ -107,6 +330,8 @@ block_sigs(void)
 	sigaddset(fatal_signal_set, SIGTERM);
 	sigaddset(fatal_signal_set, SIGXCPU);
 	sigaddset(fatal_signal_set, SIGXFSZ);
+	sigaddset(fatal_signal_set, SIGUSR1);
+	sigaddset(fatal_signal_set, SIGUSR2);
 	(void)pthread_sigmask(SIG_BLOCK, fatal_signal_set, (sigset_t*)NULL);
 	return;
 }
@@ -124,39 +349,165 @@ unblock_sigs(void)
 static size_t
 dt_strf_d(char *restrict buf, size_t bsz, int days_since_epoch)
 {
-	const unsigned int bas = 19359U/*#days between 1917-01-00 and epoch*/;
-	unsigned int epo = days_since_epoch + bas;
+/* days since epoch to YYYY-MM-DD, the inverse of dt_strp_d() */
+	const unsigned int epo = days_since_epoch + 719468/*0000-03-01*/;
+	const unsigned int doe = epo % 146097U;
+	const unsigned int yoe =
+		(doe - doe / 1460U + doe / 36524U - doe / 146096U) / 365U;
+	const unsigned int doy = doe - (365U * yoe + yoe / 4U - yoe / 100U);
+	/* months start in March, so leap days come last */
+	const unsigned int mp = (5U * doy + 2U) / 153U;
 	unsigned int y, m, d;
-	unsigned int tmp;
-
-	/* start with a guess */
-	y = epo / 365U;
-	tmp = y * 365U + y / 4U;
-	if (UNLIKELY(tmp >= epo)) {
-		y--;
-		tmp = y * 365U + y / 4U;
-	}
-	/* repurpose tmp to hold the doy */
-	tmp = epo - tmp;
-	/* now the trimester algo to go from doy to m+d */
-	if ((tmp -= 1U + !(y % 4U)/*__leapp(y)*/) < 59U) {
-		/* 3rd trimester */
-		tmp += !(y % 4U);
-	} else if ((tmp += 2U) < 153U + 61U) {
-		/* 1st trimester */
-		;
+
+	if (UNLIKELY(bsz < 11U)) {
+		return 0U;
+	}
+	d = doy - (153U * mp + 2U) / 5U + 1U;
+	m = mp < 10U ? mp + 3U : mp - 9U;
+	y = (epo / 146097U) * 400U + yoe + (m <= 2U);
+
+	fmt_u32_pad(buf + 0U, y, 4U);
+	buf[4U] = '-';
+	fmt_u32_pad(buf + 5U, m, 2U);
+	buf[7U] = '-';
+	fmt_u32_pad(buf + 8U, d, 2U);
+	buf[10U] = '\0';
+	return 10U;
+}
+
+static size_t
+dt_strf_dc(char *restrict buf, size_t bsz, int days_since_epoch)
+{
+/* like dt_strf_d() but YYYYMMDD, as wanted by the refdata service */
+	if (UNLIKELY(!dt_strf_d(buf, bsz, days_since_epoch))) {
+		return 0U;
+	}
+	memmove(buf + 4U, buf + 5U, 2U);
+	memmove(buf + 6U, buf + 8U, 3U);
+	return 8U;
+}
+
+static int
+dt_days(unsigned int y, unsigned int m, unsigned int d)
+{
+/* days since epoch of Y-M-D, the inverse of dt_strf_d() */
+	/* years start in March, so leap days come last */
+	y -= m <= 2U;
+	m = m > 2U ? m - 3U : m + 9U;
+	with (unsigned int yoe = y % 400U) {
+		const unsigned int doy = (153U * m + 2U) / 5U + d - 1U;
+		const unsigned int doe = yoe * 365U + yoe / 4U - yoe / 100U + doy;
+
+		return (y / 400U) * 146097 + doe - 719468;
+	}
+	return INT_MIN;
+}
+
+static int
+dt_strp_d(const char *str, char **on)
+{
+/* read YYYY-MM-DD or YYYYMMDD, return days since epoch or INT_MIN,
+ * ON is set to the first character after the date */
+	unsigned int y, m, d;
+
+	y = strtoul(str, on, 10);
+	if (**on == '-') {
+		m = strtoul(*on + 1, on, 10);
+		if (*(*on)++ != '-') {
+			return INT_MIN;
+		}
+		d = strtoul(*on, on, 10);
+	} else if (*on - str == 8) {
+		d = y % 100U;
+		m = (y /= 100U) % 100U;
+		y /= 100U;
 	} else {
-		/* 2nd trimester */
-		tmp += 30U;
+		return INT_MIN;
+	}
+	if (y < 1900U || y > 2099U || !m || m > 12U || !d || d > 31U) {
+		return INT_MIN;
+	}
+	return dt_days(y, m, d);
+}
+
+static int64_t
+dt_strp_s(const char *str, bool *timep)
+{
+/* read a date as in dt_strp_d(), optionally followed by THH:MM[:SS],
+ * return seconds since epoch or INT64_MIN, TIMEP is set if there
+ * was a time */
+	unsigned int H, M, S = 0U;
+	char *on;
+	int d;
+
+	if ((d = dt_strp_d(str, &on)) == INT_MIN) {
+		return INT64_MIN;
+	} else if (!(*timep = *on != '\0')) {
+		return d * 86400LL;
+	} else if (*on != 'T' && *on != ' ') {
+		return INT64_MIN;
+	}
+	H = strtoul(on + 1, &on, 10);
+	if (*on++ != ':') {
+		return INT64_MIN;
+	}
+	M = strtoul(on, &on, 10);
+	if (*on == ':') {
+		S = strtoul(on + 1, &on, 10);
+	}
+	if (*on || H > 23U || M > 59U || S > 59U) {
+		return INT64_MIN;
+	}
+	return d * 86400LL + H * 3600U + M * 60U + S;
+}
+
+static inline int
+dt_day(int64_t sec)
+{
+/* day (since epoch) of SEC seconds since epoch, rounding down */
+	return sec >= 0 ? sec / 86400 : -((86399 - sec) / 86400);
+}
+
+static size_t
+dt_strf_s(char *restrict buf, size_t bsz, int64_t sec)
+{
+/* seconds since epoch to YYYY-MM-DDTHH:MM:SS */
+	const int d = dt_day(sec);
+
+	if (UNLIKELY(bsz < 20U)) {
+		return 0U;
+	}
+	dt_strf_d(buf, bsz, d);
+	buf[10U] = 'T';
+	with (unsigned int tim = sec - d * 86400LL) {
+		fmt_u32_pad(buf + 11U, tim / 3600U, 2U);
+		buf[13U] = ':';
+		fmt_u32_pad(buf + 14U, tim / 60U % 60U, 2U);
+		buf[16U] = ':';
+		fmt_u32_pad(buf + 17U, tim % 60U, 2U);
 	}
+	buf[19U] = '\0';
+	return 19U;
+}
 
-	m = 2 * tmp / 61U;
-	d = 2 * tmp % 61U;
+static int64_t
+dt_hpdt_ns(const blpapi_HighPrecisionDatetime_t *hp)
+{
+/* nanoseconds since epoch of HP, missing parts count as zero */
+	const blpapi_Datetime_t *dt = &hp->datetime;
+	int64_t sec = 0;
+	int64_t ns = 0;
 
-	m = m + 1 - (m >= 7U);
-	d = d / 2 + 1U;
-	y += 1917U;
-	return snprintf(buf, bsz, "%04u-%02u-%02u", y, m, d);
+	if (dt->parts & BLPAPI_DATETIME_YEAR_PART) {
+		sec = dt_days(dt->year, dt->month, dt->day) * 86400LL;
+	}
+	if (dt->parts & BLPAPI_DATETIME_SECONDS_PART) {
+		sec += dt->hours * 3600U + dt->minutes * 60U + dt->seconds;
+	}
+	if (dt->parts & BLPAPI_DATETIME_FRACSECONDS_PART) {
+		ns = dt->milliSeconds * 1000000U + hp->picoseconds / 1000U;
+	}
+	return sec * 1000000000LL + ns;
 }
 
 static size_t
@@ -164,17 +515,265 @@ dt_strf_t(char *restrict buf, size_t bsz, unsigned int tim, unsigned int nsec)
 {
 	unsigned int M, S;
 
+	if (UNLIKELY(bsz < 20U)) {
+		return 0U;
+	}
 	S = tim % 60U;
 	tim /= 60U;
 	M = tim % 60U;
 	tim /= 60U;
-	return snprintf(buf, bsz, "%02u:%02u:%02u.%09uZ", tim, M, S, nsec);
+	fmt_u32_pad(buf + 0U, tim, 2U);
+	buf[2U] = ':';
+	fmt_u32_pad(buf + 3U, M, 2U);
+	buf[5U] = ':';
+	fmt_u32_pad(buf + 6U, S, 2U);
+	buf[8U] = '.';
+	fmt_u32_pad(buf + 9U, nsec, 9U);
+	buf[18U] = 'Z';
+	buf[19U] = '\0';
+	return 19U;
+}
+
+
+/* receive stamps, YYYY-MM-DDTHH:MM:SS.nnnnnnnnnZ */
+struct stmp_s {
+	char buf[32U];
+	size_t len;
+	/* the second (since epoch) BUF currently holds */
+	uint64_t sec;
+};
+
+static void
+stmp_upd(struct stmp_s *st, uint64_t ns)
+{
+	const uint64_t sec = ns / 1000000000U;
+	const unsigned int nsec = ns % 1000000000U;
+
+	if (LIKELY(sec == st->sec)) {
+		/* just the nanoseconds then */
+		fmt_u32_pad(st->buf + 20U, nsec, 9U);
+		return;
+	} else if (UNLIKELY(sec / 86400U != st->sec / 86400U)) {
+		/* oh no, we need to work a bit */
+		dt_strf_d(st->buf, sizeof(st->buf), sec / 86400U);
+		st->buf[10U] = 'T';
+	}
+	/* time-of-day and nanos */
+	st->len = 11U + dt_strf_t(
+		st->buf + 11U, sizeof(st->buf) - 11U, sec % 86400U, nsec);
+	st->sec = sec;
+	return;
+}
+
+
+static int
+rng_init(struct rng_s *r, const char *from, const char *till,
+	 const char *span, int64_t unit, long dflt_span)
+{
+/* set up R from the command-line strings FROM, TILL and SPAN,
+ * the span is given in UNITs (seconds), TILL is inclusive if it's
+ * a date, and defaults to the current time rounded up to UNIT */
+	bool timep;
+	long n;
+
+	if (from == NULL) {
+		errno = 0, error("\
+Error: need a start date, see --from");
+		return -1;
+	} else if ((r->from = dt_strp_s(from, &timep)) == INT64_MIN) {
+		errno = 0, error("\
+Error: cannot read date `%s'", from);
+		return -1;
+	}
+	if (till == NULL) {
+		r->till = (time(NULL) / unit + 1) * unit;
+	} else if ((r->till = dt_strp_s(till, &timep)) == INT64_MIN) {
+		errno = 0, error("\
+Error: cannot read date `%s'", till);
+		return -1;
+	} else if (!timep) {
+		/* the whole day then */
+		r->till += 86400;
+	}
+	if (UNLIKELY(r->till <= r->from)) {
+		errno = 0, error("\
+Error: end date is before start date");
+		return -1;
+	}
+	n = dflt_span;
+	if (span && (n = strtol(span, NULL, 10)) <= 0) {
+		errno = 0, error("\
+Error: span must be positive");
+		return -1;
+	}
+	r->span = n * unit;
+	r->nspan = (r->till - r->from + r->span - 1) / r->span;
+	return 0;
+}
+
+static inline int64_t
+rng_beg(const struct rng_s *r, size_t i)
+{
+/* start of the I-th span */
+	return r->from + (int64_t)i * r->span;
+}
+
+static inline int64_t
+rng_end(const struct rng_s *r, size_t i)
+{
+/* end (exclusive) of the I-th span */
+	const int64_t end = rng_beg(r, i) + r->span;
+	return end < r->till ? end : r->till;
 }
 
 
+/* element names of the refdata schema, resolved once */
+enum {
+	RN_RESPONSE_ERROR,
+	RN_SECURITY_DATA,
+	RN_SECURITY,
+	RN_SECURITY_ERROR,
+	RN_FIELD_DATA,
+	RN_FIELD_EXCEPTIONS,
+	RN_FIELD_ID,
+	RN_ERROR_INFO,
+	RN_MESSAGE,
+	RN_DATE,
+	RN_BAR_DATA,
+	RN_BAR_TICK_DATA,
+	RN_TIME,
+	RN_TICK_DATA,
+	NRN
+};
+
+static const char *const rnstr[NRN] = {
+	[RN_RESPONSE_ERROR] = "responseError",
+	[RN_SECURITY_DATA] = "securityData",
+	[RN_SECURITY] = "security",
+	[RN_SECURITY_ERROR] = "securityError",
+	[RN_FIELD_DATA] = "fieldData",
+	[RN_FIELD_EXCEPTIONS] = "fieldExceptions",
+	[RN_FIELD_ID] = "fieldId",
+	[RN_ERROR_INFO] = "errorInfo",
+	[RN_MESSAGE] = "message",
+	[RN_DATE] = "date",
+	[RN_BAR_DATA] = "barData",
+	[RN_BAR_TICK_DATA] = "barTickData",
+	[RN_TIME] = "time",
+	[RN_TICK_DATA] = "tickData",
+};
+
+static blpapi_Name_t *rnam[NRN];
+
+/* elements of a tick, in the order of the field table of tick requests */
+enum {
+	TF_TIME,
+	TF_TYPE,
+	TF_VALUE,
+	TF_SIZE,
+	TF_COND_CODES,
+	NTF
+};
+
+static const char *const tick_flds[NTF] = {
+	[TF_TIME] = "time",
+	[TF_TYPE] = "type",
+	[TF_VALUE] = "value",
+	[TF_SIZE] = "size",
+	[TF_COND_CODES] = "conditionCodes",
+};
+
+static void
+init_rnam(void)
+{
+	for (size_t i = 0U; i < NRN; i++) {
+		if (rnam[i] == NULL) {
+			rnam[i] = blpapi_Name_create(rnstr[i]);
+		}
+	}
+	return;
+}
+
+static void
+fini_rnam(void)
+{
+	for (size_t i = 0U; i < NRN; i++) {
+		if (rnam[i] != NULL) {
+			blpapi_Name_destroy(rnam[i]);
+			rnam[i] = NULL;
+		}
+	}
+	return;
+}
+
+
+static void
+dump_f64(obuf_t whither, double x)
+{
+	char *p = obuf_prep(whither, FMT_FLT_MAXLEN);
+
+	if (prec < 0) {
+		obuf_adv(whither, fmt_f64(p, x));
+	} else {
+		obuf_adv(whither, fmt_f64_fixed(p, x, prec));
+	}
+	return;
+}
+
+static void
+dump_hpdt(obuf_t whither, const blpapi_HighPrecisionDatetime_t *hp)
+{
+	const blpapi_Datetime_t *dt = &hp->datetime;
+	char *p = obuf_prep(whither, 32U);
+	size_t n = 0U;
+
+	if (dt->parts & BLPAPI_DATETIME_YEAR_PART) {
+		n += fmt_u32_pad(p + n, dt->year, 4U);
+		p[n++] = '-';
+		n += fmt_u32_pad(p + n, dt->month, 2U);
+		p[n++] = '-';
+		n += fmt_u32_pad(p + n, dt->day, 2U);
+		if (dt->parts & BLPAPI_DATETIME_TIME_PART) {
+			p[n++] = 'T';
+		}
+	}
+	if (dt->parts & BLPAPI_DATETIME_SECONDS_PART) {
+		n += fmt_u32_pad(p + n, dt->hours, 2U);
+		p[n++] = ':';
+		n += fmt_u32_pad(p + n, dt->minutes, 2U);
+		p[n++] = ':';
+		n += fmt_u32_pad(p + n, dt->seconds, 2U);
+		if (dt->parts & BLPAPI_DATETIME_FRACSECONDS_PART) {
+			p[n++] = '.';
+		}
+	}
+	if (dt->parts & BLPAPI_DATETIME_FRACSECONDS_PART) {
+		n += fmt_u32_pad(p + n, dt->milliSeconds, 3U);
+		n += fmt_u32_pad(p + n, hp->picoseconds, 9U);
+	}
+	obuf_adv(whither, n);
+	return;
+}
+
+/* deepest nesting of bulk elements we print */
+#define NEST_DEPTH	(16U)
+
+/* frames of the walk over nested elements */
+struct nest_s {
+	const blpapi_Element_t *e;
+	size_t i;
+	size_t n;
+	/* datatype of E and whether it's an array */
+	int dt;
+	bool arrp;
+};
+
+static int dump_nest(const blpapi_Element_t *e, obuf_t whither);
+
 static int
-dump_Element(const blpapi_Element_t *e, FILE *whither)
+dump_val(const blpapi_Element_t *e, size_t i, obuf_t whither)
 {
+/* print the I-th value of E */
 	int rc = 0;
 
 	switch (blpapi_Element_datatype(e)) {
@@ -186,64 +785,69 @@ dump_Element(const blpapi_Element_t *e, FILE *whither)
 			blpapi_Datetime_t dt;
 			blpapi_HighPrecisionDatetime_t hp;
 		} tmp;
+		blpapi_Element_t *sub;
+		char *p;
 
 	case BLPAPI_DATATYPE_INT32:
-		rc = blpapi_Element_getValueAsInt32(e, &tmp.i32, 0U);
-		fprintf(whither, "%i", tmp.i32);
+		if ((rc = blpapi_Element_getValueAsInt32(e, &tmp.i32, i))) {
+			break;
+		}
+		p = obuf_prep(whither, FMT_INT_MAXLEN);
+		obuf_adv(whither, fmt_i64(p, tmp.i32));
 		break;
 	case BLPAPI_DATATYPE_INT64:
-		rc = blpapi_Element_getValueAsInt64(e, &tmp.i64, 0U);
-		fprintf(whither, "%lli", tmp.i64);
+		if ((rc = blpapi_Element_getValueAsInt64(e, &tmp.i64, i))) {
+			break;
+		}
+		p = obuf_prep(whither, FMT_INT_MAXLEN);
+		obuf_adv(whither, fmt_i64(p, tmp.i64));
 		break;
 	case BLPAPI_DATATYPE_FLOAT32:
-		rc = blpapi_Element_getValueAsFloat32(e, &tmp.f32, 0U);
-		fprintf(whither, "%f", tmp.f32);
+		if ((rc = blpapi_Element_getValueAsFloat32(e, &tmp.f32, i))) {
+			break;
+		} else if (prec >= 0) {
+			dump_f64(whither, tmp.f32);
+			break;
+		}
+		p = obuf_prep(whither, FMT_FLT_MAXLEN);
+		obuf_adv(whither, fmt_f32(p, tmp.f32));
 		break;
 	case BLPAPI_DATATYPE_FLOAT64:
-		rc = blpapi_Element_getValueAsFloat64(e, &tmp.f64, 0U);
-		fprintf(whither, "%f", tmp.f64);
+		if ((rc = blpapi_Element_getValueAsFloat64(e, &tmp.f64, i))) {
+			break;
+		}
+		dump_f64(whither, tmp.f64);
 		break;
 	case BLPAPI_DATATYPE_DATETIME:
 	case BLPAPI_DATATYPE_DATE:
 	case BLPAPI_DATATYPE_TIME:
 		rc = blpapi_Element_getValueAsHighPrecisionDatetime(
-			e, &tmp.hp, 0U);
+			e, &tmp.hp, i);
 		if (rc) {
 			break;
 		}
-		if (tmp.hp.datetime.parts & BLPAPI_DATETIME_YEAR_PART) {
-			fprintf(whither, "%04hu-%02hhu-%02hhu",
-				tmp.hp.datetime.year,
-				tmp.hp.datetime.month,
-				tmp.hp.datetime.day);
-			if (tmp.hp.datetime.parts & BLPAPI_DATETIME_TIME_PART) {
-				fputc('T', whither);
-			}
-		}
-		if (tmp.hp.datetime.parts & BLPAPI_DATETIME_SECONDS_PART) {
-			fprintf(whither, "%02hhu:%02hhu:%02hhu",
-				tmp.hp.datetime.hours,
-				tmp.hp.datetime.minutes,
-				tmp.hp.datetime.seconds);
-			if (tmp.hp.datetime.parts &
-			    BLPAPI_DATETIME_FRACSECONDS_PART) {
-				fputc('.', whither);
-			}
-		}
-		if (tmp.hp.datetime.parts & BLPAPI_DATETIME_FRACSECONDS_PART) {
-			fprintf(whither, "%03hu%09u",
-				tmp.hp.datetime.milliSeconds,
-				tmp.hp.picoseconds);
-		}
+		dump_hpdt(whither, &tmp.hp);
 		break;
 	case BLPAPI_DATATYPE_STRING:
+	case BLPAPI_DATATYPE_ENUMERATION:
 		with (const char *str[1U]) {
-			rc = blpapi_Element_getValueAsString(e, str, 0U);
+			rc = blpapi_Element_getValueAsString(e, str, i);
 			if (rc) {
 				break;
 			}
-			fputs(*str, whither);
+			obuf_puts(whither, *str);
+		}
+		break;
+	case BLPAPI_DATATYPE_SEQUENCE:
+	case BLPAPI_DATATYPE_CHOICE:
+		if (!blpapi_Element_isArray(e)) {
+			rc = dump_nest(e, whither);
+			break;
+		} else if ((rc = blpapi_Element_getValueAsElement(e, &sub, i))) {
+			break;
 		}
+		/* just the I-th of the array */
+		rc = dump_nest(sub, whither);
 		break;
 	default:
 		rc = -1;
@@ -252,199 +856,2128 @@ dump_Element(const blpapi_Element_t *e, FILE *whither)
 	return rc;
 }
 
-static void
-dump_rsp(const yuck_t argi[static 1U], blpapi_Message_t *UNUSED(msg))
+static size_t
+nest_enter(struct nest_s *stk, size_t d, const blpapi_Element_t *e,
+	   obuf_t whither)
 {
-	char *const *UNUSED(tops) = argi->topic_args;
-	char *const *UNUSED(flds) = argi->field_args;
+/* print scalar E, or open complex or array E as frame D of STK,
+ * return the new depth */
+	const int dt = blpapi_Element_datatype(e);
+	bool arrp;
 
-	fputc('\n', stdout);
-	return;
+	if (blpapi_Element_isNull(e)) {
+		return d;
+	} else if (!(arrp = blpapi_Element_isArray(e)) &&
+		   dt != BLPAPI_DATATYPE_SEQUENCE &&
+		   dt != BLPAPI_DATATYPE_CHOICE) {
+		dump_val(e, 0U, whither);
+		return d;
+	}
+	obuf_putc(whither, arrp ? '[' : '{');
+	if (UNLIKELY(d >= NEST_DEPTH)) {
+		/* too deep for us */
+		obuf_puts(whither, "...");
+		obuf_putc(whither, arrp ? ']' : '}');
+		return d;
+	}
+	stk[d].e = e;
+	stk[d].i = 0U;
+	stk[d].dt = dt;
+	stk[d].arrp = arrp;
+	if (arrp) {
+		stk[d].n = blpapi_Element_numValues(e);
+	} else if (dt == BLPAPI_DATATYPE_SEQUENCE) {
+		stk[d].n = blpapi_Element_numElements(e);
+	} else {
+		/* choices have just the one selection */
+		stk[d].n = 1U;
+	}
+	return d + 1U;
 }
 
-static void
-dump_pub(const yuck_t argi[static 1U], blpapi_Message_t *msg)
+static int
+dump_nest(const blpapi_Element_t *e, obuf_t whither)
 {
-	char *const *tops = argi->topic_args;
-	char *const *flds = argi->field_args;
-	const size_t nflds = argi->field_nargs;
-	blpapi_Element_t *els;
-	blpapi_CorrelationId_t cid;
-	size_t ix;
+/* print complex or array E as nested text, sequences and choices as
+ * {name=value,...} and arrays as [value,...], walking an explicit stack
+ * so bulk fields of any size cost neither recursion nor allocations */
+	struct nest_s stk[NEST_DEPTH];
+	size_t d;
 
-	cid = blpapi_Message_correlationId(msg, 0);
-	if (UNLIKELY(cid.valueType != BLPAPI_CORRELATION_TYPE_INT)) {
-		goto nop;
+	for (d = nest_enter(stk, 0U, e, whither); d > 0U;) {
+		struct nest_s *f = stk + d - 1U;
+		const size_t i = f->i++;
+		blpapi_Element_t *c;
+
+		if (f->i > f->n) {
+			obuf_putc(whither, f->arrp ? ']' : '}');
+			d--;
+			continue;
+		} else if (i) {
+			obuf_putc(whither, ',');
+		}
+
+		if (f->arrp && f->dt != BLPAPI_DATATYPE_SEQUENCE &&
+		    f->dt != BLPAPI_DATATYPE_CHOICE) {
+			/* array of scalars */
+			dump_val(f->e, i, whither);
+			continue;
+		} else if (f->arrp) {
+			if (blpapi_Element_getValueAsElement(f->e, &c, i)) {
+				continue;
+			}
+		} else {
+			if (f->dt == BLPAPI_DATATYPE_CHOICE
+			    ? blpapi_Element_getChoice(f->e, &c)
+			    : blpapi_Element_getElementAt(f->e, &c, i)) {
+				continue;
+			}
+			obuf_puts(whither, blpapi_Element_nameString(c));
+			obuf_putc(whither, '=');
+		}
+		d = nest_enter(stk, d, c, whither);
 	}
-	/* otherwise CID holds the index into TOPS */
-	if (UNLIKELY((ix = cid.value.intValue) <= 0)) {
-		goto nop;
+	return 0;
+}
+
+static int
+dump_Element(const blpapi_Element_t *e, obuf_t whither)
+{
+	if (UNLIKELY(blpapi_Element_isArray(e))) {
+		return dump_nest(e, whither);
+	}
+	return dump_val(e, 0U, whither);
+}
+
+static blpapi_Element_t*
+get_el(const blpapi_Element_t *e, unsigned int rn)
+{
+	blpapi_Element_t *res;
+
+	if (!blpapi_Element_hasElementEx(e, NULL, rnam[rn], 1, 0)) {
+		return NULL;
+	} else if (blpapi_Element_getElement(e, &res, NULL, rnam[rn])) {
+		return NULL;
 	}
+	return res;
+}
 
-	ix--;
-	fputs(tops[ix], stdout);
+static const char*
+get_str(const blpapi_Element_t *e, unsigned int rn)
+{
+	blpapi_Element_t *sub;
+	const char *res;
 
-	if (UNLIKELY((els = blpapi_Message_elements(msg)) == NULL)) {
-		goto nop;
+	if ((sub = get_el(e, rn)) == NULL) {
+		return NULL;
+	} else if (blpapi_Element_getValueAsString(sub, &res, 0U)) {
+		return NULL;
 	}
+	return res;
+}
 
-	for (size_t i = 0U; i < nflds; i++) {
-		blpapi_Element_t *f;
+static const char*
+get_errmsg(const blpapi_Element_t *e)
+{
+	const char *msg = get_str(e, RN_MESSAGE);
+	return msg != NULL ? msg : "unknown error";
+}
+
+static void
+dump_fexc(const char *sec, const blpapi_Element_t *fex)
+{
+	const size_t n = blpapi_Element_numValues(fex);
+
+	for (size_t i = 0U; i < n; i++) {
+		blpapi_Element_t *x;
+		blpapi_Element_t *ei;
+		const char *fid;
 
-		fputc('\t', stdout);
-		if (!blpapi_Element_getElement(els, &f, flds[i], NULL)) {
-			dump_Element(f, stdout);
+		if (blpapi_Element_getValueAsElement(fex, &x, i)) {
+			continue;
+		} else if ((fid = get_str(x, RN_FIELD_ID)) == NULL) {
+			fid = "";
 		}
+		ei = get_el(x, RN_ERROR_INFO);
+		errno = 0, error("\
+Warning: %s %s: %s", sec, fid, ei ? get_errmsg(ei) : "unknown error");
 	}
-nop:
-	fputc('\n', stdout);
 	return;
 }
 
 static void
-dump_evs(const struct ctx_s ctx[static 1U], blpapi_MessageIterator_t *iter)
+dump_bulk(const struct ctx_s ctx[static 1U], const struct stmp_s *st,
+	  const char *sec, size_t col, const blpapi_Element_t *blk)
 {
-	static int today;
-	static char stmp[32U];
-	blpapi_Message_t *msg;
-	const yuck_t *argi = ctx->argi;
+/* print array BLK of column COL one row per value, values that are
+ * sequences have their elements spread over the row's columns */
+	const size_t nrow = blpapi_Element_numValues(blk);
+	const int dt = blpapi_Element_datatype(blk);
+	obuf_t out = ctx->out;
 
-	with (struct timespec tsp) {
-		int tspd;
-		unsigned int tspt;
+	for (size_t i = 0U; i < nrow; i++) {
+		blpapi_Element_t *row;
 
-		clock_gettime(CLOCK_REALTIME, &tsp);
-		tspd = tsp.tv_sec / 86400;
-		tspt = tsp.tv_sec % 86400;
-		if (UNLIKELY(today < tspd)) {
-			/* oh no, we need to work a bit */
-			today = tspd;
-			dt_strf_d(stmp, sizeof(stmp), tspd);
-			stmp[10U] = 'T';
-		}
-		/* always fill in time-of-day and nanos */
-		dt_strf_t(stmp + 11U, sizeof(stmp) - 11U, tspt, tsp.tv_nsec);
-	}
+		obuf_write(out, st->buf, st->len);
+		obuf_putc(out, '\t');
+		obuf_puts(out, sec);
+		obuf_putc(out, '\t');
+		obuf_puts(out, ctx->flds.v[col]);
+		obuf_putc(out, '\t');
+		if (dt != BLPAPI_DATATYPE_SEQUENCE) {
+			dump_val(blk, i, out);
+		} else if (LIKELY(!blpapi_Element_getValueAsElement(
+					  blk, &row, i))) {
+			const size_t nel = blpapi_Element_numElements(row);
 
-	while (!blpapi_MessageIterator_next(iter, &msg)) {
-		fputs(stmp, stdout);
-		fputc('\t', stdout);
-		switch (argi->cmd) {
-		case BLPCLI_CMD_GET:
-			dump_rsp(argi, msg);
-			break;
-		case BLPCLI_CMD_SUB:
-			dump_pub(argi, msg);
-			break;
-		default:
-			fputc('\n', stdout);
-			break;
+			for (size_t j = 0U; j < nel; j++) {
+				blpapi_Element_t *e;
+
+				if (j) {
+					obuf_putc(out, '\t');
+				}
+				if (LIKELY(!blpapi_Element_getElementAt(
+						   row, &e, j))) {
+					dump_Element(e, out);
+				}
+			}
 		}
+		obuf_putc(out, '\n');
+		obuf_rec(out);
 	}
 	return;
 }
 
-
-static int
-svc_sta_get(blpapi_Session_t *s, const struct yuck_cmd_get_s argi[static 1U])
+static struct bin_dt_s bin_dt(const blpapi_HighPrecisionDatetime_t *hp);
+
+static blpapi_HighPrecisionDatetime_t
+hpdt_bin(const struct bin_dt_s *b)
 {
-	static const char svc_ref[] = "//blp/refdata";
-	blpapi_Service_t *svc;
-	blpapi_Request_t *req;
-	blpapi_Element_t *els;
-	blpapi_CorrelationId_t cid = {
-		.size = sizeof(cid),
-		.valueType = BLPAPI_CORRELATION_TYPE_INT,
-		.value.intValue = 1,
+/* the opposite of bin_dt(), as far as dump_hpdt() is concerned */
+	blpapi_HighPrecisionDatetime_t hp = {
+		.datetime = {
+			.year = b->year,
+			.month = b->mon,
+			.day = b->mday,
+			.hours = b->hour,
+			.minutes = b->min,
+			.seconds = b->sec,
+			.milliSeconds = b->nsec / 1000000U,
+		},
+		.picoseconds = b->nsec % 1000000U * 1000U,
 	};
-	int rc = 0;
 
-	if (UNLIKELY(blpapi_Session_openService(s, svc_ref))) {
-		errno = 0, error("\
-Error: cannot open service %s", svc_ref);
-		return -1;
+	if (b->parts & BIN_DT_DATE) {
+		hp.datetime.parts |= BLPAPI_DATETIME_DATE_PART;
 	}
+	if (b->parts & BIN_DT_TIME) {
+		hp.datetime.parts |= BLPAPI_DATETIME_TIME_PART;
+	}
+	if (b->parts & BIN_DT_FRAC) {
+		hp.datetime.parts |= BLPAPI_DATETIME_FRACSECONDS_PART;
+	}
+	return hp;
+}
 
-	blpapi_Session_getService(s, &svc, svc_ref);
-	blpapi_Service_createRequest(svc, &req, "ReferenceDataRequest");
-
-	if (UNLIKELY((els = blpapi_Request_elements(req)) == NULL)) {
-		errno = 0, error("\
-Error: cannot acquire request elements");
-		rc = -1;
-		goto out;
+static int
+cache_val(struct rcache_val_s *v, const blpapi_Element_t *e)
+{
+/* copy E's value to V, -1 for arrays and complex values, those are
+ * never cached */
+	if (blpapi_Element_isArray(e)) {
+		return -1;
 	}
+	switch (blpapi_Element_datatype(e)) {
+		blpapi_HighPrecisionDatetime_t hp;
+		blpapi_Int64_t i64;
+		const char *str;
 
-	with (blpapi_Element_t *secs) {
+	case BLPAPI_DATATYPE_INT32:
+	case BLPAPI_DATATYPE_INT64:
+		if (blpapi_Element_getValueAsInt64(e, &i64, 0U)) {
+			return -1;
+		}
+		v->v.i64 = i64;
+		v->vt = BIN_VT_I64;
+		break;
+	case BLPAPI_DATATYPE_FLOAT32:
+		if (blpapi_Element_getValueAsFloat32(e, &v->v.f32, 0U)) {
+			return -1;
+		}
+		v->vt = BIN_VT_F32;
+		break;
+	case BLPAPI_DATATYPE_FLOAT64:
+		if (blpapi_Element_getValueAsFloat64(e, &v->v.f64, 0U)) {
+			return -1;
+		}
+		v->vt = BIN_VT_F64;
+		break;
+	case BLPAPI_DATATYPE_DATETIME:
+	case BLPAPI_DATATYPE_DATE:
+	case BLPAPI_DATATYPE_TIME:
+		if (blpapi_Element_getValueAsHighPrecisionDatetime(
+			    e, &hp, 0U)) {
+			return -1;
+		}
+		v->v.dt = bin_dt(&hp);
+		v->vt = BIN_VT_DT;
+		break;
+	case BLPAPI_DATATYPE_STRING:
+	case BLPAPI_DATATYPE_ENUMERATION:
+		if (blpapi_Element_getValueAsString(e, &str, 0U)) {
+			return -1;
+		}
+		/* whole strings, unlike rval_get() */
+		v->v.str.s = str;
+		v->v.str.len = strlen(str);
+		v->vt = BIN_VT_STR;
+		break;
+	default:
+		return -1;
+	}
+	return 0;
+}
+
+static void
+cache_put(const char *sec, const char *fld, const blpapi_Element_t *f,
+	  uint64_t now)
+{
+/* remember field FLD of SEC as fetched at NOW, F is its value or NULL
+ * if SEC has none */
+	struct rcache_val_s v = {.fetched = now, .vt = BIN_VT_UNK};
+
+	if (f != NULL && cache_val(&v, f) < 0) {
+		/* so it's requested every time */
+		return;
+	} else if (UNLIKELY(rcache_put(cache, sec, fld, NULL, &v) < 0)) {
+		errno = 0, error("\
+Warning: cannot cache %s of %s", fld, sec);
+	}
+	return;
+}
+
+static void
+dump_cval(obuf_t whither, const struct rcache_val_s *v)
+{
+/* like dump_val() but for cached values */
+	char *p;
+
+	switch (v->vt) {
+	case BIN_VT_I64:
+		p = obuf_prep(whither, FMT_INT_MAXLEN);
+		obuf_adv(whither, fmt_i64(p, v->v.i64));
+		break;
+	case BIN_VT_F32:
+		if (prec >= 0) {
+			dump_f64(whither, v->v.f32);
+			break;
+		}
+		p = obuf_prep(whither, FMT_FLT_MAXLEN);
+		obuf_adv(whither, fmt_f32(p, v->v.f32));
+		break;
+	case BIN_VT_F64:
+		dump_f64(whither, v->v.f64);
+		break;
+	case BIN_VT_DT:
+		with (blpapi_HighPrecisionDatetime_t hp = hpdt_bin(&v->v.dt)) {
+			dump_hpdt(whither, &hp);
+		}
+		break;
+	case BIN_VT_STR:
+		obuf_write(whither, v->v.str.s, v->v.str.len);
+		break;
+	default:
+		break;
+	}
+	return;
+}
+
+static void
+dump_rsp(const struct ctx_s ctx[static 1U], const struct stmp_s *st,
+	 blpapi_Message_t *msg)
+{
+	const fldtab_t ft = ctx->ftab;
+	obuf_t out = ctx->out;
+	blpapi_Element_t *els;
+	blpapi_Element_t *sdat;
+	blpapi_Element_t *e;
+	/* when the values were fetched, as far as the cache goes */
+	const uint64_t now = cache != NULL ? clk_rt() : 0U;
+	size_t nsec;
+
+	if (UNLIKELY((els = blpapi_Message_elements(msg)) == NULL)) {
+		return;
+	} else if (UNLIKELY((e = get_el(els, RN_RESPONSE_ERROR)) != NULL)) {
+		errno = 0, error("\
+Error: request failed: %s", get_errmsg(e));
+		return;
+	} else if ((sdat = get_el(els, RN_SECURITY_DATA)) == NULL) {
+		return;
+	}
+
+	/* one row per security, in -F column order */
+	nsec = blpapi_Element_numValues(sdat);
+	for (size_t i = 0U; i < nsec; i++) {
+		blpapi_Element_t *cols[ft->nflds + 1U];
+		blpapi_Element_t *sd;
+		const char *sec;
+		/* whether to cache values, and fields without one */
+		bool cachep = cache != NULL;
+		bool nonep = cachep;
+
+		if (UNLIKELY(blpapi_Element_getValueAsElement(sdat, &sd, i))) {
+			continue;
+		} else if (UNLIKELY((sec = get_str(sd, RN_SECURITY)) == NULL)) {
+			sec = "";
+			cachep = false;
+		}
+		if (UNLIKELY((e = get_el(sd, RN_SECURITY_ERROR)) != NULL)) {
+			errno = 0, error("\
+Warning: %s: %s", sec, get_errmsg(e));
+			cachep = false;
+		}
+		if ((e = get_el(sd, RN_FIELD_EXCEPTIONS)) != NULL) {
+			dump_fexc(sec, e);
+			/* missing fields might be errors then */
+			nonep = false;
+		}
+		if ((e = get_el(sd, RN_FIELD_DATA)) != NULL) {
+			fldtab_scan(ft, cols, e);
+		} else {
+			memset(cols, 0, ft->nflds * sizeof(*cols));
+		}
+
+		obuf_write(out, st->buf, st->len);
+		obuf_putc(out, '\t');
+		obuf_puts(out, sec);
+		for (size_t j = 0U; j < ft->nflds; j++) {
+			blpapi_Element_t *f;
+
+			obuf_putc(out, '\t');
+			f = fldtab_el(ft, cols, j);
+			if (cachep && (f != NULL || nonep)) {
+				cache_put(sec, ft->flds[j], f, now);
+			}
+			if (f == NULL) {
+				continue;
+			} else if (bulk_rows_p && blpapi_Element_isArray(f)) {
+				/* comes in rows of its own */
+				continue;
+			}
+			dump_Element(f, out);
+		}
+		obuf_putc(out, '\n');
+		obuf_rec(out);
+
+		for (size_t j = 0U; bulk_rows_p && j < ft->nflds; j++) {
+			blpapi_Element_t *f;
+
+			if ((f = fldtab_el(ft, cols, j)) == NULL) {
+				continue;
+			} else if (!blpapi_Element_isArray(f)) {
+				continue;
+			}
+			dump_bulk(ctx, st, sec, j, f);
+		}
+	}
+	return;
+}
+
+static size_t
+cache_dump(struct ctx_s ctx[static 1U])
+{
+/* print securities whose fields are all cached and fresh, stamped with
+ * the oldest fetch time among them, and drop them from the topics,
+ * return the number of securities printed */
+	const size_t nflds = ctx->flds.n;
+	const uint64_t now = clk_rt();
+	struct stmp_s st = {.len = 0U};
+	obuf_t out = ctx->out;
+	/* securities kept for requests */
+	size_t k = 0U;
+	size_t n;
+
+	for (size_t i = 0U; i < ctx->tops.n; i++) {
+		const char *sec = ctx->tops.v[i];
+		struct rcache_val_s v[nflds + 1U];
+		uint64_t old = now;
+		size_t j;
+
+		for (j = 0U; j < nflds; j++) {
+			if (rcache_get(cache, sec, ctx->flds.v[j], NULL, v + j) < 0) {
+				break;
+			} else if (v[j].fetched + cache_ttl <= now) {
+				/* expired */
+				break;
+			} else if (v[j].fetched < old) {
+				old = v[j].fetched;
+			}
+		}
+		if (!nflds || j < nflds) {
+			/* to be requested, with all of its fields */
+			ctx->tops.v[k++] = ctx->tops.v[i];
+			continue;
+		}
+
+		stmp_upd(&st, old);
+		obuf_write(out, st.buf, st.len);
+		obuf_putc(out, '\t');
+		obuf_puts(out, sec);
+		for (j = 0U; j < nflds; j++) {
+			obuf_putc(out, '\t');
+			dump_cval(out, v + j);
+		}
+		obuf_putc(out, '\n');
+		obuf_rec(out);
+	}
+	n = ctx->tops.n - k;
+	ctx->tops.n = k;
+	return n;
+}
+
+static void
+dump_hist(const struct ctx_s ctx[static 1U], blpapi_Message_t *msg)
+{
+	const fldtab_t ft = ctx->ftab;
+	obuf_t out = ctx->out;
+	blpapi_Element_t *els;
+	blpapi_Element_t *sd;
+	blpapi_Element_t *e;
+	const char *sec;
+	size_t nrow;
+
+	if (UNLIKELY((els = blpapi_Message_elements(msg)) == NULL)) {
+		return;
+	} else if (UNLIKELY((e = get_el(els, RN_RESPONSE_ERROR)) != NULL)) {
+		errno = 0, error("\
+Error: request failed: %s", get_errmsg(e));
+		return;
+	} else if ((sd = get_el(els, RN_SECURITY_DATA)) == NULL) {
+		return;
+	} else if (UNLIKELY((sec = get_str(sd, RN_SECURITY)) == NULL)) {
+		sec = "";
+	}
+	if (UNLIKELY((e = get_el(sd, RN_SECURITY_ERROR)) != NULL)) {
+		errno = 0, error("\
+Warning: %s: %s", sec, get_errmsg(e));
+	}
+	if ((e = get_el(sd, RN_FIELD_EXCEPTIONS)) != NULL) {
+		dump_fexc(sec, e);
+	}
+	if ((e = get_el(sd, RN_FIELD_DATA)) == NULL) {
+		return;
+	}
+
+	/* one row per security and date, in -F column order */
+	nrow = blpapi_Element_numValues(e);
+	for (size_t i = 0U; i < nrow; i++) {
+		blpapi_Element_t *cols[ft->nflds + 1U];
+		blpapi_Element_t *row;
+		blpapi_Element_t *dt;
+
+		if (UNLIKELY(blpapi_Element_getValueAsElement(e, &row, i))) {
+			continue;
+		}
+		fldtab_scan(ft, cols, row);
+
+		obuf_puts(out, sec);
+		obuf_putc(out, '\t');
+		if (LIKELY((dt = get_el(row, RN_DATE)) != NULL)) {
+			dump_Element(dt, out);
+		}
+		for (size_t j = 0U; j < ft->nflds; j++) {
+			blpapi_Element_t *f;
+
+			obuf_putc(out, '\t');
+			if ((f = fldtab_el(ft, cols, j)) != NULL) {
+				dump_Element(f, out);
+			}
+		}
+		obuf_putc(out, '\n');
+		obuf_rec(out);
+	}
+	return;
+}
+
+static void
+dump_bars(const struct ctx_s ctx[static 1U], blpapi_Message_t *msg)
+{
+	const fldtab_t ft = ctx->ftab;
+	obuf_t out = ctx->out;
+	blpapi_CorrelationId_t cid;
+	blpapi_Element_t *els;
+	blpapi_Element_t *e;
+	const char *sec;
+	size_t k;
+	size_t nbar;
+
+	/* bar responses don't name their security, the CID does */
+	cid = blpapi_Message_correlationId(msg, 0);
+	if (UNLIKELY(cid.valueType != BLPAPI_CORRELATION_TYPE_INT)) {
+		return;
+	} else if (UNLIKELY((k = cid.value.intValue) <= 0 ||
+			    k > ctx->rsch.nreq)) {
+		return;
+	}
+	sec = ctx->tops.v[(k - 1U) / ctx->rng.nspan];
+
+	if (UNLIKELY((els = blpapi_Message_elements(msg)) == NULL)) {
+		return;
+	} else if (UNLIKELY((e = get_el(els, RN_RESPONSE_ERROR)) != NULL)) {
+		errno = 0, error("\
+Warning: %s: %s", sec, get_errmsg(e));
+		return;
+	} else if ((e = get_el(els, RN_BAR_DATA)) == NULL) {
+		return;
+	} else if ((e = get_el(e, RN_BAR_TICK_DATA)) == NULL) {
+		return;
+	}
+
+	/* one row per security and bar, in -F column order */
+	nbar = blpapi_Element_numValues(e);
+	for (size_t i = 0U; i < nbar; i++) {
+		blpapi_Element_t *cols[ft->nflds + 1U];
+		blpapi_Element_t *bar;
+		blpapi_Element_t *tm;
+
+		if (UNLIKELY(blpapi_Element_getValueAsElement(e, &bar, i))) {
+			continue;
+		}
+		fldtab_scan(ft, cols, bar);
+
+		obuf_puts(out, sec);
+		obuf_putc(out, '\t');
+		if (LIKELY((tm = get_el(bar, RN_TIME)) != NULL)) {
+			dump_Element(tm, out);
+		}
+		for (size_t j = 0U; j < ft->nflds; j++) {
+			blpapi_Element_t *f;
+
+			obuf_putc(out, '\t');
+			if ((f = fldtab_el(ft, cols, j)) != NULL) {
+				dump_Element(f, out);
+			}
+		}
+		obuf_putc(out, '\n');
+		obuf_rec(out);
+	}
+	return;
+}
+
+static struct tslot_s*
+tslot_get(const struct ctx_s ctx[static 1U], size_t k)
+{
+/* return the tick buffer slot serving request K (plus 1),
+ * or for K == 0 an idle one */
+	for (size_t i = 0U; i < ctx->ticks.nslot; i++) {
+		if (ctx->ticks.slot[i].k == k) {
+			return ctx->ticks.slot + i;
+		}
+	}
+	return NULL;
+}
+
+static void
+dump_ticks(const struct ctx_s ctx[static 1U], blpapi_Message_t *msg)
+{
+	const fldtab_t ft = ctx->ftab;
+	blpapi_CorrelationId_t cid;
+	blpapi_Element_t *els;
+	blpapi_Element_t *e;
+	struct tslot_s *ts;
+	const char *sec;
+	size_t k;
+	size_t ntick;
+
+	cid = blpapi_Message_correlationId(msg, 0);
+	if (UNLIKELY(cid.valueType != BLPAPI_CORRELATION_TYPE_INT)) {
+		return;
+	} else if (UNLIKELY((k = cid.value.intValue) <= 0 ||
+			    k > ctx->rsch.nreq)) {
+		return;
+	} else if (UNLIKELY((ts = tslot_get(ctx, k)) == NULL)) {
+		return;
+	}
+	sec = ctx->tops.v[(k - 1U) / ctx->rng.nspan];
+
+	if (UNLIKELY((els = blpapi_Message_elements(msg)) == NULL)) {
+		return;
+	} else if (UNLIKELY((e = get_el(els, RN_RESPONSE_ERROR)) != NULL)) {
+		errno = 0, error("\
+Warning: %s: %s", sec, get_errmsg(e));
+		return;
+	} else if ((e = get_el(els, RN_TICK_DATA)) == NULL) {
+		return;
+	} else if ((e = get_el(e, RN_TICK_DATA)) == NULL) {
+		return;
+	}
+
+	/* straight into the columns, element by element */
+	ntick = blpapi_Element_numValues(e);
+	for (size_t i = 0U; i < ntick; i++) {
+		blpapi_Element_t *cols[NTF + 1U];
+		blpapi_Element_t *tick;
+		blpapi_Element_t *f;
+		blpapi_HighPrecisionDatetime_t hp;
+		const char *typ = NULL;
+		const char *cc = NULL;
+		double val = 0;
+		blpapi_Int64_t siz = 0;
+
+		if (UNLIKELY(blpapi_Element_getValueAsElement(e, &tick, i))) {
+			continue;
+		}
+		fldtab_scan(ft, cols, tick);
+
+		if (UNLIKELY((f = fldtab_el(ft, cols, TF_TIME)) == NULL)) {
+			continue;
+		} else if (UNLIKELY(blpapi_Element_getValueAsHighPrecisionDatetime(
+					    f, &hp, 0U))) {
+			continue;
+		}
+		if ((f = fldtab_el(ft, cols, TF_TYPE)) != NULL) {
+			blpapi_Element_getValueAsString(f, &typ, 0U);
+		}
+		if ((f = fldtab_el(ft, cols, TF_VALUE)) != NULL) {
+			blpapi_Element_getValueAsFloat64(f, &val, 0U);
+		}
+		if ((f = fldtab_el(ft, cols, TF_SIZE)) != NULL) {
+			blpapi_Element_getValueAsInt64(f, &siz, 0U);
+		}
+		if ((f = fldtab_el(ft, cols, TF_COND_CODES)) != NULL) {
+			blpapi_Element_getValueAsString(f, &cc, 0U);
+		}
+		if (UNLIKELY(tcol_add(ts->tc, dt_hpdt_ns(&hp),
+				      typ ? tcol_tt(typ) : TCOL_TT_UNK,
+				      val, siz, cc) < 0)) {
+			error("\
+Error: cannot write ticks of %s", sec);
+			return;
+		}
+	}
+	return;
+}
+
+static void
+dump_pub(const struct ctx_s ctx[static 1U], blpapi_Message_t *msg)
+{
+	char *const *tops = ctx->tops.v;
+	const fldtab_t ft = ctx->ftab;
+	obuf_t out = ctx->out;
+	blpapi_Element_t *els;
+	blpapi_CorrelationId_t cid;
+	size_t ix;
+
+	cid = blpapi_Message_correlationId(msg, 0);
+	if (UNLIKELY(cid.valueType != BLPAPI_CORRELATION_TYPE_INT)) {
+		goto nop;
+	}
+	/* otherwise CID holds the index into TOPS */
+	if (UNLIKELY((ix = cid.value.intValue) <= 0)) {
+		goto nop;
+	}
+
+	ix--;
+	obuf_puts(out, tops[ix]);
+
+	if (UNLIKELY((els = blpapi_Message_elements(msg)) == NULL)) {
+		goto nop;
+	}
+
+	/* scan the message once, then print in column order */
+	with (blpapi_Element_t *cols[ft->nflds + 1U]) {
+		fldtab_scan(ft, cols, els);
+
+		for (size_t i = 0U; i < ft->nflds; i++) {
+			blpapi_Element_t *f;
+
+			obuf_putc(out, '\t');
+			if ((f = fldtab_el(ft, cols, i)) != NULL) {
+				dump_Element(f, out);
+			}
+		}
+	}
+nop:
+	obuf_putc(out, '\n');
+	return;
+}
+
+
+static void
+bin_dent(obuf_t out, struct bin_rec_s *rec, size_t recz, const char *nam)
+{
+/* write dictionary entry REC, of size RECZ, followed by NAM */
+	const size_t z = strlen(nam);
+	char *p = obuf_prep(out, recz + z);
+
+	rec->len = recz + z;
+	memcpy(p, rec, recz);
+	memcpy(p + recz, nam, z);
+	obuf_adv(out, recz + z);
+	obuf_rec(out);
+	return;
+}
+
+static void
+bin_dict(const struct ctx_s ctx[static 1U])
+{
+/* write file header and the field and topic dictionaries */
+	struct bin_hdr_s h = {
+		.rec = {.typ = BIN_RT_HDR},
+		.magic = BIN_MAGIC,
+		.ver = BIN_VERSION,
+		.nfld = ctx->flds.n,
+	};
+
+	bin_dent(ctx->out, &h.rec, sizeof(h), "");
+	for (size_t i = 0U; i < ctx->flds.n; i++) {
+		struct bin_fld_s f = {
+			.rec = {.typ = BIN_RT_FLD},
+			.fid = i,
+		};
+
+		bin_dent(ctx->out, &f.rec, sizeof(f), ctx->flds.v[i]);
+	}
+	for (size_t i = 0U; i < ctx->tops.n; i++) {
+		struct bin_top_s t = {
+			.rec = {.typ = BIN_RT_TOP},
+			.tid = i,
+		};
+
+		bin_dent(ctx->out, &t.rec, sizeof(t), ctx->tops.v[i]);
+	}
+	return;
+}
+
+static struct bin_dt_s
+bin_dt(const blpapi_HighPrecisionDatetime_t *hp)
+{
+	const blpapi_Datetime_t *dt = &hp->datetime;
+	struct bin_dt_s b = {
+		.year = dt->year,
+		.mon = dt->month,
+		.mday = dt->day,
+		.hour = dt->hours,
+		.min = dt->minutes,
+		.sec = dt->seconds,
+		.nsec = dt->milliSeconds * 1000000U + hp->picoseconds / 1000U,
+	};
+
+	if (dt->parts & BLPAPI_DATETIME_YEAR_PART) {
+		b.parts |= BIN_DT_DATE;
+	}
+	if (dt->parts & BLPAPI_DATETIME_SECONDS_PART) {
+		b.parts |= BIN_DT_TIME;
+	}
+	if (dt->parts & BLPAPI_DATETIME_FRACSECONDS_PART) {
+		b.parts |= BIN_DT_FRAC;
+	}
+	return b;
+}
+
+static int
+bin_Element(const blpapi_Element_t *e, obuf_t whither)
+{
+/* like dump_Element() but append tag and binary value */
+	/* room left before the open record would exceed a chunk */
+	const size_t room = whither->chnz - (whither->len - whither->beg);
+	union {
+		blpapi_Int64_t i64;
+		blpapi_Float32_t f32;
+		blpapi_Float64_t f64;
+		blpapi_HighPrecisionDatetime_t hp;
+		const char *str;
+	} tmp;
+	uint8_t vt;
+	int rc;
+
+	switch (blpapi_Element_datatype(e)) {
+	case BLPAPI_DATATYPE_INT32:
+	case BLPAPI_DATATYPE_INT64:
+		if ((rc = blpapi_Element_getValueAsInt64(e, &tmp.i64, 0U))) {
+			break;
+		} else if (UNLIKELY(room < 1U + sizeof(tmp.i64))) {
+			return -1;
+		}
+		vt = BIN_VT_I64;
+		obuf_write(whither, (const void*)&vt, sizeof(vt));
+		obuf_write(whither, (const void*)&tmp.i64, sizeof(tmp.i64));
+		break;
+	case BLPAPI_DATATYPE_FLOAT32:
+		if ((rc = blpapi_Element_getValueAsFloat32(e, &tmp.f32, 0U))) {
+			break;
+		} else if (UNLIKELY(room < 1U + sizeof(tmp.f32))) {
+			return -1;
+		}
+		vt = BIN_VT_F32;
+		obuf_write(whither, (const void*)&vt, sizeof(vt));
+		obuf_write(whither, (const void*)&tmp.f32, sizeof(tmp.f32));
+		break;
+	case BLPAPI_DATATYPE_FLOAT64:
+		if ((rc = blpapi_Element_getValueAsFloat64(e, &tmp.f64, 0U))) {
+			break;
+		} else if (UNLIKELY(room < 1U + sizeof(tmp.f64))) {
+			return -1;
+		}
+		vt = BIN_VT_F64;
+		obuf_write(whither, (const void*)&vt, sizeof(vt));
+		obuf_write(whither, (const void*)&tmp.f64, sizeof(tmp.f64));
+		break;
+	case BLPAPI_DATATYPE_DATETIME:
+	case BLPAPI_DATATYPE_DATE:
+	case BLPAPI_DATATYPE_TIME:
+		rc = blpapi_Element_getValueAsHighPrecisionDatetime(
+			e, &tmp.hp, 0U);
+		if (rc) {
+			break;
+		} else if (UNLIKELY(room < 1U + sizeof(struct bin_dt_s))) {
+			return -1;
+		}
+		with (struct bin_dt_s b = bin_dt(&tmp.hp)) {
+			vt = BIN_VT_DT;
+			obuf_write(whither, (const void*)&vt, sizeof(vt));
+			obuf_write(whither, (const void*)&b, sizeof(b));
+		}
+		break;
+	case BLPAPI_DATATYPE_STRING:
+		if ((rc = blpapi_Element_getValueAsString(e, &tmp.str, 0U))) {
+			break;
+		} else if (UNLIKELY(room < 1U + sizeof(uint16_t))) {
+			return -1;
+		}
+		with (size_t z = strlen(tmp.str)) {
+			uint16_t z16;
+
+			/* truncate rather than split the record */
+			if (UNLIKELY(z > room - 1U - sizeof(z16))) {
+				z = room - 1U - sizeof(z16);
+			}
+			if (UNLIKELY(z > UINT16_MAX)) {
+				z = UINT16_MAX;
+			}
+			z16 = z;
+			vt = BIN_VT_STR;
+			obuf_write(whither, (const void*)&vt, sizeof(vt));
+			obuf_write(whither, (const void*)&z16, sizeof(z16));
+			obuf_write(whither, tmp.str, z);
+		}
+		break;
+	default:
+		rc = -1;
+		break;
+	}
+	return rc;
+}
+
+static void
+bin_pub(const struct ctx_s ctx[static 1U], uint64_t ns, blpapi_Message_t *msg)
+{
+	const fldtab_t ft = ctx->ftab;
+	const size_t nbm = (ft->nflds + 7U) / 8U;
+	obuf_t out = ctx->out;
+	blpapi_Element_t *els;
+	blpapi_CorrelationId_t cid;
+	struct bin_pub_s p = {
+		.rec = {.typ = BIN_RT_PUB},
+		.stmp = ns,
+		.nfld = ft->nflds,
+	};
+	uint8_t bm[nbm + 1U];
+
+	cid = blpapi_Message_correlationId(msg, 0);
+	if (UNLIKELY(cid.valueType != BLPAPI_CORRELATION_TYPE_INT)) {
+		return;
+	} else if (UNLIKELY(cid.value.intValue <= 0)) {
+		return;
+	} else if (UNLIKELY((els = blpapi_Message_elements(msg)) == NULL)) {
+		return;
+	}
+	p.tid = cid.value.intValue - 1;
+
+	/* header and bitmap first, both get patched up later */
+	memset(bm, 0, sizeof(bm));
+	obuf_write(out, (const void*)&p, sizeof(p));
+	obuf_write(out, (const void*)bm, nbm);
+
+	with (blpapi_Element_t *cols[ft->nflds + 1U]) {
+		fldtab_scan(ft, cols, els);
+
+		for (size_t i = 0U; i < ft->nflds; i++) {
+			blpapi_Element_t *f;
+
+			if ((f = fldtab_el(ft, cols, i)) == NULL) {
+				continue;
+			} else if (bin_Element(f, out) < 0) {
+				continue;
+			}
+			bm[i / 8U] |= (uint8_t)(1U << (i % 8U));
+		}
+	}
+
+	with (char *h = obuf_head(out)) {
+		p.rec.len = out->len - out->beg;
+		memcpy(h, &p, sizeof(p));
+		memcpy(h + sizeof(p), bm, nbm);
+	}
+	obuf_rec(out);
+	return;
+}
+
+
+/* queued records, a stamp, the topic and a value per field */
+#define RVAL_STRZ	(24U)
+
+struct rval_s {
+	union {
+		blpapi_Int64_t i64;
+		blpapi_Float64_t f64;
+		blpapi_Float32_t f32;
+		blpapi_HighPrecisionDatetime_t hp;
+		/* not nul-terminated, see LEN */
+		char str[RVAL_STRZ];
+	} v;
+	/* one of BIN_VT_*, BIN_VT_UNK if absent */
+	uint8_t vt;
+	uint8_t len;
+};
+
+struct rrec_s {
+	uint64_t stmp;
+	/* receive time, the writer merges rings in this order */
+	uint64_t rcv;
+	size_t tid;
+	struct rval_s val[];
+};
+
+static void
+rval_get(struct rval_s *v, const blpapi_Element_t *e)
+{
+/* copy E's value to V, nested values and arrays count as absent */
+	v->vt = BIN_VT_UNK;
+	if (blpapi_Element_isArray(e)) {
+		return;
+	}
+	switch (blpapi_Element_datatype(e)) {
+		const char *str;
+
+	case BLPAPI_DATATYPE_INT32:
+	case BLPAPI_DATATYPE_INT64:
+		if (!blpapi_Element_getValueAsInt64(e, &v->v.i64, 0U)) {
+			v->vt = BIN_VT_I64;
+		}
+		break;
+	case BLPAPI_DATATYPE_FLOAT32:
+		if (!blpapi_Element_getValueAsFloat32(e, &v->v.f32, 0U)) {
+			v->vt = BIN_VT_F32;
+		}
+		break;
+	case BLPAPI_DATATYPE_FLOAT64:
+		if (!blpapi_Element_getValueAsFloat64(e, &v->v.f64, 0U)) {
+			v->vt = BIN_VT_F64;
+		}
+		break;
+	case BLPAPI_DATATYPE_DATETIME:
+	case BLPAPI_DATATYPE_DATE:
+	case BLPAPI_DATATYPE_TIME:
+		if (!blpapi_Element_getValueAsHighPrecisionDatetime(
+			    e, &v->v.hp, 0U)) {
+			v->vt = BIN_VT_DT;
+		}
+		break;
+	case BLPAPI_DATATYPE_STRING:
+	case BLPAPI_DATATYPE_ENUMERATION:
+		if (!blpapi_Element_getValueAsString(e, &str, 0U)) {
+			/* truncate, slots are fixed-size */
+			size_t z = strnlen(str, sizeof(v->v.str));
+
+			memcpy(v->v.str, str, z);
+			v->len = z;
+			v->vt = BIN_VT_STR;
+		}
+		break;
+	default:
+		break;
+	}
+	return;
+}
+
+static ring_t
+ring_self(const struct ctx_s ctx[static 1U])
+{
+/* return the calling thread's ring, claim one if need be */
+	if (LIKELY(self != NULL)) {
+		return self;
+	} else if (ctx->nring == 1U) {
+		/* there's only the one callback thread */
+		return *ctx->ring;
+	}
+	with (size_t k = __atomic_fetch_add(&nclaim, 1U, __ATOMIC_RELAXED)) {
+		if (UNLIKELY(k >= ctx->nring)) {
+			errno = 0, error("\
+Warning: more callback threads than rings, dropping their data");
+			return NULL;
+		}
+		self = ctx->ring[k];
+	}
+	return self;
+}
+
+static void
+enq_pub(const struct ctx_s ctx[static 1U], uint64_t ns, blpapi_Message_t *msg)
+{
+/* like dump_pub() but queue the values for the writer thread */
+	const fldtab_t ft = ctx->ftab;
+	const ring_t q = ring_self(ctx);
+	blpapi_Element_t *els;
+	blpapi_CorrelationId_t cid;
+	struct rrec_s *r;
+
+	cid = blpapi_Message_correlationId(msg, 0);
+	if (UNLIKELY(cid.valueType != BLPAPI_CORRELATION_TYPE_INT)) {
+		return;
+	} else if (UNLIKELY(cid.value.intValue <= 0)) {
+		return;
+	} else if (UNLIKELY((els = blpapi_Message_elements(msg)) == NULL)) {
+		return;
+	} else if (UNLIKELY(q == NULL)) {
+		return;
+	} else if (UNLIKELY((r = ring_prep(q)) == NULL)) {
+		/* full, the ring counts the drop, we never wait */
+		return;
+	}
+	r->stmp = r->rcv = ns;
+	r->tid = cid.value.intValue - 1;
+	if (ctx->nring > 1U) {
+		/* the order the library saw them in, across all threads */
+		blpapi_TimePoint_t tp;
+		blpapi_HighPrecisionDatetime_t hp;
+
+		if (!blpapi_Message_timeReceived(msg, &tp) &&
+		    !blpapi_HighPrecisionDatetime_fromTimePoint(&hp, &tp, 0)) {
+			r->rcv = dt_hpdt_ns(&hp);
+		}
+	}
+
+	with (blpapi_Element_t *cols[ft->nflds + 1U]) {
+		fldtab_scan(ft, cols, els);
+
+		for (size_t i = 0U; i < ft->nflds; i++) {
+			blpapi_Element_t *f;
+
+			if ((f = fldtab_el(ft, cols, i)) == NULL) {
+				r->val[i].vt = BIN_VT_UNK;
+				continue;
+			}
+			rval_get(r->val + i, f);
+		}
+	}
+	ring_push(q);
+	return;
+}
+
+static void
+dump_rrec(const struct ctx_s ctx[static 1U], struct stmp_s *st,
+	  const struct rrec_s *r)
+{
+	obuf_t out = ctx->out;
+
+	stmp_upd(st, r->stmp);
+	obuf_write(out, st->buf, st->len);
+	obuf_putc(out, '\t');
+	obuf_puts(out, ctx->tops.v[r->tid]);
+
+	for (size_t i = 0U; i < ctx->ftab->nflds; i++) {
+		const struct rval_s *v = r->val + i;
+		char *p;
+
+		obuf_putc(out, '\t');
+		switch (v->vt) {
+		case BIN_VT_I64:
+			p = obuf_prep(out, FMT_INT_MAXLEN);
+			obuf_adv(out, fmt_i64(p, v->v.i64));
+			break;
+		case BIN_VT_F32:
+			if (prec >= 0) {
+				dump_f64(out, v->v.f32);
+				break;
+			}
+			p = obuf_prep(out, FMT_FLT_MAXLEN);
+			obuf_adv(out, fmt_f32(p, v->v.f32));
+			break;
+		case BIN_VT_F64:
+			dump_f64(out, v->v.f64);
+			break;
+		case BIN_VT_DT:
+			dump_hpdt(out, &v->v.hp);
+			break;
+		case BIN_VT_STR:
+			obuf_write(out, v->v.str, v->len);
+			break;
+		default:
+			break;
+		}
+	}
+	obuf_putc(out, '\n');
+	obuf_rec(out);
+	return;
+}
+
+static void
+bin_rrec(const struct ctx_s ctx[static 1U], const struct rrec_s *r)
+{
+/* like bin_pub() but from a queued record */
+	const size_t nflds = ctx->ftab->nflds;
+	const size_t nbm = (nflds + 7U) / 8U;
+	obuf_t out = ctx->out;
+	struct bin_pub_s p = {
+		.rec = {.typ = BIN_RT_PUB},
+		.stmp = r->stmp,
+		.tid = r->tid,
+		.nfld = nflds,
+	};
+	uint8_t bm[nbm + 1U];
+
+	memset(bm, 0, sizeof(bm));
+	for (size_t i = 0U; i < nflds; i++) {
+		if (r->val[i].vt != BIN_VT_UNK) {
+			bm[i / 8U] |= (uint8_t)(1U << (i % 8U));
+		}
+	}
+	/* header gets patched up once we know the length */
+	obuf_write(out, (const void*)&p, sizeof(p));
+	obuf_write(out, (const void*)bm, nbm);
+
+	for (size_t i = 0U; i < nflds; i++) {
+		const struct rval_s *v = r->val + i;
+
+		if (v->vt == BIN_VT_UNK) {
+			continue;
+		}
+		obuf_write(out, (const void*)&v->vt, sizeof(v->vt));
+		switch (v->vt) {
+		case BIN_VT_I64:
+			obuf_write(out, (const void*)&v->v.i64, sizeof(v->v.i64));
+			break;
+		case BIN_VT_F32:
+			obuf_write(out, (const void*)&v->v.f32, sizeof(v->v.f32));
+			break;
+		case BIN_VT_F64:
+			obuf_write(out, (const void*)&v->v.f64, sizeof(v->v.f64));
+			break;
+		case BIN_VT_DT:
+			with (struct bin_dt_s b = bin_dt(&v->v.hp)) {
+				obuf_write(out, (const void*)&b, sizeof(b));
+			}
+			break;
+		case BIN_VT_STR:
+			with (uint16_t z16 = v->len) {
+				obuf_write(out, (const void*)&z16, sizeof(z16));
+				obuf_write(out, v->v.str, v->len);
+			}
+			break;
+		default:
+			break;
+		}
+	}
+
+	with (char *h = obuf_head(out)) {
+		p.rec.len = out->len - out->beg;
+		memcpy(h, &p, sizeof(p));
+	}
+	obuf_rec(out);
+	return;
+}
+
+static void
+out_flush(const struct ctx_s ctx[static 1U])
+{
+/* flush the output, a write error (full disk, closed pipe) ends us */
+	static bool errp;
+
+	obuf_flush(ctx->out);
+	if (UNLIKELY(ctx->out->err) &&
+	    !__atomic_exchange_n(&errp, true, __ATOMIC_ACQ_REL)) {
+		kill(getpid(), SIGQUIT);
+	}
+	return;
+}
+
+static const struct rrec_s*
+wrt_peek(const struct ctx_s ctx[static 1U], size_t *k, bool *gapp)
+{
+/* return the ring record received first, and its ring in K, set GAPP
+ * if a claimed ring is empty, it might get older records yet,
+ * unclaimed ones never will */
+	const struct rrec_s *r = NULL;
+	const size_t nclm = __atomic_load_n(&nclaim, __ATOMIC_ACQUIRE);
+
+	*gapp = false;
+	for (size_t i = 0U; i < ctx->nring; i++) {
+		const struct rrec_s *x;
+
+		if ((x = ring_peek(ctx->ring[i])) == NULL) {
+			*gapp = *gapp || i < nclm;
+		} else if (r == NULL || x->rcv < r->rcv) {
+			r = x;
+			*k = i;
+		}
+	}
+	return r;
+}
+
+static void
+wrt_rec(const struct ctx_s ctx[static 1U], struct stmp_s *st,
+	uint64_t *last, const struct rrec_s *r, size_t k)
+{
+/* write record R off ring K, LAST is the receive time of the newest
+ * record written so far */
+	if (bin_out_p) {
+		bin_rrec(ctx, r);
+	} else {
+		dump_rrec(ctx, st, r);
+	}
+	if (UNLIKELY(r->rcv < *last)) {
+		__atomic_add_fetch(&nlate, 1U, __ATOMIC_RELAXED);
+	} else {
+		*last = r->rcv;
+	}
+	ring_pop(ctx->ring[k]);
+	return;
+}
+
+static size_t
+wrt_due(const struct ctx_s ctx[static 1U], struct stmp_s *st, uint64_t *last)
+{
+/* write the ring records that are due, return how many there were */
+	const struct rrec_s *r;
+	size_t k = 0U;
+	size_t n = 0U;
+
+	for (bool gapp;
+	     (r = wrt_peek(ctx, &k, &gapp)) != NULL &&
+		     (!gapp || r->rcv + ctx->hold <= clk_rt()); n++) {
+		wrt_rec(ctx, st, last, r, k);
+	}
+	return n;
+}
+
+static void*
+wrt_loop(void *arg)
+{
+/* drain the rings into the output buffer, oldest receive time first,
+ * and flush whenever they run dry, a record that's still being decoded
+ * when newer ones have waited CTX->HOLD comes out late (see nlate) */
+	const struct ctx_s *ctx = arg;
+	struct stmp_s stmp = {.sec = 0U};
+	bool dirtp = false;
+	/* receive time of the newest record written */
+	uint64_t last = 0U;
+
+	for (bool quitp = false;;) {
+		const struct rrec_s *r;
+		size_t k = 0U;
+		bool gapp;
+
+		if (wrt_due(ctx, &stmp, &last)) {
+			dirtp = true;
+			continue;
+		} else if (quitp && (r = wrt_peek(ctx, &k, &gapp)) != NULL) {
+			/* no one's decoding any more */
+			wrt_rec(ctx, &stmp, &last, r, k);
+			dirtp = true;
+			continue;
+		} else if (dirtp) {
+			out_flush(ctx);
+			dirtp = false;
+			continue;
+		} else if (quitp) {
+			break;
+		} else if (__atomic_load_n(&wrt_quit, __ATOMIC_ACQUIRE)) {
+			/* producers are done, another look and we're off */
+			quitp = true;
+			continue;
+		}
+		with (struct timespec nap = {.tv_nsec = WRT_NAP}) {
+			nanosleep(&nap, NULL);
+		}
+	}
+	return NULL;
+}
+
+static void
+ring_prnt(const struct ctx_s ctx[static 1U])
+{
+	for (size_t i = 0U; i < ctx->nring; i++) {
+		const struct ring_s *r = ctx->ring[i];
+
+		LOGF("\
+ring %zu: %zu of %zu slots in use (most %zu), \
+%zu records queued, %zu dropped\n",
+		     i, ring_fill(r), r->mask + 1U,
+		     r->st.hiwat, r->st.npush, r->st.ndrop);
+	}
+	if (ctx->nring > 1U) {
+		LOGF("rings: %zu records written after newer ones\n",
+		     __atomic_load_n(&nlate, __ATOMIC_RELAXED));
+	}
+	return;
+}
+
+static void
+cfl_pub(const struct ctx_s ctx[static 1U], uint64_t ns, blpapi_Message_t *msg)
+{
+/* like enq_pub() but merge the values into the topic's slot */
+	const fldtab_t ft = ctx->ftab;
+	struct cfl_s *cf = ctx->cfl;
+	blpapi_Element_t *els;
+	blpapi_CorrelationId_t cid;
+	size_t ix;
+
+	cid = blpapi_Message_correlationId(msg, 0);
+	if (UNLIKELY(cid.valueType != BLPAPI_CORRELATION_TYPE_INT)) {
+		return;
+	} else if (UNLIKELY(cid.value.intValue <= 0)) {
+		return;
+	} else if (UNLIKELY((els = blpapi_Message_elements(msg)) == NULL)) {
+		return;
+	}
+	ix = cid.value.intValue - 1;
+
+	/* extract outside the lock, merge inside */
+	with (blpapi_Element_t *cols[ft->nflds + 1U]) {
+		struct rval_s v[ft->nflds + 1U];
+		struct rrec_s *r;
+
+		fldtab_scan(ft, cols, els);
+		for (size_t i = 0U; i < ft->nflds; i++) {
+			blpapi_Element_t *f;
+
+			v[i].vt = BIN_VT_UNK;
+			if ((f = fldtab_el(ft, cols, i)) != NULL) {
+				rval_get(v + i, f);
+			}
+		}
+
+		pthread_mutex_lock(&cf->lk);
+		r = (void*)(cf->slot + ix * cf->slotz);
+		for (size_t i = 0U; i < ft->nflds; i++) {
+			if (v[i].vt != BIN_VT_UNK) {
+				r->val[i] = v[i];
+			}
+		}
+		r->stmp = ns;
+		if (!cf->dirtp[ix]) {
+			cf->dirtp[ix] = 1U;
+			cf->dirt[cf->ndirt++] = ix;
+		}
+		cf->nupd++;
+		pthread_mutex_unlock(&cf->lk);
+	}
+	return;
+}
+
+static void*
+cfl_loop(void *arg)
+{
+/* write the topics updated in the last interval, once per interval,
+ * and with --slow=conflate whatever the rings bring in between */
+	const struct ctx_s *ctx = arg;
+	struct cfl_s *cf = ctx->cfl;
+	struct stmp_s stmp = {.sec = 0U};
+	/* receive time of the newest ring record written */
+	uint64_t last = 0U;
+	bool quitp = false;
+
+	for (uint64_t next = clk_mono() + cf->ivl; !quitp; next += cf->ivl) {
+		const uint64_t nap = ctx->ring != NULL ? WRT_NAP : CFL_NAP;
+		const struct rrec_s *x;
+		size_t k = 0U;
+		bool gapp;
+		uint64_t cut;
+		size_t n, m = 0U;
+
+		/* nap in short bits, so we notice when it's time to go */
+		for (uint64_t now;
+		     !(quitp = __atomic_load_n(&wrt_quit, __ATOMIC_ACQUIRE)) &&
+			     (now = clk_mono()) < next;) {
+			const uint64_t d = next - now < nap
+				? next - now : nap;
+			struct timespec ts = {
+				.tv_sec = d / 1000000000U,
+				.tv_nsec = d % 1000000000U,
+			};
+
+			if (ctx->ring != NULL && wrt_due(ctx, &stmp, &last)) {
+				out_flush(ctx);
+				continue;
+			}
+			nanosleep(&ts, NULL);
+		}
+		/* copy the dirty slots, the blpapi threads don't wait
+		 * for the writing */
+		pthread_mutex_lock(&cf->lk);
+		for (size_t i = 0U; i < cf->ndirt; i++) {
+			const size_t ix = cf->dirt[i];
+
+			memcpy(cf->snap + i * cf->slotz,
+			       cf->slot + ix * cf->slotz, cf->slotz);
+			cf->dirtp[ix] = 0U;
+		}
+		n = cf->ndirt;
+		cf->ndirt = 0U;
+		cut = clk_rt();
+		if (cf->autop && !cf->nslow &&
+		    __atomic_exchange_n(&cf->onp, false, __ATOMIC_ACQ_REL)) {
+			/* everyone's caught up, this is the last round,
+			 * values go to the rings until the next slow period
+			 * and what's in the slots will be stale by then */
+			for (size_t i = 0U; i < cf->nslot; i++) {
+				struct rrec_s *r =
+					(void*)(cf->slot + i * cf->slotz);
+
+				for (size_t j = 0U; j < ctx->flds.n; j++) {
+					r->val[j].vt = BIN_VT_UNK;
+				}
+			}
+		}
+		pthread_mutex_unlock(&cf->lk);
+
+		/* ring records from before the slots went in go first */
+		for (; ctx->ring != NULL &&
+			     (x = wrt_peek(ctx, &k, &gapp)) != NULL &&
+			     x->rcv < cut; m++) {
+			wrt_rec(ctx, &stmp, &last, x, k);
+		}
+		for (size_t i = 0U; i < n; i++) {
+			const struct rrec_s *r =
+				(const void*)(cf->snap + i * cf->slotz);
+
+			if (bin_out_p) {
+				bin_rrec(ctx, r);
+			} else {
+				dump_rrec(ctx, &stmp, r);
+			}
+		}
+		/* and the rest when we're off */
+		for (; quitp && ctx->ring != NULL &&
+			     (x = wrt_peek(ctx, &k, &gapp)) != NULL; m++) {
+			wrt_rec(ctx, &stmp, &last, x, k);
+		}
+		if (n || m) {
+			out_flush(ctx);
+		}
+		cf->nout += n;
+		with (const uint64_t now = clk_mono()) {
+			/* we're behind, skip the ticks we missed */
+			if (UNLIKELY(next + cf->ivl < now)) {
+				next = now - cf->ivl;
+			}
+		}
+	}
+	return NULL;
+}
+
+static void
+dump_evs(const struct ctx_s ctx[static 1U], blpapi_MessageIterator_t *iter)
+{
+	static __thread struct clk_s clk;
+	static struct stmp_s stmp;
+	blpapi_Message_t *msg;
+	const yuck_t *argi = ctx->argi;
+	obuf_t out = ctx->out;
+	/* whether we write here, rather than the writer thread */
+	const bool selfp = ctx->ring == NULL && ctx->cfl == NULL;
+	const bool txtp = !bin_out_p && selfp;
+	/* several threads call back, each with a ring of its own (see
+	 * ring_self()), only the latency histograms are shared then */
+	const bool mtp = ctx->ndisp ? ctx->ndisp > 1U : ctx->nshard > 1U;
+	struct rstat_s *rs = statp ? rstat_self() : NULL;
+	uint64_t t0, ns;
+
+	t0 = ns = clk_sync(&clk);
+	if (txtp) {
+		stmp_upd(&stmp, ns);
+	}
+	while (!blpapi_MessageIterator_next(iter, &msg)) {
+		if (stamp_msg_p) {
+			ns = clk_now(&clk);
+			if (txtp) {
+				stmp_upd(&stmp, ns);
+			}
+		}
+		if (UNLIKELY(mtp)) {
+			pthread_mutex_lock(&latlk);
+			lat_msg(&lat, msg, ns);
+			pthread_mutex_unlock(&latlk);
+		} else {
+			lat_msg(&lat, msg, ns);
+		}
+		if (rs != NULL) {
+			rs->nmsg++;
+			if (argi->cmd == BLPCLI_CMD_SUB) {
+				blpapi_CorrelationId_t cid =
+					blpapi_Message_correlationId(msg, 0);
+				rstat_top(rs, cid.value.intValue - 1U);
+			}
+		}
+		switch (argi->cmd) {
+		case BLPCLI_CMD_GET:
+			/* writes a record per security */
+			dump_rsp(ctx, &stmp, msg);
+			break;
+		case BLPCLI_CMD_HIST:
+			/* a record per security and date */
+			dump_hist(ctx, msg);
+			break;
+		case BLPCLI_CMD_BARS:
+			/* a record per security and bar */
+			dump_bars(ctx, msg);
+			break;
+		case BLPCLI_CMD_TICKS:
+			/* into the request's tick buffer, no records */
+			dump_ticks(ctx, msg);
+			break;
+		case BLPCLI_CMD_SUB:
+			if (ctx->cfl != NULL &&
+			    __atomic_load_n(&ctx->cfl->onp, __ATOMIC_ACQUIRE)) {
+				/* the writer picks them up on its next tick */
+				cfl_pub(ctx, ns, msg);
+				break;
+			} else if (ctx->ring != NULL) {
+				/* formatting is the writer's business */
+				enq_pub(ctx, ns, msg);
+				break;
+			} else if (bin_out_p) {
+				bin_pub(ctx, ns, msg);
+				break;
+			}
+			obuf_write(out, stmp.buf, stmp.len);
+			obuf_putc(out, '\t');
+			dump_pub(ctx, msg);
+			obuf_rec(out);
+			break;
+		default:
+			break;
+		}
+	}
+	/* one write per event, unless the writer thread does it */
+	if (selfp) {
+		out_flush(ctx);
+	}
+	if (UNLIKELY(mtp)) {
+		pthread_mutex_lock(&latlk);
+		lat_evw(&lat, t0, clk_now(&clk));
+		pthread_mutex_unlock(&latlk);
+	} else {
+		lat_evw(&lat, t0, clk_now(&clk));
+	}
+	return;
+}
+
+
+static int
+rsch_fill(blpapi_Session_t *s, struct ctx_s *ctx)
+{
+/* top up the in-flight window */
+	struct rsch_s *rs = &ctx->rsch;
+
+	while (rs->nsent < rs->nreq && rs->nsent - rs->ndone < rs->win) {
+		const size_t k = rs->nsent++;
+
+		if (UNLIKELY(rs->send(s, ctx, k) < 0)) {
+			rs->st[k] = RQ_FAIL;
+			rs->ndone++;
+			rs->nfail++;
+			continue;
+		}
+		rs->st[k] = RQ_SENT;
+	}
+	if (UNLIKELY(rs->ndone >= rs->nreq)) {
+		/* the last ones failed to go out, no response will
+		 * come to finish us off, so pretend we pressed C-c */
+		kill(getpid(), SIGINT);
+	}
+	return 0;
+}
+
+static void
+rsch_done(blpapi_Session_t *s, struct ctx_s *ctx,
+	  blpapi_CorrelationId_t cid, bool failp)
+{
+	struct rsch_s *rs = &ctx->rsch;
+	size_t k;
+
+	if (UNLIKELY(cid.valueType != BLPAPI_CORRELATION_TYPE_INT)) {
+		return;
+	} else if (UNLIKELY((k = cid.value.intValue) <= 0 || k > rs->nreq)) {
+		return;
+	} else if (UNLIKELY(rs->st[--k] != RQ_SENT)) {
+		/* already accounted for */
+		return;
+	}
+	rs->st[k] = failp ? RQ_FAIL : RQ_DONE;
+	rs->nfail += failp;
+	rs->ndone++;
+	if (rs->fini != NULL) {
+		rs->fini(ctx, k);
+	}
+
+	if (rs->ndone < rs->nreq) {
+		rsch_fill(s, ctx);
+	} else {
+		/* that was the final response, innit?
+		 * pretend we pressed C-c */
+		kill(getpid(), SIGINT);
+	}
+	return;
+}
+
+static int
+rsch_init(struct rsch_s *rs, size_t nreq, size_t win,
+	  int(*send)(blpapi_Session_t*, struct ctx_s*, size_t),
+	  void(*fini)(struct ctx_s*, size_t))
+{
+	if (UNLIKELY((rs->st = calloc(nreq, sizeof(*rs->st))) == NULL)) {
+		return -1;
+	}
+	rs->nreq = nreq;
+	rs->nsent = rs->ndone = rs->nfail = 0U;
+	rs->win = win ? win : 1U;
+	rs->send = send;
+	rs->fini = fini;
+	return 0;
+}
+
+static void
+rsch_fini(struct rsch_s *rs)
+{
+	if (rs->st != NULL) {
+		free(rs->st);
+		rs->st = NULL;
+	}
+	return;
+}
+
+static blpapi_Request_t*
+make_req(const struct ctx_s ctx[static 1U], const char *typ, size_t chnk)
+{
+/* create request TYP for the CHNK-th chunk of securities and all fields */
+	const size_t beg = chnk * ctx->chunk;
+	const size_t end = beg + ctx->chunk < ctx->tops.n
+		? beg + ctx->chunk : ctx->tops.n;
+	blpapi_Request_t *req;
+	blpapi_Element_t *els;
+
+	if (UNLIKELY(blpapi_Service_createRequest(ctx->svc, &req, typ))) {
+		errno = 0, error("\
+Error: cannot create request");
+		return NULL;
+	}
+
+	if (UNLIKELY((els = blpapi_Request_elements(req)) == NULL)) {
+		errno = 0, error("\
+Error: cannot acquire request elements");
+		goto nul;
+	}
+
+	with (blpapi_Element_t *secs) {
 		blpapi_Element_getElement(els, &secs, "securities", 0);
 		if (UNLIKELY(secs == NULL)) {
 			errno = 0, error("\
 Error: cannot fill securities into request");
-			rc = -1;
-			goto out;
+			goto nul;
+		}
+		for (size_t i = beg; i < end; i++) {
+			const char *top = ctx->tops.v[i];
+
+			blpapi_Element_setValueString(
+				secs, top, BLPAPI_ELEMENT_INDEX_END);
+		}
+	}
+
+	with (blpapi_Element_t *flds) {
+		blpapi_Element_getElement(els, &flds, "fields", 0);
+		if (UNLIKELY(flds == NULL)) {
+			errno = 0, error("\
+Error: cannot fill fields into request");
+			goto nul;
+		}
+		for (size_t i = 0U; i < ctx->flds.n; i++) {
+			const char *fld = ctx->flds.v[i];
+
+			blpapi_Element_setValueString(
+				flds, fld, BLPAPI_ELEMENT_INDEX_END);
 		}
-		for (size_t i = 0U; i < argi->topic_nargs; i++) {
-			const char *top = argi->topic_args[i];
+	}
+	return req;
+
+nul:
+	blpapi_Request_destroy(req);
+	return NULL;
+}
+
+static int
+send_req(blpapi_Session_t *s, blpapi_Request_t *req, size_t k)
+{
+/* send REQ as the K-th request of the schedule, and free it */
+	blpapi_CorrelationId_t cid = {
+		.size = sizeof(cid),
+		.valueType = BLPAPI_CORRELATION_TYPE_INT,
+		.value.intValue = k + 1U,
+	};
+	int rc = 0;
+
+	if (UNLIKELY(blpapi_Session_sendRequest(s, req, &cid, 0, 0, 0, 0))) {
+		errno = 0, error("\
+Error: cannot send request %zu", k);
+		rc = -1;
+	}
+	blpapi_Request_destroy(req);
+	return rc;
+}
+
+static int
+send_get(blpapi_Session_t *s, struct ctx_s *ctx, size_t k)
+{
+/* send the K-th chunk of securities */
+	blpapi_Request_t *req;
+
+	if (UNLIKELY((req = make_req(ctx, "ReferenceDataRequest", k)) == NULL)) {
+		return -1;
+	}
+	return send_req(s, req, k);
+}
+
+static int
+send_hist(blpapi_Session_t *s, struct ctx_s *ctx, size_t k)
+{
+/* send the K-th (chunk, span) pair, spans vary fastest */
+	const size_t chnk = k / ctx->rng.nspan;
+	const int64_t beg = rng_beg(&ctx->rng, k % ctx->rng.nspan);
+	const int64_t end = rng_end(&ctx->rng, k % ctx->rng.nspan);
+	blpapi_Request_t *req;
+	blpapi_Element_t *els;
+	char buf[16U];
+
+	if (UNLIKELY((req = make_req(
+			      ctx, "HistoricalDataRequest", chnk)) == NULL)) {
+		return -1;
+	}
+	els = blpapi_Request_elements(req);
+
+	dt_strf_dc(buf, sizeof(buf), dt_day(beg));
+	blpapi_Element_setElementString(els, "startDate", NULL, buf);
+	dt_strf_dc(buf, sizeof(buf), dt_day(end - 1));
+	blpapi_Element_setElementString(els, "endDate", NULL, buf);
+
+	blpapi_Element_setElementString(
+		els, "periodicitySelection", NULL, "DAILY");
+	return send_req(s, req, k);
+}
+
+static int
+send_bars(blpapi_Session_t *s, struct ctx_s *ctx, size_t k)
+{
+/* send the K-th (security, span) pair, spans vary fastest */
+	const char *sec = ctx->tops.v[k / ctx->rng.nspan];
+	const int64_t beg = rng_beg(&ctx->rng, k % ctx->rng.nspan);
+	const int64_t end = rng_end(&ctx->rng, k % ctx->rng.nspan);
+	blpapi_Request_t *req;
+	blpapi_Element_t *els;
+	char buf[32U];
+
+	if (UNLIKELY(blpapi_Service_createRequest(
+			     ctx->svc, &req, "IntradayBarRequest"))) {
+		errno = 0, error("\
+Error: cannot create request");
+		return -1;
+	} else if (UNLIKELY((els = blpapi_Request_elements(req)) == NULL)) {
+		errno = 0, error("\
+Error: cannot acquire request elements");
+		blpapi_Request_destroy(req);
+		return -1;
+	}
+
+	blpapi_Element_setElementString(els, "security", NULL, sec);
+	blpapi_Element_setElementString(els, "eventType", NULL, ctx->bars.evt);
+	blpapi_Element_setElementInt32(els, "interval", NULL, ctx->bars.ivl);
+	/* bars start within [BEG, END) */
+	dt_strf_s(buf, sizeof(buf), beg);
+	blpapi_Element_setElementString(els, "startDateTime", NULL, buf);
+	dt_strf_s(buf, sizeof(buf), end - 1);
+	blpapi_Element_setElementString(els, "endDateTime", NULL, buf);
+	return send_req(s, req, k);
+}
+
+static int
+send_ticks(blpapi_Session_t *s, struct ctx_s *ctx, size_t k)
+{
+/* send the K-th (security, day) pair, days vary fastest */
+	const char *sec = ctx->tops.v[k / ctx->rng.nspan];
+	const int64_t beg = rng_beg(&ctx->rng, k % ctx->rng.nspan);
+	const int64_t end = rng_end(&ctx->rng, k % ctx->rng.nspan);
+	const size_t dirz = strlen(ctx->ticks.dir);
+	const size_t secz = strlen(sec);
+	char fn[dirz + secz + 16U];
+	struct tslot_s *ts;
+	blpapi_Request_t *req;
+	blpapi_Element_t *els;
+	char buf[32U];
+
+	if (UNLIKELY((ts = tslot_get(ctx, 0U)) == NULL)) {
+		errno = 0, error("\
+Error: no tick buffer left for request %zu", k);
+		return -1;
+	}
+
+	/* DIR/SEC-YYYYMMDD.tck, with SEC made palatable as file name */
+	memcpy(fn, ctx->ticks.dir, dirz);
+	fn[dirz] = '/';
+	for (size_t i = 0U; i < secz; i++) {
+		const char c = sec[i];
+
+		const bool okp = (c >= '0' && c <= '9') ||
+			(c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
+			c == '.' || c == '-';
 
-			blpapi_Element_setValueString(
-				secs, top, BLPAPI_ELEMENT_INDEX_END);
-		}
+		fn[dirz + 1U + i] = okp ? c : '_';
 	}
+	fn[dirz + 1U + secz] = '-';
+	dt_strf_dc(fn + dirz + secz + 2U, 11U, dt_day(beg));
+	memcpy(fn + dirz + secz + 10U, ".tck", 5U);
 
-	with (blpapi_Element_t *flds) {
-		blpapi_Element_getElement(els, &flds, "fields", 0);
-		if (UNLIKELY(flds == NULL)) {
+	if (UNLIKELY(tcol_open(ts->tc, fn, sec, dt_day(beg)) < 0)) {
+		error("\
+Error: cannot open tick file `%s'", fn);
+		return -1;
+	}
+
+	if (UNLIKELY(blpapi_Service_createRequest(
+			     ctx->svc, &req, "IntradayTickRequest"))) {
+		errno = 0, error("\
+Error: cannot create request");
+		goto clo;
+	} else if (UNLIKELY((els = blpapi_Request_elements(req)) == NULL)) {
+		errno = 0, error("\
+Error: cannot acquire request elements");
+		blpapi_Request_destroy(req);
+		goto clo;
+	}
+
+	blpapi_Element_setElementString(els, "security", NULL, sec);
+	with (blpapi_Element_t *evts) {
+		blpapi_Element_getElement(els, &evts, "eventTypes", 0);
+		if (UNLIKELY(evts == NULL)) {
 			errno = 0, error("\
-Error: cannot fill fields into request");
-			rc = -1;
-			goto out;
+Error: cannot fill event types into request");
+			blpapi_Request_destroy(req);
+			goto clo;
 		}
-		for (size_t i = 0U; i < argi->field_nargs; i++) {
-			const char *fld = argi->field_args[i];
-
+		for (size_t i = 0U; i < ctx->ticks.nevt; i++) {
 			blpapi_Element_setValueString(
-				flds, fld, BLPAPI_ELEMENT_INDEX_END);
+				evts, ctx->ticks.evts[i],
+				BLPAPI_ELEMENT_INDEX_END);
 		}
 	}
+	dt_strf_s(buf, sizeof(buf), beg);
+	blpapi_Element_setElementString(els, "startDateTime", NULL, buf);
+	dt_strf_s(buf, sizeof(buf), end - 1);
+	blpapi_Element_setElementString(els, "endDateTime", NULL, buf);
+	blpapi_Element_setElementBool(els, "includeConditionCodes", NULL, 1);
 
-	/* finally send the whole shebang */
-	blpapi_Session_sendRequest(s, req, &cid, 0, 0, 0, 0);
-out:
-	blpapi_Request_destroy(req);
-	return rc;
+	if (UNLIKELY(send_req(s, req, k) < 0)) {
+		goto clo;
+	}
+	ts->k = k + 1U;
+	return 0;
+
+clo:
+	tcol_close(ts->tc);
+	return -1;
+}
+
+static void
+fini_ticks(struct ctx_s *ctx, size_t k)
+{
+/* request K is done, write out the rest of its ticks */
+	struct tslot_s *ts;
+
+	if (UNLIKELY((ts = tslot_get(ctx, k + 1U)) == NULL)) {
+		return;
+	}
+	if (UNLIKELY(tcol_close(ts->tc) < 0)) {
+		error("\
+Error: cannot write ticks of %s", ctx->tops.v[k / ctx->rng.nspan]);
+	}
+	ctx->ticks.nfile++;
+	ctx->ticks.ntick += ts->tc->ntot;
+	ts->k = 0U;
+	return;
 }
 
 static int
-svc_sta_sub(blpapi_Session_t *s, const struct yuck_cmd_sub_s argi[static 1U])
+svc_sta_ref(blpapi_Session_t *s, struct ctx_s *ctx, size_t nreq,
+	    int(*send)(blpapi_Session_t*, struct ctx_s*, size_t),
+	    void(*fini)(struct ctx_s*, size_t))
 {
-	blpapi_SubscriptionList_t *subs;
-	const char *opts[] = {};
+/* open refdata service and schedule NREQ requests sent through SEND,
+ * FINI (if non-NULL) is called for every request done */
+	static const char svc_ref[] = "//blp/refdata";
 
-	if (UNLIKELY((subs = blpapi_SubscriptionList_create()) == NULL)) {
+	/* resolve response element and field names */
+	init_rnam();
+	if (ctx->ftab == NULL &&
+	    UNLIKELY((ctx->ftab = make_fldtab(
+			      deconst(ctx->flds.v), ctx->flds.n)) == NULL)) {
 		errno = 0, error("\
-Error: cannot instantiate subscriptions");
+Error: cannot resolve field names");
 		return -1;
 	}
 
-	/* subscribe */
-	for (size_t i = 0U; i < argi->topic_nargs; i++) {
-		const char *top = argi->topic_args[i];
-		const char **flds = deconst(argi->field_args);
-		const size_t nflds = argi->field_nargs;
-		blpapi_CorrelationId_t cid = {
-			.size = sizeof(cid),
-			.valueType = BLPAPI_CORRELATION_TYPE_INT,
-			.value.intValue = i + 1U,
-		};
+	if (UNLIKELY(blpapi_Session_openService(s, svc_ref))) {
+		errno = 0, error("\
+Error: cannot open service %s", svc_ref);
+		return -1;
+	}
+	blpapi_Session_getService(s, &ctx->svc, svc_ref);
+
+	/* there's always one request */
+	if (UNLIKELY(rsch_init(&ctx->rsch, nreq ? nreq : 1U,
+			       ctx->win, send, fini) < 0)) {
+		errno = 0, error("\
+Error: cannot allocate request schedule");
+		return -1;
+	}
+	return rsch_fill(s, ctx);
+}
+
+static int
+svc_sta_get(blpapi_Session_t *s, struct ctx_s *ctx)
+{
+	/* split the universe into chunks */
+	const size_t nchnk = (ctx->tops.n + ctx->chunk - 1U) / ctx->chunk;
+
+	return svc_sta_ref(s, ctx, nchnk, send_get, NULL);
+}
+
+static int
+svc_sta_hist(blpapi_Session_t *s, struct ctx_s *ctx)
+{
+	/* split the universe into chunks and the date range into spans */
+	const size_t nchnk = (ctx->tops.n + ctx->chunk - 1U) / ctx->chunk;
+
+	return svc_sta_ref(
+		s, ctx, nchnk * ctx->rng.nspan, send_hist, NULL);
+}
+
+static int
+svc_sta_bars(blpapi_Session_t *s, struct ctx_s *ctx)
+{
+	/* one request per security and span */
+	return svc_sta_ref(
+		s, ctx, ctx->tops.n * ctx->rng.nspan, send_bars, NULL);
+}
+
+static int
+svc_sta_ticks(blpapi_Session_t *s, struct ctx_s *ctx)
+{
+	/* tick elements rather than fields from the command line */
+	if (ctx->ftab == NULL &&
+	    UNLIKELY((ctx->ftab = make_fldtab(tick_flds, NTF)) == NULL)) {
+		errno = 0, error("\
+Error: cannot resolve tick element names");
+		return -1;
+	}
+	/* one request per security and day */
+	return svc_sta_ref(
+		s, ctx, ctx->tops.n * ctx->rng.nspan, send_ticks, fini_ticks);
+}
+
+static bool
+sub_add(const struct ctx_s ctx[static 1U], blpapi_SubscriptionList_t *subs,
+	size_t i, const char **flds, size_t nflds)
+{
+/* add topic I with fields FLDS and its options to SUBS,
+ * return whether the topic has options of its own */
+	const char *topt = ctx->topts ? ctx->topts[i] : NULL;
+	const size_t z = topt ? strlen(topt) : 0U;
+	blpapi_CorrelationId_t cid = {
+		.size = sizeof(cid),
+		.valueType = BLPAPI_CORRELATION_TYPE_INT,
+		.value.intValue = i + 1U,
+	};
 
+	/* global options first, the topic's own ones override */
+	with (const char *opts[ctx->ngopt + (z + 1U) / 2U + 1U]) {
+		char buf[z + 1U];
+		size_t nopts = ctx->ngopt;
+
+		memcpy(opts, ctx->gopts, nopts * sizeof(*opts));
+		if (topt != NULL) {
+			memcpy(buf, topt, z + 1U);
+			nopts = topt_add(opts, nopts, buf);
+		}
 		blpapi_SubscriptionList_add(
-			subs, top, &cid, flds, opts, nflds, countof(opts));
+			subs, ctx->tops.v[i], &cid, flds, opts, nflds, nopts);
+	}
+	return topt != NULL;
+}
+
+static bool
+sub_batch(blpapi_Session_t *s, struct ctx_s *ctx, size_t ntop)
+{
+/* subscribe the next batch of wanted topics out of CTX's share,
+ * return whether there are more, to be called with sublk held */
+	blpapi_SubscriptionList_t *subs;
+	size_t i = ctx->rec.next;
+	size_t n = 0U;
+
+	if (UNLIKELY((subs = blpapi_SubscriptionList_create()) == NULL)) {
+		/* next time then */
+		return true;
+	}
+	for (; i < ntop && n < SUB_BATCH; i++) {
+		if (!ctx->subp[i]) {
+			continue;
+		} else if (ctx->nshard > 1U &&
+			   strhash(ctx->tops.v[i]) % ctx->nshard != ctx->shard) {
+			continue;
+		}
+		ctx->rec.nown += sub_add(
+			ctx, subs, i, deconst(ctx->flds.v), ctx->flds.n);
+		n++;
 	}
-	if (blpapi_Session_subscribe(s, subs, NULL, NULL, 0)) {
+	if (n && blpapi_Session_subscribe(s, subs, NULL, NULL, 0)) {
 		errno = 0, error("\
 Error: cannot subscribe");
 	}
 	blpapi_SubscriptionList_destroy(subs);
+	ctx->rec.next = i;
+	ctx->rec.nsub += n;
+	return i < ntop;
+}
+
+static int
+svc_sta_sub(blpapi_Session_t *UNUSED(s), struct ctx_s *ctx)
+{
+	/* resolve field names once and for all */
+	if (ctx->ftab == NULL &&
+	    UNLIKELY((ctx->ftab = make_fldtab(
+			      deconst(ctx->flds.v), ctx->flds.n)) == NULL)) {
+		errno = 0, error("\
+Error: cannot resolve field names");
+		return -1;
+	}
+
+	/* the main thread sends our topics in batches, see sub_batch() */
+	pthread_mutex_lock(&sublk);
+	ctx->rec.gop = true;
+	ctx->rec.donep = false;
+	ctx->rec.next = 0U;
+	ctx->rec.nsub = 0U;
+	ctx->rec.nown = 0U;
+	pthread_mutex_unlock(&sublk);
+	kill(getpid(), SIGUSR2);
 	return 0;
 }
 
@@ -464,6 +2997,9 @@ sess_sta(blpapi_Session_t *sess, struct ctx_s *ctx)
 			static const char svc_sub[] = "//blp/mktdata";
 
 		case BLPCLI_CMD_GET:
+		case BLPCLI_CMD_HIST:
+		case BLPCLI_CMD_BARS:
+		case BLPCLI_CMD_TICKS:
 			svc = svc_get;
 			break;
 		case BLPCLI_CMD_SUB:
@@ -472,7 +3008,7 @@ sess_sta(blpapi_Session_t *sess, struct ctx_s *ctx)
 		default:
 			/* hm? */
 			errno = 0, error("\
-Warning: session message other than GET/SUB received");
+Warning: session message other than GET/HIST/BARS/TICKS/SUB received");
 			return -1;
 		}
 		break;
@@ -504,13 +3040,51 @@ Error: cannot open service %s", svc);
 	return 0;
 }
 
+static void
+slow_upd(struct ctx_s *ctx, int d)
+{
+/* a session's queue went above the high-water mark (D = 1)
+ * or back below the low-water mark (D = -1) */
+	struct cfl_s *cf = ctx->cfl;
+
+	if (cf == NULL || !cf->autop) {
+		return;
+	}
+	pthread_mutex_lock(&cf->lk);
+	cf->nslow += d;
+	if (cf->nslow) {
+		/* the writer turns it off again */
+		__atomic_store_n(&cf->onp, true, __ATOMIC_RELEASE);
+	}
+	pthread_mutex_unlock(&cf->lk);
+	return;
+}
+
 static int
 sess_end(blpapi_Session_t *UNUSED(sess), struct ctx_s *ctx)
 {
 	/* indicate success */
 	LOG("ST<-FIN\n");
 	ctx->st = ST_FIN;
-	kill(0, SIGQUIT);
+	/* the queue's gone, a revived session mustn't count as slow */
+	if (sopt_qlo(&ctx->qst, clk_mono())) {
+		slow_upd(ctx, -1);
+	}
+	if (ctx->argi->cmd != BLPCLI_CMD_SUB) {
+		kill(0, SIGQUIT);
+		return 0;
+	} else if (__atomic_load_n(&endp, __ATOMIC_ACQUIRE)) {
+		return 0;
+	}
+	/* subscriptions live on, the main thread revives the session */
+	pthread_mutex_lock(&sublk);
+	ctx->rec.gop = false;
+	if (!ctx->rec.t0) {
+		ctx->rec.t0 = clk_mono();
+	}
+	pthread_mutex_unlock(&sublk);
+	__atomic_store_n(&ctx->rec.deadp, true, __ATOMIC_RELEASE);
+	kill(getpid(), SIGUSR2);
 	return 0;
 }
 
@@ -535,12 +3109,27 @@ Warning: service message received but we are past the session state");
 
 	switch (argi->cmd) {
 	case BLPCLI_CMD_GET:
-		if (svc_sta_get(sess, (const struct yuck_cmd_get_s*)argi) < 0) {
+		if (svc_sta_get(sess, ctx) < 0) {
+			return -1;
+		}
+		break;
+	case BLPCLI_CMD_HIST:
+		if (svc_sta_hist(sess, ctx) < 0) {
+			return -1;
+		}
+		break;
+	case BLPCLI_CMD_BARS:
+		if (svc_sta_bars(sess, ctx) < 0) {
+			return -1;
+		}
+		break;
+	case BLPCLI_CMD_TICKS:
+		if (svc_sta_ticks(sess, ctx) < 0) {
 			return -1;
 		}
 		break;
 	case BLPCLI_CMD_SUB:
-		if (svc_sta_sub(sess, (const struct yuck_cmd_sub_s*)argi) < 0) {
+		if (svc_sta_sub(sess, ctx) < 0) {
 			return -1;
 		}
 		break;
@@ -573,6 +3162,9 @@ sub_sta(blpapi_Session_t *UNUSED(sess), struct ctx_s *ctx)
 
 	switch (argi->cmd) {
 	case BLPCLI_CMD_GET:
+	case BLPCLI_CMD_HIST:
+	case BLPCLI_CMD_BARS:
+	case BLPCLI_CMD_TICKS:
 		/* we should not be here */
 		return -1;
 	case BLPCLI_CMD_SUB:
@@ -589,9 +3181,225 @@ sub_sta(blpapi_Session_t *UNUSED(sess), struct ctx_s *ctx)
 	return 0;
 }
 
+/* live subscription changes, see --control */
+struct ctl_s {
+	const char *fn;
+	FILE *f;
+	/* sessions and their contexts, the first one is CTX */
+	struct ctx_s *ctx;
+	struct ctx_s *sctx;
+	blpapi_Session_t **sess;
+	size_t nsess;
+	/* topic index and room for topics */
+	ttab_t tt;
+	size_t ntopz;
+	/* fields of topics (re)subscribed from now on */
+	const char **flds;
+	size_t nflds;
+	/* topic strings we allocated */
+	struct strv_s own;
+};
+
+static int
+ctl_flds(struct ctl_s *c, char *s)
+{
+/* set fields from FLD,... which must be columns, all of them if none */
+	const struct strv_s *cols = &c->ctx->flds;
+
+	c->nflds = 0U;
+	for (char *f, *sp = NULL; (f = strtok_r(s, ",", &sp)) != NULL; s = NULL) {
+		size_t j, k;
+
+		for (j = 0U; j < cols->n && strcmp(cols->v[j], f); j++);
+		if (UNLIKELY(j >= cols->n)) {
+			errno = 0, error("\
+Warning: field `%s' is not a column, see -F", f);
+			continue;
+		}
+		/* each column once */
+		for (k = 0U; k < c->nflds && c->flds[k] != cols->v[j]; k++);
+		if (k >= c->nflds) {
+			c->flds[c->nflds++] = cols->v[j];
+		}
+	}
+	if (!c->nflds) {
+		memcpy(c->flds, cols->v, cols->n * sizeof(*c->flds));
+		c->nflds = cols->n;
+	}
+	return 0;
+}
+
+static int
+ctl_send(const struct ctl_s *c, size_t i, char op)
+{
+/* subscribe (+), unsubscribe (-) or resubscribe (~) topic I */
+	const struct ctx_s *ctx = c->ctx;
+	const size_t k = c->nsess > 1U ? strhash(ctx->tops.v[i]) % c->nsess : 0U;
+	blpapi_SubscriptionList_t *subs;
+	int rc;
+
+	if (UNLIKELY((subs = blpapi_SubscriptionList_create()) == NULL)) {
+		return -1;
+	}
+	sub_add(ctx, subs, i, c->flds, c->nflds);
+	switch (op) {
+	case '+':
+		rc = blpapi_Session_subscribe(c->sess[k], subs, NULL, NULL, 0);
+		break;
+	case '-':
+		rc = blpapi_Session_unsubscribe(c->sess[k], subs, NULL, 0);
+		break;
+	default:
+		rc = blpapi_Session_resubscribe(c->sess[k], subs, NULL, 0);
+		break;
+	}
+	blpapi_SubscriptionList_destroy(subs);
+	return rc ? -1 : 0;
+}
+
+static int
+ctl_sess(const struct ctl_s *c, size_t i, char op)
+{
+/* apply OP to topic I, to be called with sublk held */
+	const size_t k = c->nsess > 1U
+		? strhash(c->ctx->tops.v[i]) % c->nsess : 0U;
+	const struct ctx_s *x = k ? c->sctx + k : c->ctx;
+
+	if (!x->rec.gop || x->rec.next <= i) {
+		/* (re)subscription batches haven't got this far,
+		 * they'll pick the topic up, or leave it out */
+		return 0;
+	}
+	return ctl_send(c, i, op);
+}
+
+static int
+ctl_line(struct ctl_s *c, char *line)
+{
+	struct ctx_s *ctx = c->ctx;
+	const char op = *line++;
+	char *top, *opt;
+	ssize_t i;
+
+	switch (op) {
+	case '+':
+	case '-':
+	case '~':
+		break;
+	case '=':
+		return ctl_flds(c, line);
+	case '\0':
+	case '#':
+		return 0;
+	default:
+		errno = 0, error("\
+Warning: control lines start with one of `+', `-', `~' or `='");
+		return -1;
+	}
+
+	if (UNLIKELY((top = strdup(line)) == NULL)) {
+		return -1;
+	}
+	opt = topt_split(top);
+	pthread_mutex_lock(&sublk);
+	if ((i = ttab_get(c->tt, ctx->tops.v, top)) >= 0) {
+		/* known topic, same index and correlation id as before */
+		if (ctx->subp[i] != (op != '+')) {
+			errno = 0, error("\
+Warning: topic `%s' is %s subscribed", top, ctx->subp[i] ? "already" : "not");
+			free(top);
+			goto err;
+		} else if (op == '-') {
+			free(top);
+			top = ctx->tops.v[i];
+		} else {
+			/* keep the string around for its options */
+			ctx->topts[i] = opt;
+			strv_add(&c->own, top);
+		}
+	} else if (op != '+') {
+		errno = 0, error("\
+Warning: topic `%s' is not subscribed", top);
+		free(top);
+		goto err;
+	} else if (UNLIKELY(ctx->tops.n >= c->ntopz)) {
+		errno = 0, error("\
+Warning: no room for more topics");
+		free(top);
+		goto err;
+	} else {
+		/* new topic, the room is reserved so TOPS won't move */
+		i = ctx->tops.n;
+		ctx->topts[i] = opt;
+		strv_add(&ctx->tops, top);
+		strv_add(&c->own, top);
+		ttab_put(c->tt, ctx->tops.v, i);
+		/* sessions done with their batches are past it too */
+		for (size_t k = 0U; k < c->nsess; k++) {
+			struct ctx_s *x = k ? c->sctx + k : ctx;
+			x->rec.next += x->rec.next == (size_t)i;
+		}
+	}
+
+	if (ctl_sess(c, i, op) < 0) {
+		errno = 0, error("\
+Warning: cannot change subscription to `%s'", top);
+		goto err;
+	}
+	ctx->subp[i] = op != '-';
+	pthread_mutex_unlock(&sublk);
+	LOGF("control: %c%s\n", op, top);
+	return 0;
+err:
+	pthread_mutex_unlock(&sublk);
+	return -1;
+}
+
+static void*
+ctl_loop(void *arg)
+{
+/* apply subscription changes, one per line:
+ * +TOPIC[|OPT,...]  subscribe, or subscribe again
+ * -TOPIC            unsubscribe
+ * ~TOPIC[|OPT,...]  resubscribe with new options and fields
+ * =FLD,...          fields for later + and ~ lines, all if none */
+	struct ctl_s *c = arg;
+	char *line = NULL;
+	size_t linz = 0U;
+	ssize_t n;
+
+	if (!strcmp(c->fn, "-")) {
+		c->f = stdin;
+	} else if (UNLIKELY((c->f = fopen(c->fn, "r")) == NULL)) {
+		error("\
+Error: cannot open control file `%s'", c->fn);
+		return NULL;
+	}
+	while ((n = getline(&line, &linz, c->f)) > 0) {
+		line[n - (line[n - 1] == '\n')] = '\0';
+
+		/* don't leave blpapi half-way through a request */
+		pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+		ctl_line(c, line);
+		pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+	}
+	free(line);
+	return NULL;
+}
+
+static void
+slow_shed(struct ctx_s *ctx, blpapi_MessageIterator_t *iter)
+{
+/* skip the event's messages, the queue drains oldest first */
+	for (blpapi_Message_t *msg;
+	     !blpapi_MessageIterator_next(iter, &msg); ctx->qst.ndrop++);
+	return;
+}
+
 static void
 beef(blpapi_Event_t *e, blpapi_Session_t *sess, void *ctx)
 {
+	const uint64_t t0 = statp ? clk_mono() : 0U;
 	blpapi_MessageIterator_t *iter;
 	unsigned int typ;
 
@@ -600,17 +3408,43 @@ beef(blpapi_Event_t *e, blpapi_Session_t *sess, void *ctx)
 		return;
 	}
 	switch ((typ = blpapi_Event_eventType(e))) {
+	case BLPAPI_EVENTTYPE_ADMIN:
+		for (blpapi_Message_t *msg;
+		     (!blpapi_MessageIterator_next(iter, &msg));) {
+			static const char hi[] = "SlowConsumerWarning";
+			static const char lo[] = "SlowConsumerWarningCleared";
+			static const char los[] = "DataLoss";
+			const char *msgstr = blpapi_Message_typeString(msg);
+			struct sopt_qst_s *q = &((struct ctx_s*)ctx)->qst;
+
+			if (!strcmp(msgstr, hi)) {
+				/* we're not keeping up */
+				if (sopt_qhi(q, clk_mono())) {
+					slow_upd(ctx, 1);
+				}
+			} else if (!strcmp(msgstr, lo)) {
+				if (sopt_qlo(q, clk_mono())) {
+					slow_upd(ctx, -1);
+				}
+			} else if (!strcmp(msgstr, los)) {
+				/* we didn't keep up */
+				q->nloss++;
+			}
+		}
+		break;
 	case BLPAPI_EVENTTYPE_SESSION_STATUS:
 		for (blpapi_Message_t *msg;
 		     (!blpapi_MessageIterator_next(iter, &msg));) {
 			static const char sta[] = "SessionStarted";
 			static const char end[] = "SessionTerminated";
+			static const char ftl[] = "SessionStartupFailure";
 			const char *msgstr = blpapi_Message_typeString(msg);
 
 			if (!strcmp(msgstr, sta)) {
 				/* yay!!! */
 				sess_sta(sess, ctx);
-			} else if (!strcmp(msgstr, end)) {
+			} else if (!strcmp(msgstr, end) ||
+				   !strcmp(msgstr, ftl)) {
 				/* nawww :( */
 				sess_end(sess, ctx);
 			} else {
@@ -644,14 +3478,47 @@ beef(blpapi_Event_t *e, blpapi_Session_t *sess, void *ctx)
 		}
 		break;
 	case BLPAPI_EVENTTYPE_PARTIAL_RESPONSE:
-	case BLPAPI_EVENTTYPE_RESPONSE:
 	case BLPAPI_EVENTTYPE_SUBSCRIPTION_DATA:
+		if (UNLIKELY(slow_pol == SLOW_DROP) &&
+		    typ == BLPAPI_EVENTTYPE_SUBSCRIPTION_DATA &&
+		    sopt_qhip(&((struct ctx_s*)ctx)->qst)) {
+			slow_shed(ctx, iter);
+			break;
+		}
 		dump_evs(ctx, iter);
+		break;
+	case BLPAPI_EVENTTYPE_RESPONSE:
+		dump_evs(ctx, iter);
+
+		/* final responses, account for their requests */
+		with (blpapi_MessageIterator_t *fin) {
+			if (UNLIKELY((fin = blpapi_MessageIterator_create(
+					      e)) == NULL)) {
+				break;
+			}
+			for (blpapi_Message_t *msg;
+			     (!blpapi_MessageIterator_next(fin, &msg));) {
+				blpapi_CorrelationId_t cid =
+					blpapi_Message_correlationId(msg, 0);
+				rsch_done(sess, ctx, cid, false);
+			}
+			blpapi_MessageIterator_destroy(fin);
+		}
+		break;
+	case BLPAPI_EVENTTYPE_REQUEST_STATUS:
+		for (blpapi_Message_t *msg;
+		     (!blpapi_MessageIterator_next(iter, &msg));) {
+			static const char fai[] = "RequestFailure";
+			const char *msgstr = blpapi_Message_typeString(msg);
 
-		if (UNLIKELY(typ == BLPAPI_EVENTTYPE_RESPONSE)) {
-			/* that was the final response, innit?
-			 * pretend we pressed C-c */
-			kill(getpid(), SIGINT);
+			if (!strcmp(msgstr, fai)) {
+				/* bugger */
+				errno = 0, error("\
+Warning: request failed");
+				rsch_done(sess, ctx,
+					  blpapi_Message_correlationId(msg, 0),
+					  true);
+			}
 		}
 		break;
 	default:
@@ -660,17 +3527,196 @@ beef(blpapi_Event_t *e, blpapi_Session_t *sess, void *ctx)
 Warning: unknown event %u", typ);
 		break;
 	}
-	blpapi_MessageIterator_destroy(iter);
-	blpapi_Event_release(e);
-	return;
+	blpapi_MessageIterator_destroy(iter);
+	blpapi_Event_release(e);
+
+	if (statp) {
+		struct rstat_s *rs;
+
+		if (LIKELY((rs = rstat_self()) != NULL)) {
+			rs->nev[typ < RSTAT_NEVT ? typ : 0U]++;
+			hist_rec(&rs->cbk, clk_mono() - t0);
+		}
+	}
+	return;
+}
+
+static void
+stat_prnt(int fd, bool topp, void *clo)
+{
+/* write a line of statistics to FD, and a line per topic if TOPP */
+	const struct ctx_s *ctx = clo;
+	struct rstat_s *prev = stat_prev + topp;
+	uint64_t *tprev = stat_tprev + topp;
+	struct rstat_s cur = {.ntop = topp ? stat_tops : NULL};
+	const uint64_t now = clk_mono();
+	char buf[4096U];
+	size_t n;
+
+	rstat_sum(&cur);
+	/* what we wrote is what counts here */
+	cur.nbyt = ctx->out->st.nbyt;
+	with (const uint64_t ts = clk_rt(), dt = now - *tprev) {
+		n = snprintf(buf, sizeof(buf), "\
+stats ts=%" PRIu64 ".%09" PRIu64 " dt=%" PRIu64 ".%03" PRIu64 " ",
+			     ts / 1000000000U, ts % 1000000000U,
+			     dt / 1000000000U, dt / 1000000U % 1000U);
+	}
+	n += rstat_prnt(buf + n, sizeof(buf) - n, &cur, prev, now - *tprev);
+	for (size_t i = 0U; i < ctx->nring && n < sizeof(buf); i++) {
+		const ring_t r = ctx->ring[i];
+
+		n += snprintf(buf + n, sizeof(buf) - n,
+			      " ring%zu=%zu/%zu ring%zu_drop=%zu",
+			      i, ring_fill(r), r->mask + 1U, i, r->st.ndrop);
+	}
+	if (n >= sizeof(buf) - 1U) {
+		n = sizeof(buf) - 2U;
+	}
+	buf[n++] = '\n';
+	if (UNLIKELY(rstat_write(fd, buf, n) < 0)) {
+		/* they didn't get it, rates stay relative to the last one */
+		return;
+	}
+
+	/* only subscriptions count topics */
+	for (size_t i = 0U, m = 0U;
+	     cur.ntop != NULL && i < ctx->tops.n; i++) {
+		const size_t z = strlen(ctx->tops.v[i]);
+
+		if (m + z + FMT_INT_MAXLEN + 8U > sizeof(buf)) {
+			if (UNLIKELY(rstat_write(fd, buf, m) < 0)) {
+				break;
+			}
+			m = 0U;
+		}
+		memcpy(buf + m, "top\t", 4U);
+		m += 4U;
+		memcpy(buf + m, ctx->tops.v[i], z);
+		m += z;
+		buf[m++] = '\t';
+		m += fmt_u64(buf + m, cur.ntop[i]);
+		buf[m++] = '\n';
+		if (i + 1U >= ctx->tops.n) {
+			rstat_write(fd, buf, m);
+		}
+	}
+	*prev = cur;
+	prev->ntop = NULL;
+	*tprev = now;
+	return;
+}
+
+static blpapi_Session_t*
+sess_make(struct ctx_s *ctx, blpapi_EventDispatcher_t *disp)
+{
+	blpapi_SessionOptions_t *opt;
+	blpapi_Session_t *r;
+
+	if (UNLIKELY((opt = sopt_make(&sopt)) == NULL)) {
+		errno = 0, error("\
+Error: cannot create session options");
+		return NULL;
+	}
+	r = blpapi_Session_create(opt, beef, disp, ctx);
+	blpapi_SessionOptions_destroy(opt);
+	return r;
+}
+
+static bool
+rec_tick(struct ctx_s *ctx, struct ctx_s *sctx,
+	 blpapi_Session_t **sess, size_t nsess, blpapi_EventDispatcher_t *disp)
+{
+/* revive dead sessions whose time has come, and send everyone's next
+ * batch of subscriptions, return whether there is more to do */
+	const uint64_t now = clk_mono();
+	bool morep = false;
+
+	for (size_t i = 0U; i < nsess; i++) {
+		struct ctx_s *c = i ? sctx + i : ctx;
+		uint64_t nap;
+
+		if (!__atomic_load_n(&c->rec.deadp, __ATOMIC_ACQUIRE)) {
+			continue;
+		} else if (now < c->rec.due) {
+			morep = true;
+			continue;
+		}
+		/* back off exponentially, up to a limit */
+		nap = c->rec.ntry < 16U ? REC_NAP << c->rec.ntry : REC_MAXNAP;
+		c->rec.due = now + (nap < REC_MAXNAP ? nap : REC_MAXNAP);
+		c->rec.ntry++;
+		LOGF("session %zu: reconnecting, attempt %u\n", i, c->rec.ntry);
+
+		if (sess[i] != NULL) {
+			blpapi_Session_stop(sess[i]);
+			blpapi_Session_destroy(sess[i]);
+		}
+		__atomic_store_n(&c->rec.deadp, false, __ATOMIC_RELEASE);
+		if (UNLIKELY((sess[i] = sess_make(c, disp)) == NULL ||
+			     blpapi_Session_start(sess[i]))) {
+			errno = 0, error("\
+Warning: cannot restart session %zu", i);
+			__atomic_store_n(&c->rec.deadp, true, __ATOMIC_RELEASE);
+		}
+		morep = true;
+	}
+
+	pthread_mutex_lock(&sublk);
+	for (size_t i = 0U; i < nsess; i++) {
+		struct ctx_s *c = i ? sctx + i : ctx;
+
+		if (!c->rec.gop || c->rec.donep) {
+			continue;
+		} else if (sub_batch(sess[i], c, ctx->tops.n)) {
+			morep = true;
+			continue;
+		}
+		c->rec.donep = true;
+		LOGF("\
+session %zu: %zu subscriptions, %zu with options of their own\n",
+		     i, c->rec.nsub, c->rec.nown);
+		if (c->rec.t0) {
+			const uint64_t d = now - c->rec.t0;
+
+			LOGF("\
+session %zu: recovered after %u attempts in %" PRIu64 ".%03" PRIu64 "s\n",
+			     i, c->rec.ntry,
+			     d / 1000000000U, d / 1000000U % 1000U);
+			c->rec.t0 = 0U;
+			c->rec.ntry = 0U;
+			c->rec.due = 0U;
+		}
+	}
+	pthread_mutex_unlock(&sublk);
+	return morep;
 }
 
 int
 main(int argc, char *argv[])
 {
 	static yuck_t argi[1U];
-	static struct ctx_s ctx = {.argi = argi};
-	blpapi_Session_t *sess;
+	static struct ctx_s ctx = {.argi = argi, .nshard = 1U};
+	/* sessions and their contexts, the first one is CTX itself */
+	blpapi_Session_t **sess = NULL;
+	struct ctx_s *sctx = NULL;
+	size_t nsess = 1U;
+	/* slots per ring, 0 for none */
+	size_t ringz = 0U;
+	/* conflation interval in nanoseconds, 0 for none */
+	int64_t cfl_ivl = 0;
+	blpapi_EventDispatcher_t *disp = NULL;
+	pthread_t wrt;
+	bool wrtp = false;
+	/* room for topics, and the control thread */
+	size_t ntopz = 0U;
+	static struct ctl_s ctl;
+	pthread_t ctlt;
+	bool ctlp = false;
+	/* statistics and the thread serving them */
+	static struct rstat_srv_s srv = {.sok = -1};
+	pthread_t stat;
+	bool statt = false;
 	int rc = 0;
 
 	/* parse options, set up longjmp target and
@@ -682,54 +3728,551 @@ Fatal: cannot parse options");
 		goto out;
 	}
 
+	if (argi->precision_arg) {
+		prec = strtol(argi->precision_arg, NULL, 10);
+		if (UNLIKELY(prec < 0 || prec > 9)) {
+			errno = 0, error("\
+Error: precision must be between 0 and 9");
+			rc = 1;
+			goto out;
+		}
+	}
+
+	if (argi->stamp_arg == NULL || !strcmp(argi->stamp_arg, "event")) {
+		;
+	} else if (!strcmp(argi->stamp_arg, "message")) {
+		stamp_msg_p = true;
+		if (clk_calib() < 0) {
+			LOG("\
+Warning: no invariant TSC, stamping messages using the system clock\n");
+		}
+	} else {
+		errno = 0, error("\
+Error: stamp must be one of `event' or `message'");
+		rc = 1;
+		goto out;
+	}
+
+	if (UNLIKELY(sopt_init(
+			     &sopt, argi->server_args, argi->server_nargs) < 0)) {
+		errno = 0, error("\
+Error: servers must be given as HOST, HOST:PORT or [ADDR]:PORT");
+		rc = 1;
+		goto out;
+	} else if (argi->queue_size_arg &&
+		   !(sopt.qz = strtoul(argi->queue_size_arg, NULL, 10))) {
+		errno = 0, error("\
+Error: queue size must be positive");
+		rc = 1;
+		goto out;
+	} else if (argi->queue_marks_arg &&
+		   (sscanf(argi->queue_marks_arg, "%f,%f",
+			   &sopt.hiwat, &sopt.lowat) != 2 ||
+		    !(sopt.lowat > 0.f && sopt.lowat < sopt.hiwat &&
+		      sopt.hiwat <= 1.f))) {
+		errno = 0, error("\
+Error: queue marks must be HI,LO with 0 < LO < HI <= 1");
+		rc = 1;
+		goto out;
+	} else if (argi->connect_timeout_arg) {
+		const int64_t tmo = dur_strp(argi->connect_timeout_arg);
+
+		if (tmo <= 0) {
+			errno = 0, error("\
+Error: cannot read connect timeout, use 500ms, 2s, etc.");
+			rc = 1;
+			goto out;
+		}
+		/* blpapi wants milliseconds, at least one */
+		sopt.tmo = (tmo + 999999) / 1000000;
+	}
+	sopt_prnt(&sopt);
+
+	if (argi->stats_arg &&
+	    (int64_t)(srv.ivl = dur_strp(argi->stats_arg)) <= 0) {
+		errno = 0, error("\
+Error: statistics interval must be a duration like 500ms or 10s");
+		rc = 1;
+		goto out;
+	} else if (argi->stats_socket_arg &&
+		   (srv.sok = rstat_listen(argi->stats_socket_arg)) < 0) {
+		error("\
+Error: cannot listen on statistics socket `%s'",
+		      argi->stats_socket_arg);
+		rc = 1;
+		goto out;
+	}
+	statp = srv.ivl || srv.sok >= 0;
+
+	ctx.chunk = DFLT_CHUNK;
+	if (argi->chunk_arg && !(ctx.chunk = strtoul(argi->chunk_arg, NULL, 10))) {
+		errno = 0, error("\
+Error: chunk size must be positive");
+		rc = 1;
+		goto out;
+	}
+	ctx.win = DFLT_WIN;
+	if (argi->inflight_arg &&
+	    !(ctx.win = strtoul(argi->inflight_arg, NULL, 10))) {
+		errno = 0, error("\
+Error: number of requests in flight must be positive");
+		rc = 1;
+		goto out;
+	}
+
+	/* collect topics and fields, command line first */
+	if (UNLIKELY(strv_addv(&ctx.tops, argi->topic_args,
+			       argi->topic_nargs) < 0 ||
+		     strv_addv(&ctx.flds, argi->field_args,
+			       argi->field_nargs) < 0)) {
+		error("\
+Error: cannot collect topics and fields");
+		rc = 1;
+		goto out;
+	} else if (argi->topics_from_arg &&
+		   strv_load(&ctx.tops, argi->topics_from_arg) < 0) {
+		error("\
+Error: cannot read topics from `%s'", argi->topics_from_arg);
+		rc = 1;
+		goto out;
+	} else if (argi->fields_from_arg &&
+		   strv_load(&ctx.flds, argi->fields_from_arg) < 0) {
+		error("\
+Error: cannot read fields from `%s'", argi->fields_from_arg);
+		rc = 1;
+		goto out;
+	}
+
 	/* barf early if there's no command */
 	if (UNLIKELY(!argi->cmd)) {
 		errno = 0, error("\
 Error: no command given.  See --help.");
 		rc = 1;
 		goto out;
+	} else if (argi->cmd == BLPCLI_CMD_GET) {
+		if (argi->get.bulk_arg == NULL ||
+		    !strcmp(argi->get.bulk_arg, "nested")) {
+			;
+		} else if (!strcmp(argi->get.bulk_arg, "rows")) {
+			bulk_rows_p = true;
+		} else {
+			errno = 0, error("\
+Error: bulk must be one of `nested' or `rows'");
+			rc = 1;
+			goto out;
+		}
+		if (argi->get.ttl_arg &&
+		    (cache_ttl = dur_strp(argi->get.ttl_arg)) <= 0) {
+			errno = 0, error("\
+Error: time to live must be a duration like 12h or 7d");
+			rc = 1;
+			goto out;
+		} else if (argi->get.cache_arg &&
+			   (cache = make_rcache(argi->get.cache_arg)) == NULL) {
+			/* the server still knows */
+			error("\
+Warning: cannot open cache `%s', going without", argi->get.cache_arg);
+		}
+	} else if (argi->cmd == BLPCLI_CMD_HIST) {
+		const struct yuck_cmd_hist_s *ha = &argi->hist;
+
+		if (rng_init(&ctx.rng, ha->from_arg, ha->till_arg,
+			     ha->span_arg, 86400, DFLT_SPAN) < 0) {
+			rc = 1;
+			goto out;
+		}
+	} else if (argi->cmd == BLPCLI_CMD_BARS) {
+		const struct yuck_cmd_bars_s *ba = &argi->bars;
+
+		if (UNLIKELY(!ctx.tops.n)) {
+			errno = 0, error("\
+Error: bars needs at least one security, see -T");
+			rc = 1;
+			goto out;
+		} else if (rng_init(&ctx.rng, ba->from_arg, ba->till_arg,
+			     ba->span_arg, 60, DFLT_BARS_SPAN) < 0) {
+			rc = 1;
+			goto out;
+		}
+		ctx.bars.ivl = DFLT_BARS_IVL;
+		if (ba->interval_arg &&
+		    (ctx.bars.ivl = strtol(ba->interval_arg, NULL, 10)) <= 0) {
+			errno = 0, error("\
+Error: interval must be a positive number of minutes");
+			rc = 1;
+			goto out;
+		}
+		ctx.bars.evt = ba->event_arg ? ba->event_arg : "TRADE";
+		if (!ctx.flds.n && UNLIKELY(strv_addv(
+			    &ctx.flds, deconst(bars_flds),
+			    countof(bars_flds)) < 0)) {
+			error("\
+Error: cannot collect fields");
+			rc = 1;
+			goto out;
+		}
+	} else if (argi->cmd == BLPCLI_CMD_TICKS) {
+		const struct yuck_cmd_ticks_s *ta = &argi->ticks;
+		static char *dflt_evts[] = {"TRADE"};
+
+		if (UNLIKELY(!ctx.tops.n)) {
+			errno = 0, error("\
+Error: ticks needs at least one security, see -T");
+			rc = 1;
+			goto out;
+		} else if (rng_init(&ctx.rng, ta->from_arg, ta->till_arg,
+				    NULL, 86400, 1) < 0) {
+			rc = 1;
+			goto out;
+		}
+		if (ta->event_nargs) {
+			ctx.ticks.evts = ta->event_args;
+			ctx.ticks.nevt = ta->event_nargs;
+		} else {
+			ctx.ticks.evts = dflt_evts;
+			ctx.ticks.nevt = countof(dflt_evts);
+		}
+		ctx.ticks.dir = ta->output_dir_arg ? ta->output_dir_arg : ".";
+
+		/* a tick buffer for every request in flight */
+		ctx.ticks.slot = calloc(ctx.win, sizeof(*ctx.ticks.slot));
+		if (UNLIKELY(ctx.ticks.slot == NULL)) {
+			error("\
+Error: cannot allocate tick buffers");
+			rc = 1;
+			goto out;
+		}
+		for (; ctx.ticks.nslot < ctx.win; ctx.ticks.nslot++) {
+			struct tslot_s *ts = ctx.ticks.slot + ctx.ticks.nslot;
+
+			if (UNLIKELY((ts->tc = make_tcol(TICK_CAP)) == NULL)) {
+				error("\
+Error: cannot allocate tick buffers");
+				rc = 1;
+				goto out;
+			}
+		}
+	} else if (argi->cmd != BLPCLI_CMD_SUB) {
+		;
+	} else if (argi->sub.sessions_arg &&
+		   !(nsess = strtoul(argi->sub.sessions_arg, NULL, 10))) {
+		errno = 0, error("\
+Error: number of sessions must be positive");
+		rc = 1;
+		goto out;
+	} else if (argi->sub.ring_arg &&
+		   !(ringz = strtoul(argi->sub.ring_arg, NULL, 10))) {
+		errno = 0, error("\
+Error: ring size must be positive");
+		rc = 1;
+		goto out;
+	} else if (argi->sub.dispatch_arg &&
+		   !(ctx.ndisp = strtoul(argi->sub.dispatch_arg, NULL, 10))) {
+		errno = 0, error("\
+Error: number of dispatcher threads must be positive");
+		rc = 1;
+		goto out;
+	} else if (argi->sub.conflate_arg &&
+		   (cfl_ivl = dur_strp(argi->sub.conflate_arg)) <= 0) {
+		errno = 0, error("\
+Error: conflation interval must be a duration like 100ms or 2s");
+		rc = 1;
+		goto out;
+	} else if (cfl_ivl > 0 && ringz) {
+		errno = 0, error("\
+Error: --conflate and --ring cannot be used together");
+		rc = 1;
+		goto out;
+	} else if (argi->sub.output_arg == NULL ||
+		   !strcmp(argi->sub.output_arg, "text")) {
+		;
+	} else if (!strcmp(argi->sub.output_arg, "binary")) {
+		bin_out_p = true;
+	} else {
+		errno = 0, error("\
+Error: output must be one of `text' or `binary'");
+		rc = 1;
+		goto out;
+	}
+	if (argi->cmd != BLPCLI_CMD_SUB) {
+		;
+	} else if (argi->sub.control_arg && bin_out_p) {
+		errno = 0, error("\
+Error: --control only works with text output");
+		rc = 1;
+		goto out;
+	} else if (argi->sub.control_arg && argi->topics_from_arg &&
+		   !strcmp(argi->sub.control_arg, "-") &&
+		   !strcmp(argi->topics_from_arg, "-")) {
+		errno = 0, error("\
+Error: topics and control lines cannot both come from stdin");
+		rc = 1;
+		goto out;
+	} else if (argi->sub.control_arg &&
+		   UNLIKELY(strv_resv(&ctx.tops, CTL_ROOM) < 0)) {
+		error("\
+Error: cannot allocate topics");
+		rc = 1;
+		goto out;
+	} else if ((ntopz = ctx.tops.n +
+		    (argi->sub.control_arg ? CTL_ROOM : 0U)) &&
+		   UNLIKELY((ctx.topts = calloc(
+				     ntopz, sizeof(*ctx.topts))) == NULL ||
+			    (ctx.subp = calloc(ntopz, 1U)) == NULL)) {
+		error("\
+Error: cannot allocate subscription options");
+		rc = 1;
+		goto out;
+	} else {
+		/* subscription options, for all topics and per topic */
+		ctx.gopts = argi->sub.option_args;
+		ctx.ngopt = argi->sub.option_nargs;
+		for (size_t i = 0U; i < ctx.tops.n; i++) {
+			ctx.topts[i] = topt_split(ctx.tops.v[i]);
+			ctx.subp[i] = 1U;
+		}
+		for (size_t i = 0U; i < ctx.ngopt; i++) {
+			LOGF("subscription option for all topics: %s\n",
+			     ctx.gopts[i]);
+		}
 	}
 
-	/* we can't do with interruptions */
-	block_sigs();
+	if (argi->cmd != BLPCLI_CMD_SUB || argi->sub.slow_arg == NULL ||
+	    !strcmp(argi->sub.slow_arg, "block")) {
+		;
+	} else if (!strcmp(argi->sub.slow_arg, "drop")) {
+		slow_pol = SLOW_DROP;
+	} else if (strcmp(argi->sub.slow_arg, "conflate")) {
+		errno = 0, error("\
+Error: slow consumer policy must be one of `block', `drop' or `conflate'");
+		rc = 1;
+		goto out;
+	} else if (cfl_ivl > 0 || ringz || ctx.ndisp > 1U) {
+		errno = 0, error("\
+Error: --slow=conflate cannot be used with --conflate, --ring or --dispatch");
+		rc = 1;
+		goto out;
+	} else {
+		slow_pol = SLOW_CFL;
+		cfl_ivl = SLOW_IVL;
+	}
 
-	/* get ourselves a session handle */
-	with (blpapi_SessionOptions_t *opt) {
-		/* suppress blpapi messages */
-		setbuf(stdout, NULL);
+	/* get ourselves an output buffer */
+	if (UNLIKELY((ctx.out = make_obuf(
+			      STDOUT_FILENO, OBUF_CHNZ, OBUF_NCHN)) == NULL)) {
+		error("\
+Error: cannot allocate output buffer");
+		rc = 1;
+		goto out;
+	}
+	obuf_set_thresh(ctx.out, OBUF_HIWAT, OBUF_MAXLAT);
+	if (bin_out_p) {
+		bin_dict(&ctx);
+	}
+	if (cache != NULL) {
+		/* cached securities first, only the rest is requested */
+		const size_t n = cache_dump(&ctx);
+
+		LOGF("cache: %zu of %zu securities cached\n",
+		     n, n + ctx.tops.n);
+		if (n && !ctx.tops.n) {
+			goto out;
+		}
+	}
+	if ((ctx.ndisp > 1U || nsess > 1U || slow_pol == SLOW_CFL) &&
+	    !ringz && (!cfl_ivl || slow_pol == SLOW_CFL)) {
+		/* dispatcher threads and sessions hand their records to
+		 * the writer, and so do we while we don't conflate */
+		ringz = DFLT_RING;
+	}
+	if (ringz) {
+		/* a ring per callback thread and a spare, or just one,
+		 * sessions get a thread each unless there's a dispatcher */
+		const size_t nthr = ctx.ndisp ? ctx.ndisp : nsess;
+		const size_t n = nthr > 1U ? nthr + 1U : 1U;
+		const size_t z = sizeof(struct rrec_s) +
+			ctx.flds.n * sizeof(struct rval_s);
 
-		if (UNLIKELY((opt = blpapi_SessionOptions_create()) == NULL)) {
+		if (UNLIKELY((ctx.ring = calloc(n, sizeof(*ctx.ring))) == NULL)) {
 			error("\
-Error: cannot create session options");
+Error: cannot allocate ring");
 			rc = 1;
 			goto out;
 		}
-		/* otherwise set them according to our command-line flags */
-		blpapi_SessionOptions_setServerHost(opt, "localhost");
-		blpapi_SessionOptions_setServerPort(opt, 8194);
-		blpapi_SessionOptions_setMaxEventQueueSize(opt, 8192);
+		for (; ctx.nring < n; ctx.nring++) {
+			ring_t *q = ctx.ring + ctx.nring;
+
+			if (UNLIKELY((*q = make_ring(ringz, z)) == NULL)) {
+				error("\
+Error: cannot allocate ring");
+				rc = 1;
+				goto out;
+			}
+		}
+		ctx.hold = n > 1U ? WRT_HOLD : 0U;
+	}
+	if (cfl_ivl > 0) {
+		static struct cfl_s cf = {.lk = PTHREAD_MUTEX_INITIALIZER};
+		const size_t n = ntopz;
 
-		sess = blpapi_Session_create(opt, beef, NULL, &ctx);
-		blpapi_SessionOptions_destroy(opt);
+		cf.ivl = cfl_ivl;
+		cf.autop = slow_pol == SLOW_CFL;
+		cf.onp = !cf.autop;
+		cf.slotz = sizeof(struct rrec_s) +
+			ctx.flds.n * sizeof(struct rval_s);
+		cf.nslot = n;
+		if (n && UNLIKELY((cf.slot = calloc(n, cf.slotz)) == NULL ||
+				  (cf.snap = calloc(n, cf.slotz)) == NULL ||
+				  (cf.dirtp = calloc(n, 1U)) == NULL ||
+				  (cf.dirt = calloc(n, sizeof(*cf.dirt))) == NULL)) {
+			error("\
+Error: cannot allocate conflation slots");
+			rc = 1;
+			goto out;
+		}
+		for (size_t i = 0U; i < n; i++) {
+			struct rrec_s *r = (void*)(cf.slot + i * cf.slotz);
+			r->tid = i;
+		}
+		ctx.cfl = &cf;
 	}
 
-	/* check session handle before we continue with the setup*/
-	if (UNLIKELY(sess == NULL)) {
+	/* we can't do with interruptions */
+	block_sigs();
+
+	/* one context per session, topics are spread by hash */
+	if (UNLIKELY((sess = calloc(nsess, sizeof(*sess))) == NULL ||
+		     (sctx = calloc(nsess, sizeof(*sctx))) == NULL)) {
+		error("\
+Error: cannot allocate sessions");
+		rc = 1;
+		goto out;
+	} else if (nsess > 1U &&
+		   UNLIKELY((ctx.ftab = make_fldtab(
+				     deconst(ctx.flds.v), ctx.flds.n)) == NULL)) {
+		/* resolve them here, once for all sessions */
 		errno = 0, error("\
-Error: cannot set up session");
+Error: cannot resolve field names");
 		rc = 1;
 		goto out;
-	} else if (blpapi_Session_start(sess)) {
+	}
+	ctx.nshard = nsess;
+	for (size_t i = 1U; i < nsess; i++) {
+		sctx[i] = ctx;
+		sctx[i].shard = i;
+	}
+	/* the writer inherits our signal mask */
+	if (ctx.ring != NULL || ctx.cfl != NULL) {
+		void*(*loop)(void*) = ctx.cfl != NULL ? cfl_loop : wrt_loop;
+
+		if (UNLIKELY(pthread_create(&wrt, NULL, loop, &ctx))) {
+			error("\
+Error: cannot start writer thread");
+			rc = 1;
+			goto out;
+		}
+		wrtp = true;
+	}
+	/* a pool of threads to call us back, instead of one per session */
+	if (ctx.ndisp && UNLIKELY((disp = blpapi_EventDispatcher_create(
+					   ctx.ndisp)) == NULL ||
+			      blpapi_EventDispatcher_start(disp))) {
 		errno = 0, error("\
-Error: cannot start session");
+Error: cannot start event dispatcher");
+		rc = 1;
+		goto out;
+	}
+
+	/* counters for every topic there's room for */
+	if (statp && UNLIKELY(rstat_init(ntopz) < 0 ||
+			      (ntopz && (stat_tops = calloc(
+						 ntopz, sizeof(*stat_tops))) == NULL))) {
+		error("\
+Error: cannot allocate statistics");
 		rc = 1;
 		goto out;
+	} else if (statp) {
+		srv.prnt = stat_prnt;
+		srv.clo = &ctx;
+		/* first rates are since now */
+		stat_tprev[0U] = stat_tprev[1U] = clk_mono();
+		if (UNLIKELY(pthread_create(&stat, NULL, rstat_loop, &srv))) {
+			error("\
+Error: cannot start statistics thread");
+			rc = 1;
+			goto out;
+		}
+		statt = true;
+	}
+
+	/* suppress blpapi messages */
+	setbuf(stdout, NULL);
+
+	/* get ourselves session handles */
+	for (size_t i = 0U; i < nsess; i++) {
+		struct ctx_s *c = i ? sctx + i : &ctx;
+
+		sess[i] = sess_make(c, disp);
+
+		/* check session handle before we continue with the setup*/
+		if (UNLIKELY(sess[i] == NULL)) {
+			errno = 0, error("\
+Error: cannot set up session");
+			rc = 1;
+			goto out;
+		} else if (blpapi_Session_start(sess[i])) {
+			errno = 0, error("\
+Error: cannot start session");
+			rc = 1;
+			goto out;
+		}
+	}
+
+	/* subscription changes while we're running */
+	if (argi->cmd == BLPCLI_CMD_SUB && argi->sub.control_arg) {
+		ctl = (struct ctl_s){
+			.fn = argi->sub.control_arg,
+			.ctx = &ctx,
+			.sctx = sctx,
+			.sess = sess,
+			.nsess = nsess,
+			.ntopz = ntopz,
+		};
+		if (UNLIKELY((ctl.tt = make_ttab(ntopz)) == NULL ||
+			     (ctl.flds = calloc(ctx.flds.n + 1U,
+						sizeof(*ctl.flds))) == NULL)) {
+			error("\
+Error: cannot allocate topic table");
+			rc = 1;
+			goto out;
+		}
+		for (size_t i = 0U; i < ctx.tops.n; i++) {
+			ttab_put(ctl.tt, ctx.tops.v, i);
+		}
+		memcpy(ctl.flds, ctx.flds.v, ctx.flds.n * sizeof(*ctl.flds));
+		ctl.nflds = ctx.flds.n;
+		if (UNLIKELY(pthread_create(&ctlt, NULL, ctl_loop, &ctl))) {
+			error("\
+Error: cannot start control thread");
+			rc = 1;
+			goto out;
+		}
+		ctlp = true;
 	}
 
 	/* sleep and let the bloomberg thread do the hard work */
 	with (sigset_t sigs[1U]) {
+		const struct timespec tick = {.tv_nsec = SUB_TICK};
+		bool morep = false;
+
 		sigfillset(sigs);
-		for (int sig; !sigwait(sigs, &sig);) {
+		for (int sig;; morep = argi->cmd == BLPCLI_CMD_SUB &&
+			     rec_tick(&ctx, sctx, sess, nsess, disp)) {
+			/* subscribers wake up for batches and reconnects */
+			if ((sig = sigtimedwait(
+				     sigs, NULL, morep ? &tick : NULL)) < 0) {
+				continue;
+			}
 			switch (sig) {
 			case SIGQUIT:
 			case SIGINT:
@@ -737,6 +4280,15 @@ Error: cannot start session");
 				LOG("GOT INT\n");
 				goto out;
 
+			case SIGUSR1:
+				lat_prnt(&lat);
+				ring_prnt(&ctx);
+				break;
+
+			case SIGUSR2:
+				/* see rec_tick() */
+				break;
+
 			default:
 				LOGF("GOT SIG %d\n", sig);
 				break;
@@ -745,12 +4297,128 @@ Error: cannot start session");
 	}
 
 out:
+	/* sessions terminating from now on are ours */
+	__atomic_store_n(&endp, true, __ATOMIC_RELEASE);
+	signal(SIGUSR2, SIG_IGN);
 	unblock_sigs();
+	if (ctlp) {
+		pthread_cancel(ctlt);
+		pthread_join(ctlt, NULL);
+	}
+	if (statt) {
+		pthread_cancel(stat);
+		pthread_join(stat, NULL);
+	}
+	if (srv.sok >= 0) {
+		close(srv.sok);
+		unlink(argi->stats_socket_arg);
+	}
+	for (size_t i = 0U; sess != NULL && i < nsess; i++) {
+		if (sess[i] != NULL) {
+			blpapi_Session_stop(sess[i]);
+			blpapi_Session_destroy(sess[i]);
+		}
+	}
 	if (sess != NULL) {
-		blpapi_Session_stop(sess);
-		blpapi_Session_destroy(sess);
-		sess = NULL;
+		free(sess);
+	}
+	for (size_t i = 0U; sctx != NULL && i < nsess; i++) {
+		struct ctx_s *c = i ? sctx + i : &ctx;
+
+		sopt_qlo(&c->qst, clk_mono());
+		sopt_qprnt(&c->qst, i);
+	}
+	if (disp != NULL) {
+		blpapi_EventDispatcher_stop(disp, 0);
+		blpapi_EventDispatcher_destroy(disp);
+	}
+	if (wrtp) {
+		/* no more producers, let the writer drain what's left */
+		__atomic_store_n(&wrt_quit, true, __ATOMIC_RELEASE);
+		pthread_join(wrt, NULL);
+	}
+	if (ctx.cfl != NULL) {
+		LOGF("conflate: %zu updates in %zu records\n",
+		     ctx.cfl->nupd, ctx.cfl->nout);
+		free(ctx.cfl->slot);
+		free(ctx.cfl->snap);
+		free(ctx.cfl->dirtp);
+		free(ctx.cfl->dirt);
+	}
+	if (ctx.ring != NULL) {
+		ring_prnt(&ctx);
+		for (size_t i = 0U; i < ctx.nring; i++) {
+			free_ring(ctx.ring[i]);
+		}
+		free(ctx.ring);
+	}
+	if (sctx != NULL) {
+		free(sctx);
+	}
+	if (ctx.out != NULL) {
+		const struct obuf_stat_s *st = &ctx.out->st;
+
+		obuf_flush(ctx.out);
+		LOGF("\
+output: %zu records, %zu bytes in %zu writes (%zu flushes)\n",
+		     st->nrec, st->nbyt, st->nsys, st->nflu);
+		if (UNLIKELY(ctx.out->err)) {
+			errno = ctx.out->err, error("\
+Error: cannot write output");
+			rc = 1;
+		}
+		free_obuf(ctx.out);
+	}
+	if (ctx.ftab != NULL) {
+		free_fldtab(ctx.ftab);
+	}
+	if (cache != NULL) {
+		LOGF("cache: %zu entries\n", rcache_size(cache));
+		free_rcache(cache);
+	}
+	fini_rnam();
+	lat_prnt(&lat);
+	strv_free(&ctx.tops);
+	strv_free(&ctx.flds);
+	if (ctx.topts != NULL) {
+		free(ctx.topts);
+	}
+	if (ctx.subp != NULL) {
+		free(ctx.subp);
+	}
+	if (ctl.f != NULL && ctl.f != stdin) {
+		fclose(ctl.f);
+	}
+	if (ctl.tt != NULL) {
+		free_ttab(ctl.tt);
+	}
+	if (ctl.flds != NULL) {
+		free(ctl.flds);
+	}
+	for (size_t i = 0U; i < ctl.own.n; i++) {
+		free(ctl.own.v[i]);
+	}
+	strv_free(&ctl.own);
+	if (ctx.rsch.st != NULL) {
+		LOGF("requests: %zu of %zu done, %zu failed\n",
+		     ctx.rsch.ndone, ctx.rsch.nreq, ctx.rsch.nfail);
+		rsch_fini(&ctx.rsch);
+	}
+	if (ctx.ticks.slot != NULL) {
+		for (size_t i = 0U; i < ctx.ticks.nslot; i++) {
+			/* requests cut short keep what they've got */
+			tcol_close(ctx.ticks.slot[i].tc);
+			free_tcol(ctx.ticks.slot[i].tc);
+		}
+		LOGF("ticks: %zu in %zu files\n",
+		     ctx.ticks.ntick, ctx.ticks.nfile);
+		free(ctx.ticks.slot);
+	}
+	if (statp) {
+		rstat_fini();
+		free(stat_tops);
 	}
+	sopt_fini(&sopt);
 	yuck_free(argi);
 	return rc;
 }
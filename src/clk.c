@@ -0,0 +1,101 @@
+/*** clk.c -- cheap wall-clock readings
+ *
+ * Copyright (C) 2013-2015 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of blpcli.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdint.h>
+#include <time.h>
+#if defined __x86_64__ || defined __i386__
+# include <cpuid.h>
+#endif	/* x86 */
+#include "clk.h"
+#include "nifty.h"
+
+uint64_t clk_mul;
+
+
+static int
+tsc_invariant_p(void)
+{
+#if defined __x86_64__ || defined __i386__
+	unsigned int a, b, c, d;
+
+	/* advanced power management leaf, bit 8 of edx */
+	if (!__get_cpuid(0x80000000U, &a, &b, &c, &d) || a < 0x80000007U) {
+		return 0;
+	} else if (!__get_cpuid(0x80000007U, &a, &b, &c, &d)) {
+		return 0;
+	}
+	return (d >> 8U) & 1U;
+#else  /* !x86 */
+	return 0;
+#endif	/* x86 */
+}
+
+static uint64_t
+mono(void)
+{
+	struct timespec tsp;
+
+	clock_gettime(CLOCK_MONOTONIC, &tsp);
+	return tsp.tv_sec * 1000000000ULL + tsp.tv_nsec;
+}
+
+int
+clk_calib(void)
+{
+	static const struct timespec nap = {0, 10000000};
+	uint64_t t0, t1, c0, c1;
+
+	if (!tsc_invariant_p()) {
+		clk_mul = 0U;
+		return -1;
+	}
+	t0 = mono();
+	c0 = clk_tsc();
+	nanosleep(&nap, NULL);
+	t1 = mono();
+	c1 = clk_tsc();
+	if (UNLIKELY(c1 <= c0)) {
+		clk_mul = 0U;
+		return -1;
+	}
+	clk_mul = ((t1 - t0) << CLK_SHF) / (c1 - c0);
+	return 0;
+}
+
+/* clk.c ends here */
@@ -0,0 +1,116 @@
+/*** clk.h -- cheap wall-clock readings
+ *
+ * Copyright (C) 2013-2015 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of blpcli.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if !defined INCLUDED_clk_h_
+#define INCLUDED_clk_h_
+#include <stdint.h>
+#include <time.h>
+#if defined __x86_64__ || defined __i386__
+# include <x86intrin.h>
+#endif	/* x86 */
+
+/**
+ * Clocks are synchronised with CLOCK_REALTIME through clk_sync() and
+ * extrapolated from there using the processor's time-stamp counter,
+ * where that is invariant, or the vDSO clock otherwise. */
+struct clk_s {
+	/* cycle count and realtime nanoseconds at the last sync */
+	uint64_t tsc;
+	uint64_t ns;
+};
+
+/* nanoseconds per cycle, as fixed point with CLK_SHF fractional bits,
+ * 0 if there's no usable time-stamp counter */
+extern uint64_t clk_mul;
+#define CLK_SHF		(24U)
+
+/**
+ * Determine clk_mul, this takes about 10ms.
+ * Return 0 on success or -1 if there's no usable time-stamp counter. */
+extern int clk_calib(void);
+
+
+static inline uint64_t
+clk_tsc(void)
+{
+#if defined __x86_64__ || defined __i386__
+	return __rdtsc();
+#else  /* !x86 */
+	return 0U;
+#endif	/* x86 */
+}
+
+static inline uint64_t
+clk_rt(void)
+{
+	struct timespec tsp;
+
+	clock_gettime(CLOCK_REALTIME, &tsp);
+	return tsp.tv_sec * 1000000000ULL + tsp.tv_nsec;
+}
+
+static inline uint64_t
+clk_mono(void)
+{
+	struct timespec tsp;
+
+	clock_gettime(CLOCK_MONOTONIC, &tsp);
+	return tsp.tv_sec * 1000000000ULL + tsp.tv_nsec;
+}
+
+/**
+ * Synchronise C with the realtime clock, return the time in nanoseconds
+ * since the epoch. */
+static inline uint64_t
+clk_sync(struct clk_s *c)
+{
+	c->ns = clk_rt();
+	c->tsc = clk_tsc();
+	return c->ns;
+}
+
+/**
+ * Return nanoseconds since the epoch as extrapolated from C. */
+static inline uint64_t
+clk_now(const struct clk_s *c)
+{
+	if (!clk_mul) {
+		return clk_rt();
+	}
+	return c->ns + (((clk_tsc() - c->tsc) * clk_mul) >> CLK_SHF);
+}
+
+#endif	/* INCLUDED_clk_h_ */
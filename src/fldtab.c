@@ -0,0 +1,183 @@
+/*** fldtab.c -- pre-resolved field names
+ *
+ * Copyright (C) 2013-2015 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of blpcli.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <string.h>
+#include <blpapi_element.h>
+#include <blpapi_name.h>
+#include "fldtab.h"
+#include "nifty.h"
+
+
+static uint64_t
+xorshift64(uint64_t x)
+{
+	x ^= x << 13U;
+	x ^= x >> 7U;
+	x ^= x << 17U;
+	return x;
+}
+
+static int
+fldtab_hash(fldtab_t ft)
+{
+/* find a multiplier that maps all distinct name handles to distinct
+ * slots, start out with twice as many slots as names and grow */
+	struct fldtab_slot_s *htab;
+	unsigned int k = 1U;
+
+	for (size_t nu = ft->nuniq; nu >>= 1U; k++);
+	for (; k < 24U; k++) {
+		const size_t nslot = (size_t)1U << k;
+		uint64_t mul = 0x9e3779b97f4a7c15ULL;
+
+		if (UNLIKELY((htab = malloc(nslot * sizeof(*htab))) == NULL)) {
+			return -1;
+		}
+		for (size_t try = 0U; try < 256U; try++) {
+			size_t i;
+
+			memset(htab, 0, nslot * sizeof(*htab));
+			for (i = 0U; i < ft->nflds; i++) {
+				const blpapi_Name_t *nam = ft->nams[i];
+				size_t h;
+
+				if (ft->canon[i] != i || UNLIKELY(nam == NULL)) {
+					continue;
+				}
+				h = ((uintptr_t)nam * mul) >> (64U - k);
+				if (htab[h].nam != NULL) {
+					break;
+				}
+				htab[h].nam = nam;
+				htab[h].col = i;
+			}
+			if (i >= ft->nflds) {
+				/* no collisions */
+				ft->hmul = mul;
+				ft->hshf = 64U - k;
+				ft->htab = htab;
+				return 0;
+			}
+			mul = xorshift64(mul) | 1U;
+		}
+		free(htab);
+	}
+	return -1;
+}
+
+
+fldtab_t
+make_fldtab(const char *const *flds, size_t nflds)
+{
+	fldtab_t ft;
+
+	/* name handles and canonical columns go right behind the table */
+	if (UNLIKELY((ft = malloc(
+			      sizeof(*ft) + nflds * sizeof(*ft->nams) +
+			      nflds * sizeof(*ft->canon))) == NULL)) {
+		return NULL;
+	}
+	ft->nams = (void*)(ft + 1U);
+	ft->canon = (void*)(ft->nams + nflds);
+	for (size_t i = 0U; i < nflds; i++) {
+		ft->nams[i] = blpapi_Name_create(flds[i]);
+		/* names are unique, so duplicates share the handle */
+		for (ft->canon[i] = 0U;
+		     ft->canon[i] < i && ft->nams[ft->canon[i]] != ft->nams[i];
+		     ft->canon[i]++);
+	}
+	ft->flds = flds;
+	ft->nflds = nflds;
+	ft->nuniq = 0U;
+	ft->htab = NULL;
+	for (size_t i = 0U; i < nflds; i++) {
+		ft->nuniq += ft->canon[i] == i && ft->nams[i] != NULL;
+	}
+
+	if (UNLIKELY(fldtab_hash(ft) < 0)) {
+		free_fldtab(ft);
+		return NULL;
+	}
+	return ft;
+}
+
+void
+free_fldtab(fldtab_t ft)
+{
+	for (size_t i = 0U; i < ft->nflds; i++) {
+		if (LIKELY(ft->nams[i] != NULL)) {
+			blpapi_Name_destroy(ft->nams[i]);
+		}
+	}
+	if (ft->htab != NULL) {
+		free(ft->htab);
+	}
+	free(ft);
+	return;
+}
+
+size_t
+fldtab_scan(fldtab_t ft, blpapi_Element_t **cols, const blpapi_Element_t *els)
+{
+	const size_t nel = blpapi_Element_numElements(els);
+	size_t nfnd = 0U;
+
+	for (size_t i = 0U; i < ft->nflds; i++) {
+		cols[i] = NULL;
+	}
+	for (size_t i = 0U; i < nel; i++) {
+		blpapi_Element_t *e;
+		ssize_t c;
+
+		if (UNLIKELY(blpapi_Element_getElementAt(els, &e, i))) {
+			continue;
+		} else if ((c = fldtab_col(ft, blpapi_Element_name(e))) < 0) {
+			continue;
+		}
+		cols[c] = e;
+		if (++nfnd >= ft->nuniq) {
+			/* can't get any better than this */
+			break;
+		}
+	}
+	return nfnd;
+}
+
+/* fldtab.c ends here */
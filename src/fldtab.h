@@ -0,0 +1,102 @@
+/*** fldtab.h -- pre-resolved field names
+ *
+ * Copyright (C) 2013-2015 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of blpcli.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if !defined INCLUDED_fldtab_h_
+#define INCLUDED_fldtab_h_
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <blpapi_element.h>
+#include <blpapi_name.h>
+
+/**
+ * Field tables map the user's field list onto blpapi name handles
+ * so that element lookups on the hot path need no string hashing. */
+typedef struct fldtab_s *fldtab_t;
+
+struct fldtab_s {
+	size_t nflds;
+	const char *const *flds;
+	blpapi_Name_t **nams;
+	/* column that holds the value of a column, for duplicate fields */
+	size_t *canon;
+	size_t nuniq;
+
+	/* perfect hash over name handles, slot is (NAM * HMUL) >> HSHF */
+	uint64_t hmul;
+	unsigned int hshf;
+	struct fldtab_slot_s {
+		const blpapi_Name_t *nam;
+		size_t col;
+	} *htab;
+};
+
+
+/**
+ * Resolve the NFLDS field names FLDS into name handles.
+ * FLDS must stay valid for the lifetime of the table. */
+extern fldtab_t make_fldtab(const char *const *flds, size_t nflds);
+
+/**
+ * Release name handles and resources of field table FT. */
+extern void free_fldtab(fldtab_t ft);
+
+/**
+ * Walk the elements of ELS once and put those in FT into the slot array
+ * COLS (of FT->nflds entries) according to their column.
+ * Return the number of columns found. */
+extern size_t fldtab_scan(fldtab_t ft, blpapi_Element_t **cols,
+			  const blpapi_Element_t *els);
+
+
+/**
+ * Return the column of name handle NAM in FT or -1 if not in FT. */
+static inline ssize_t
+fldtab_col(fldtab_t ft, const blpapi_Name_t *nam)
+{
+	const size_t h = ((uintptr_t)nam * ft->hmul) >> ft->hshf;
+	return ft->htab[h].nam == nam ? (ssize_t)ft->htab[h].col : -1;
+}
+
+/**
+ * Return the element in the slot array COLS for column I. */
+static inline blpapi_Element_t*
+fldtab_el(fldtab_t ft, blpapi_Element_t *const *cols, size_t i)
+{
+	return cols[ft->canon[i]];
+}
+
+#endif	/* INCLUDED_fldtab_h_ */
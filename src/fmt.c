@@ -0,0 +1,457 @@
+/*** fmt.c -- allocation-free number formatting
+ *
+ * Copyright (C) 2013-2015 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of blpcli.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdint.h>
+#include <string.h>
+#include "fmt.h"
+#include "nifty.h"
+
+/* pairs of digits, 00 to 99 */
+static const char dig2[200U] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+static const uint32_t pow10_32[] = {
+	1U, 10U, 100U, 1000U, 10000U, 100000U,
+	1000000U, 10000000U, 100000000U, 1000000000U,
+};
+
+static unsigned int
+ndig_u64(uint64_t x)
+{
+	unsigned int n = 1U;
+
+	for (; x >= 10000U; x /= 10000U, n += 4U) {
+		if (x < 100000U) {
+			return n + 4U;
+		}
+	}
+	return n + (x >= 10U) + (x >= 100U) + (x >= 1000U);
+}
+
+static void
+put_u64(char *restrict buf, uint64_t x, unsigned int n)
+{
+/* write the N digits of X backwards into BUF */
+	for (; x >= 100U; x /= 100U, n -= 2U) {
+		memcpy(buf + n - 2U, dig2 + 2U * (x % 100U), 2U);
+	}
+	if (x >= 10U) {
+		memcpy(buf + n - 2U, dig2 + 2U * x, 2U);
+	} else {
+		buf[n - 1U] = (char)('0' + x);
+	}
+	return;
+}
+
+
+/* grisu2, after Loitsch's Printing Floating-Point Numbers Quickly and
+ * Accurately with Integers, 2010 */
+typedef struct {
+	uint64_t f;
+	int e;
+} diyfp_t;
+
+/* normalised powers of ten, 10^-348 to 10^340 in steps of 8 */
+static const uint64_t cpow_f[] = {
+	0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL,
+	0xcf42894a5dce35eaULL, 0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL,
+	0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL, 0xbe5691ef416bd60cULL,
+	0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+	0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL,
+	0xc21094364dfb5637ULL, 0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL,
+	0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL, 0xb23867fb2a35b28eULL,
+	0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+	0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL,
+	0xb5b5ada8aaff80b8ULL, 0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL,
+	0x964e858c91ba2655ULL, 0xdff9772470297ebdULL, 0xa6dfbd9fb8e5b88fULL,
+	0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+	0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL,
+	0xaa242499697392d3ULL, 0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL,
+	0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL, 0x9c40000000000000ULL,
+	0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+	0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL,
+	0x9f4f2726179a2245ULL, 0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL,
+	0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL, 0x924d692ca61be758ULL,
+	0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+	0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL,
+	0x952ab45cfa97a0b3ULL, 0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL,
+	0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL, 0x88fcf317f22241e2ULL,
+	0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+	0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL,
+	0x8bab8eefb6409c1aULL, 0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL,
+	0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL, 0x80444b5e7aa7cf85ULL,
+	0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+	0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL,
+};
+
+static const int16_t cpow_e[] = {
+	-1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034,
+	-1007, -980, -954, -927, -901, -874, -847, -821,
+	-794, -768, -741, -715, -688, -661, -635, -608,
+	-582, -555, -529, -502, -475, -449, -422, -396,
+	-369, -343, -316, -289, -263, -236, -210, -183,
+	-157, -130, -103, -77, -50, -24, 3, 30,
+	56, 83, 109, 136, 162, 189, 216, 242,
+	269, 295, 322, 348, 375, 402, 428, 455,
+	481, 508, 534, 561, 588, 614, 641, 667,
+	694, 720, 747, 774, 800, 827, 853, 880,
+	907, 933, 960, 986, 1013, 1039, 1066,
+};
+
+static inline diyfp_t
+diyfp_mul(diyfp_t a, diyfp_t b)
+{
+	const __uint128_t p = (__uint128_t)a.f * b.f;
+	uint64_t h = (uint64_t)(p >> 64U);
+
+	/* round */
+	h += (uint64_t)p >> 63U;
+	return (diyfp_t){h, a.e + b.e + 64};
+}
+
+static inline diyfp_t
+diyfp_norm(diyfp_t x)
+{
+	const int s = __builtin_clzll(x.f);
+	return (diyfp_t){x.f << s, x.e - s};
+}
+
+static diyfp_t
+cached_pow(int e, int *K)
+{
+/* find c = 10^-K such that W * c has its exponent in [-60, -32],
+ * k = ceil((-61 - e) * log10(2)) + 347 with log10(2) ~ 78913 / 2^18 */
+	const int k = ((-61 - e) * 78913 + (348 << 18U) - 1) >> 18U;
+	const unsigned int i = (unsigned int)(k >> 3) + 1U;
+
+	*K = -(-348 + (int)(i << 3U));
+	return (diyfp_t){cpow_f[i], cpow_e[i]};
+}
+
+static void
+grisu_round(char *restrict buf, size_t len, uint64_t delta,
+	    uint64_t rest, uint64_t ten_kappa, uint64_t wp_w)
+{
+	while (rest < wp_w && delta - rest >= ten_kappa &&
+	       (rest + ten_kappa < wp_w ||
+		wp_w - rest > rest + ten_kappa - wp_w)) {
+		buf[len - 1U]--;
+		rest += ten_kappa;
+	}
+	return;
+}
+
+static size_t
+grisu_digits(char *restrict buf, diyfp_t w, diyfp_t mp, uint64_t delta, int *K)
+{
+	const diyfp_t one = {1ULL << -mp.e, mp.e};
+	const uint64_t wp_w = mp.f - w.f;
+	uint32_t p1 = (uint32_t)(mp.f >> -one.e);
+	uint64_t p2 = mp.f & (one.f - 1U);
+	int kappa = ndig_u64(p1);
+	size_t len = 0U;
+
+	while (kappa > 0) {
+		const uint32_t p10 = pow10_32[kappa - 1];
+		const uint32_t d = p1 / p10;
+		uint64_t tmp;
+
+		p1 %= p10;
+		if (d || len) {
+			buf[len++] = (char)('0' + d);
+		}
+		kappa--;
+		tmp = ((uint64_t)p1 << -one.e) + p2;
+		if (tmp <= delta) {
+			*K += kappa;
+			grisu_round(buf, len, delta, tmp,
+				    (uint64_t)pow10_32[kappa] << -one.e, wp_w);
+			return len;
+		}
+	}
+	for (;;) {
+		uint64_t d;
+
+		p2 *= 10U;
+		delta *= 10U;
+		d = p2 >> -one.e;
+		if (d || len) {
+			buf[len++] = (char)('0' + d);
+		}
+		p2 &= one.f - 1U;
+		kappa--;
+		if (p2 < delta) {
+			*K += kappa;
+			grisu_round(buf, len, delta, p2, one.f,
+				    wp_w * pow10_32[-kappa]);
+			return len;
+		}
+	}
+}
+
+static size_t
+grisu2(char *restrict buf, uint64_t f, int e, unsigned int nsig, int *K)
+{
+/* F * 2^E with NSIG explicit significand bits */
+	const uint64_t hid = 1ULL << nsig;
+	const diyfp_t v = {f, e};
+	diyfp_t pl = {(f << 1U) + 1U, e - 1};
+	diyfp_t mi;
+	diyfp_t c, w;
+
+	/* boundaries of v's rounding interval, m+ normalised */
+	while (!(pl.f & (hid << 1U))) {
+		pl.f <<= 1U;
+		pl.e--;
+	}
+	pl.f <<= 64U - nsig - 2U;
+	pl.e -= 64U - nsig - 2U;
+	if (f == hid) {
+		mi = (diyfp_t){(f << 2U) - 1U, e - 2};
+	} else {
+		mi = (diyfp_t){(f << 1U) - 1U, e - 1};
+	}
+	mi.f <<= mi.e - pl.e;
+	mi.e = pl.e;
+
+	c = cached_pow(pl.e, K);
+	w = diyfp_mul(diyfp_norm(v), c);
+	pl = diyfp_mul(pl, c);
+	mi = diyfp_mul(mi, c);
+	/* stay clear of the boundaries */
+	mi.f++;
+	pl.f--;
+	return grisu_digits(buf, w, pl, pl.f - mi.f, K);
+}
+
+static size_t
+pretty(char *restrict buf, size_t len, int k)
+{
+/* BUF holds LEN digits with value digits * 10^K */
+	const int kk = (int)len + k;
+
+	if (k >= 0 && kk <= 21) {
+		/* integral, 1234e7 -> 12340000000 */
+		memset(buf + len, '0', k);
+		return kk;
+	} else if (kk > 0 && kk <= 21) {
+		/* 1234e-2 -> 12.34 */
+		memmove(buf + kk + 1U, buf + kk, len - kk);
+		buf[kk] = '.';
+		return len + 1U;
+	} else if (kk > -6 && kk <= 0) {
+		/* 1234e-6 -> 0.001234 */
+		const size_t off = 2U - kk;
+
+		memmove(buf + off, buf, len);
+		buf[0U] = '0';
+		buf[1U] = '.';
+		memset(buf + 2U, '0', -kk);
+		return len + off;
+	}
+	/* scientific notation, 1234e30 -> 1.234e33 */
+	if (len > 1U) {
+		memmove(buf + 2U, buf + 1U, len - 1U);
+		buf[1U] = '.';
+		len++;
+	}
+	buf[len++] = 'e';
+	with (int x = kk - 1) {
+		if (x < 0) {
+			buf[len++] = '-';
+			x = -x;
+		}
+		len += fmt_u64(buf + len, (unsigned int)x);
+	}
+	return len;
+}
+
+static size_t
+fmt_nonfin(char *restrict buf, uint64_t sig)
+{
+	memcpy(buf, sig ? "nan" : "inf", 3U);
+	return 3U;
+}
+
+
+size_t
+fmt_f64(char *restrict buf, double x)
+{
+	uint64_t u;
+	uint64_t sig;
+	unsigned int bex;
+	size_t n = 0U;
+	int K;
+
+	memcpy(&u, &x, sizeof(u));
+	sig = u & ((1ULL << 52U) - 1U);
+	bex = (unsigned int)(u >> 52U) & 0x7ffU;
+	if (UNLIKELY(bex == 0x7ffU && sig)) {
+		return fmt_nonfin(buf, sig);
+	} else if (u >> 63U) {
+		buf[n++] = '-';
+	}
+	if (UNLIKELY(bex == 0x7ffU)) {
+		return n + fmt_nonfin(buf + n, sig);
+	} else if (UNLIKELY(!bex && !sig)) {
+		buf[n++] = '0';
+		return n;
+	} else if (LIKELY(bex)) {
+		sig |= 1ULL << 52U;
+	} else {
+		/* denormal */
+		bex = 1U;
+	}
+	with (size_t len = grisu2(buf + n, sig, (int)bex - 1075, 52U, &K)) {
+		n += pretty(buf + n, len, K);
+	}
+	return n;
+}
+
+size_t
+fmt_f32(char *restrict buf, float x)
+{
+	uint32_t u;
+	uint32_t sig;
+	unsigned int bex;
+	size_t n = 0U;
+	int K;
+
+	memcpy(&u, &x, sizeof(u));
+	sig = u & ((1U << 23U) - 1U);
+	bex = (unsigned int)(u >> 23U) & 0xffU;
+	if (UNLIKELY(bex == 0xffU && sig)) {
+		return fmt_nonfin(buf, sig);
+	} else if (u >> 31U) {
+		buf[n++] = '-';
+	}
+	if (UNLIKELY(bex == 0xffU)) {
+		return n + fmt_nonfin(buf + n, sig);
+	} else if (UNLIKELY(!bex && !sig)) {
+		buf[n++] = '0';
+		return n;
+	} else if (LIKELY(bex)) {
+		sig |= 1U << 23U;
+	} else {
+		/* denormal */
+		bex = 1U;
+	}
+	with (size_t len = grisu2(buf + n, sig, (int)bex - 150, 23U, &K)) {
+		n += pretty(buf + n, len, K);
+	}
+	return n;
+}
+
+size_t
+fmt_f64_fixed(char *restrict buf, double x, unsigned int prec)
+{
+	static const double p10[] = {
+		1, 10, 100, 1000, 10000, 100000,
+		1000000, 10000000, 100000000, 1000000000,
+	};
+	/* fixed point only while the scaled value fits 63 bits */
+	static const double big = 9000000000000000000ULL;
+	const double ax = x < 0 ? -x : x;
+	uint64_t r;
+	size_t n = 0U;
+
+	if (UNLIKELY(prec >= countof(p10))) {
+		prec = countof(p10) - 1U;
+	}
+	if (UNLIKELY(!(ax < big / p10[prec]))) {
+		/* too big for fixed point, or not a number at all */
+		return fmt_f64(buf, x);
+	}
+	/* round half up */
+	r = (uint64_t)(ax * p10[prec] * 2 + 1) / 2U;
+	if (x < 0 && r) {
+		/* no sign for what rounds to zero */
+		buf[n++] = '-';
+	}
+	n += fmt_u64(buf + n, r / pow10_32[prec]);
+	if (prec) {
+		buf[n++] = '.';
+		n += fmt_u32_pad(buf + n, r % pow10_32[prec], prec);
+	}
+	return n;
+}
+
+size_t
+fmt_u64(char *restrict buf, uint64_t x)
+{
+	const unsigned int n = ndig_u64(x);
+
+	put_u64(buf, x, n);
+	return n;
+}
+
+size_t
+fmt_i64(char *restrict buf, int64_t x)
+{
+	if (x < 0) {
+		*buf = '-';
+		return 1U + fmt_u64(buf + 1U, -(uint64_t)x);
+	}
+	return fmt_u64(buf, x);
+}
+
+size_t
+fmt_u32_pad(char *restrict buf, uint32_t x, size_t width)
+{
+	size_t i = width;
+
+	for (; i >= 2U; i -= 2U, x /= 100U) {
+		memcpy(buf + i - 2U, dig2 + 2U * (x % 100U), 2U);
+	}
+	if (i) {
+		*buf = (char)('0' + x % 10U);
+	}
+	return width;
+}
+
+/* fmt.c ends here */
@@ -0,0 +1,74 @@
+/*** fmt.h -- allocation-free number formatting
+ *
+ * Copyright (C) 2013-2015 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of blpcli.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if !defined INCLUDED_fmt_h_
+#define INCLUDED_fmt_h_
+#include <stddef.h>
+#include <stdint.h>
+
+/* buffer sizes sufficient for any output of the routines below */
+#define FMT_INT_MAXLEN	(21U)
+#define FMT_FLT_MAXLEN	(32U)
+
+/**
+ * Write the shortest decimal representation of X to BUF that reads
+ * back as X.  Return the number of bytes written, no \0 is appended. */
+extern size_t fmt_f64(char *restrict buf, double x);
+
+/**
+ * Like fmt_f64() but for single precision X. */
+extern size_t fmt_f32(char *restrict buf, float x);
+
+/**
+ * Write X with PREC decimal places (at most 9) to BUF.
+ * Values too large for fixed point are written as in fmt_f64().
+ * Return the number of bytes written, no \0 is appended. */
+extern size_t fmt_f64_fixed(char *restrict buf, double x, unsigned int prec);
+
+/**
+ * Write the decimal representation of X to BUF.
+ * Return the number of bytes written, no \0 is appended. */
+extern size_t fmt_u64(char *restrict buf, uint64_t x);
+
+/**
+ * Like fmt_u64() but for signed X. */
+extern size_t fmt_i64(char *restrict buf, int64_t x);
+
+/**
+ * Write X as WIDTH digits, zero-padded, to BUF.  Return WIDTH. */
+extern size_t fmt_u32_pad(char *restrict buf, uint32_t x, size_t width);
+
+#endif	/* INCLUDED_fmt_h_ */
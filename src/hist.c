@@ -0,0 +1,119 @@
+/*** hist.c -- log-linear latency histograms
+ *
+ * Copyright (C) 2009-2015 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of blpcli.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <string.h>
+#include "hist.h"
+#include "fmt.h"
+#include "nifty.h"
+
+
+uint64_t
+hist_val(size_t i)
+{
+	size_t k;
+	unsigned int shf;
+
+	if (i < (1U << HIST_SUB)) {
+		return i;
+	}
+	k = i >> HIST_SUB;
+	shf = k - 1U;
+	i &= (1U << HIST_SUB) - 1U;
+	return ((((1ULL << HIST_SUB) + i) << shf) + (1ULL << shf)) - 1U;
+}
+
+uint64_t
+hist_qtl(const struct hist_s *h, uint64_t num, uint64_t den)
+{
+	/* rank of the value in question, rounded up */
+	const uint64_t rnk = (h->n * num + den - 1U) / den;
+	uint64_t sum = 0U;
+
+	if (UNLIKELY(!h->n)) {
+		return 0U;
+	}
+	for (size_t i = 0U; i < HIST_NBKT; i++) {
+		if ((sum += h->cnt[i]) >= rnk) {
+			const uint64_t v = hist_val(i);
+			/* the bucket's upper edge might exceed what we've seen */
+			return v < h->max ? v : h->max;
+		}
+	}
+	return h->max;
+}
+
+size_t
+hist_prnt(char *restrict buf, size_t bsz,
+	  const char *name, const struct hist_s *h)
+{
+	static const struct {
+		const char *lbl;
+		uint64_t num;
+		uint64_t den;
+	} qs[] = {
+		{" p50=", 1U, 2U},
+		{"ns p99=", 99U, 100U},
+		{"ns p99.9=", 999U, 1000U},
+	};
+	const size_t nz = strlen(name);
+	size_t n = 0U;
+
+	if (UNLIKELY(bsz < nz + 4U * (FMT_INT_MAXLEN + 12U) + 4U)) {
+		return 0U;
+	}
+	memcpy(buf, name, nz);
+	n += nz;
+	memcpy(buf + n, ": n=", 4U);
+	n += 4U;
+	n += fmt_u64(buf + n, h->n);
+	for (size_t i = 0U; i < countof(qs); i++) {
+		const size_t lz = strlen(qs[i].lbl);
+
+		memcpy(buf + n, qs[i].lbl, lz);
+		n += lz;
+		n += fmt_u64(buf + n, hist_qtl(h, qs[i].num, qs[i].den));
+	}
+	memcpy(buf + n, "ns max=", 7U);
+	n += 7U;
+	n += fmt_u64(buf + n, h->max);
+	memcpy(buf + n, "ns\n", 4U);
+	return n + 3U;
+}
+
+/* hist.c ends here */
@@ -0,0 +1,100 @@
+/*** hist.h -- log-linear latency histograms
+ *
+ * Copyright (C) 2009-2015 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of blpcli.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if !defined INCLUDED_hist_h_
+#define INCLUDED_hist_h_
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Histograms in the vein of HdrHistogram, values below 2^HIST_SUB are
+ * counted exactly, larger ones in 2^HIST_SUB buckets per power of two,
+ * i.e. with a relative error of at most 2^-HIST_SUB.  Values beyond
+ * 2^HIST_MAG end up in the last bucket.
+ * Recording is an index computation and an increment, no locking is
+ * done, readers may see slightly inconsistent counts. */
+#define HIST_SUB	(5U)
+#define HIST_MAG	(40U)
+#define HIST_NBKT	((HIST_MAG - HIST_SUB + 1U) << HIST_SUB)
+
+struct hist_s {
+	uint64_t n;
+	uint64_t max;
+	uint64_t cnt[HIST_NBKT];
+};
+
+
+/**
+ * Return the largest value that would be counted in bucket I. */
+extern uint64_t hist_val(size_t i);
+
+/**
+ * Return the value below which NUM/DEN of the values recorded in H lie. */
+extern uint64_t hist_qtl(const struct hist_s *h, uint64_t num, uint64_t den);
+
+/**
+ * Print a one-line summary of H (count, p50, p99, p99.9, max) to BUF,
+ * prefixed with NAME.  Return the number of bytes written. */
+extern size_t hist_prnt(char *restrict buf, size_t bsz,
+			const char *name, const struct hist_s *h);
+
+
+static inline size_t
+hist_idx(uint64_t v)
+{
+	unsigned int m;
+
+	if (v < (1ULL << HIST_SUB)) {
+		return v;
+	} else if ((m = 63U - __builtin_clzll(v)) >= HIST_MAG) {
+		return HIST_NBKT - 1U;
+	}
+	return ((m - HIST_SUB + 1U) << HIST_SUB) +
+		((v >> (m - HIST_SUB)) & ((1ULL << HIST_SUB) - 1U));
+}
+
+static inline void
+hist_rec(struct hist_s *h, uint64_t v)
+{
+	h->cnt[hist_idx(v)]++;
+	h->n++;
+	if (v > h->max) {
+		h->max = v;
+	}
+	return;
+}
+
+#endif	/* INCLUDED_hist_h_ */
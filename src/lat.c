@@ -0,0 +1,116 @@
+/*** lat.c -- latency accounting of blpapi events and messages
+ *
+ * Copyright (C) 2009-2015 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of blpcli.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <unistd.h>
+#include <stdint.h>
+#include <blpapi_datetime.h>
+#include <blpapi_message.h>
+#include <blpapi_timepoint.h>
+#include "lat.h"
+#include "nifty.h"
+
+/* how often to re-anchor library time points to the realtime clock */
+#define LAT_REANCHOR	(1000000000ULL)
+
+
+static int64_t
+hpdt_ns(const blpapi_HighPrecisionDatetime_t *hp)
+{
+/* nanoseconds since the epoch of HP, which is assumed to be in UTC */
+	const blpapi_Datetime_t *dt = &hp->datetime;
+	int y = dt->year - (dt->month <= 2U);
+	const int era = (y >= 0 ? y : y - 399) / 400;
+	const unsigned int yoe = y - era * 400;
+	const unsigned int mp = (dt->month + 9U) % 12U;
+	const unsigned int doy = (153U * mp + 2U) / 5U + dt->day - 1U;
+	const unsigned int doe = yoe * 365U + yoe / 4U - yoe / 100U + doy;
+	const int64_t d = era * 146097LL + doe - 719468LL;
+	const int64_t s = d * 86400LL +
+		dt->hours * 3600LL + dt->minutes * 60LL + dt->seconds;
+
+	return s * 1000000000LL +
+		dt->milliSeconds * 1000000LL + hp->picoseconds / 1000U;
+}
+
+static int
+lat_anchor(struct lat_s *l, const blpapi_TimePoint_t *tp)
+{
+	blpapi_HighPrecisionDatetime_t hp;
+
+	if (UNLIKELY(blpapi_HighPrecisionDatetime_fromTimePoint(&hp, tp, 0))) {
+		return -1;
+	}
+	l->ref = *tp;
+	l->refns = hpdt_ns(&hp);
+	return 0;
+}
+
+
+void
+lat_msg(struct lat_s *l, const blpapi_Message_t *msg, uint64_t ns)
+{
+	blpapi_TimePoint_t tp;
+	uint64_t rcv;
+
+	if (blpapi_Message_timeReceived(msg, &tp)) {
+		/* not recorded */
+		return;
+	} else if (UNLIKELY(ns - l->refns >= LAT_REANCHOR) &&
+		   lat_anchor(l, &tp) < 0) {
+		return;
+	}
+	rcv = l->refns + blpapi_TimePointUtil_nanosecondsBetween(&l->ref, &tp);
+	hist_rec(&l->rcv, ns > rcv ? ns - rcv : 0U);
+	return;
+}
+
+void
+lat_prnt(const struct lat_s *l)
+{
+	char buf[256U];
+	size_t n;
+
+	n = hist_prnt(buf, sizeof(buf), "latency event->write", &l->evw);
+	write(STDERR_FILENO, buf, n);
+	n = hist_prnt(buf, sizeof(buf), "latency recv->event", &l->rcv);
+	write(STDERR_FILENO, buf, n);
+	return;
+}
+
+/* lat.c ends here */
@@ -0,0 +1,78 @@
+/*** lat.h -- latency accounting of blpapi events and messages
+ *
+ * Copyright (C) 2009-2015 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of blpcli.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if !defined INCLUDED_lat_h_
+#define INCLUDED_lat_h_
+#include <stdint.h>
+#include <blpapi_message.h>
+#include <blpapi_timepoint.h>
+#include "hist.h"
+
+/**
+ * Two histograms, one for the time between callback entry and the
+ * completion of the corresponding write (EVW), and one for the time
+ * between the library receiving a message and us seeing it (RCV).
+ * The latter needs receive times to be recorded, see
+ * blpapi_SessionOptions_setRecordSubscriptionDataReceiveTimes(). */
+struct lat_s {
+	struct hist_s evw;
+	struct hist_s rcv;
+
+	/* a library time point and its realtime equivalent */
+	blpapi_TimePoint_t ref;
+	uint64_t refns;
+};
+
+
+/**
+ * Record the receive latency of MSG, seen by us at NS. */
+extern void lat_msg(struct lat_s *l, const blpapi_Message_t *msg, uint64_t ns);
+
+/**
+ * Write a summary of L's histograms to stderr. */
+extern void lat_prnt(const struct lat_s *l);
+
+
+/**
+ * Record callback entry at T0 and write completion at T1. */
+static inline void
+lat_evw(struct lat_s *l, uint64_t t0, uint64_t t1)
+{
+	hist_rec(&l->evw, t1 > t0 ? t1 - t0 : 0U);
+	return;
+}
+
+#endif	/* INCLUDED_lat_h_ */
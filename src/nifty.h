@@ -36,6 +36,7 @@
  ***/
 #if !defined INCLUDED_nifty_h_
 #define INCLUDED_nifty_h_
+#include <stdint.h>
 
 #if !defined LIKELY
 # define LIKELY(_x)	__builtin_expect((_x), 1)
@@ -82,6 +83,19 @@
 	static int paste(__, __LINE__);		\
 	if (paste(__, __LINE__)++)
 
+static __inline uint64_t
+strhash(const char *s)
+{
+/* FNV-1a over the string S */
+	uint64_t h = 14695981039346656037ULL;
+
+	for (; *s; s++) {
+		h ^= (unsigned char)*s;
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
 static __inline void*
 deconst(const void *cp)
 {
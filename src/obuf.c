@@ -0,0 +1,294 @@
+/*** obuf.c -- chunked, record-preserving output buffers
+ *
+ * Copyright (C) 2013-2015 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of blpcli.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <sys/uio.h>
+#include "obuf.h"
+#include "nifty.h"
+
+#if !defined IOV_MAX
+# define IOV_MAX	(16U)
+#endif	/* !IOV_MAX */
+
+
+static uint64_t
+now_coarse(void)
+{
+	struct timespec tsp;
+
+#if defined CLOCK_MONOTONIC_COARSE
+	clock_gettime(CLOCK_MONOTONIC_COARSE, &tsp);
+#else  /* !CLOCK_MONOTONIC_COARSE */
+	clock_gettime(CLOCK_MONOTONIC, &tsp);
+#endif	/* CLOCK_MONOTONIC_COARSE */
+	return tsp.tv_sec * 1000000000ULL + tsp.tv_nsec;
+}
+
+static ssize_t
+xwritev(int fd, struct iovec *iov, int niov, struct obuf_stat_s *st)
+{
+	ssize_t tot = 0;
+
+	while (niov > 0) {
+		ssize_t nwr;
+
+		st->nsys++;
+		if (UNLIKELY((nwr = writev(fd, iov, niov)) < 0)) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return -1;
+		}
+		tot += nwr;
+		/* skip over fully written vectors */
+		for (; niov > 0 && (size_t)nwr >= iov->iov_len; iov++, niov--) {
+			nwr -= iov->iov_len;
+		}
+		if (niov > 0) {
+			iov->iov_base = (char*)iov->iov_base + nwr;
+			iov->iov_len -= nwr;
+		}
+	}
+	return tot;
+}
+
+static void
+obuf_wropen(obuf_t ob)
+{
+/* write out the open record, it's too big for a chunk */
+	struct iovec iov;
+
+	/* committed records go first, this moves the open one to the front */
+	obuf_flush(ob);
+	iov.iov_base = ob->base;
+	iov.iov_len = ob->len;
+	if (UNLIKELY(xwritev(ob->fd, &iov, 1, &ob->st) < 0) && !ob->err) {
+		ob->err = errno;
+	}
+	/* obuf_rec() won't see these bytes */
+	ob->st.nbyt += ob->len;
+	ob->len = 0U;
+	return;
+}
+
+
+obuf_t
+make_obuf(int fd, size_t chnz, size_t nchn)
+{
+	obuf_t ob;
+
+	if (UNLIKELY(!chnz || !nchn)) {
+		return NULL;
+	} else if (UNLIKELY(nchn > IOV_MAX)) {
+		nchn = IOV_MAX;
+	}
+	if (UNLIKELY((ob = calloc(1, sizeof(*ob))) == NULL)) {
+		return NULL;
+	} else if (UNLIKELY((ob->base = malloc(chnz * nchn)) == NULL)) {
+		goto nul;
+	} else if (UNLIKELY((ob->fill = calloc(nchn, sizeof(*ob->fill))) == NULL)) {
+		goto nul;
+	}
+	ob->chnz = chnz;
+	ob->nchn = nchn;
+	ob->fd = fd;
+	/* flush whenever a chunk's worth is pending */
+	ob->hiwat = chnz;
+	return ob;
+
+nul:
+	free_obuf(ob);
+	return NULL;
+}
+
+void
+free_obuf(obuf_t ob)
+{
+	if (ob->base != NULL) {
+		free(ob->base);
+	}
+	if (ob->fill != NULL) {
+		free(ob->fill);
+	}
+	free(ob);
+	return;
+}
+
+void
+obuf_set_thresh(obuf_t ob, size_t hiwat, uint64_t maxlat)
+{
+	ob->hiwat = hiwat;
+	if ((ob->maxlat = maxlat)) {
+		ob->last = now_coarse();
+	}
+	return;
+}
+
+ssize_t
+obuf_flush(obuf_t ob)
+{
+	struct iovec iov[ob->cur + 1U];
+	int niov = 0;
+	ssize_t nwr = 0;
+
+	/* committed chunks first */
+	for (size_t i = 0U; i < ob->cur; i++) {
+		if (ob->fill[i]) {
+			iov[niov].iov_base = ob->base + i * ob->chnz;
+			iov[niov].iov_len = ob->fill[i];
+			niov++;
+		}
+	}
+	/* committed part of the current chunk */
+	if (ob->beg) {
+		iov[niov].iov_base = ob->base + ob->cur * ob->chnz;
+		iov[niov].iov_len = ob->beg;
+		niov++;
+	}
+	if (niov) {
+		ob->st.nflu++;
+		nwr = xwritev(ob->fd, iov, niov, &ob->st);
+		if (UNLIKELY(nwr < 0) && !ob->err) {
+			ob->err = errno;
+		}
+	}
+
+	/* move the open record to the front */
+	if (ob->cur || ob->beg) {
+		memmove(ob->base, ob->base + ob->cur * ob->chnz + ob->beg,
+			ob->len - ob->beg);
+	}
+	ob->len -= ob->beg;
+	ob->beg = 0U;
+	ob->cur = 0U;
+	ob->fill[0U] = 0U;
+	ob->pend = 0U;
+	if (ob->maxlat) {
+		ob->last = now_coarse();
+	}
+	return nwr;
+}
+
+char*
+obuf_prep(obuf_t ob, size_t n)
+{
+	if (LIKELY(ob->len + n <= ob->chnz)) {
+		goto out;
+	}
+	/* open record doesn't fit, move it to the next chunk */
+	if (UNLIKELY(!ob->beg)) {
+		/* record fills the chunk all by itself, no way to keep it whole */
+		obuf_wropen(ob);
+		goto out;
+	} else if (ob->cur + 1U >= ob->nchn) {
+		obuf_flush(ob);
+	} else {
+		char *cp = ob->base + ob->cur * ob->chnz;
+
+		ob->cur++;
+		memcpy(cp + ob->chnz, cp + ob->beg, ob->len - ob->beg);
+		ob->fill[ob->cur] = 0U;
+		ob->len -= ob->beg;
+		ob->beg = 0U;
+	}
+	if (UNLIKELY(ob->len + n > ob->chnz)) {
+		/* record is bigger than a chunk, no way to keep it whole */
+		obuf_wropen(ob);
+	}
+out:
+	return ob->base + ob->cur * ob->chnz + ob->len;
+}
+
+void
+obuf_rec(obuf_t ob)
+{
+	ob->st.nrec++;
+	ob->st.nbyt += ob->len - ob->beg;
+	ob->pend += ob->len - ob->beg;
+	ob->fill[ob->cur] = ob->beg = ob->len;
+
+	if (UNLIKELY(ob->pend >= ob->hiwat)) {
+		obuf_flush(ob);
+	} else if (ob->maxlat && now_coarse() - ob->last >= ob->maxlat) {
+		obuf_flush(ob);
+	}
+	return;
+}
+
+void
+obuf_write(obuf_t ob, const char *s, size_t n)
+{
+	/* anything longer than a chunk goes in chunk-sized portions */
+	for (size_t k; n > 0U; s += k, n -= k) {
+		k = n < ob->chnz ? n : ob->chnz;
+		memcpy(obuf_prep(ob, k), s, k);
+		obuf_adv(ob, k);
+	}
+	return;
+}
+
+size_t
+obuf_printf(obuf_t ob, const char *fmt, ...)
+{
+	/* we don't do overlong number representations */
+	const size_t bsz = ob->chnz < 256U ? ob->chnz : 256U;
+	char *p = obuf_prep(ob, bsz);
+	va_list vap;
+	int z;
+
+	va_start(vap, fmt);
+	z = vsnprintf(p, bsz, fmt, vap);
+	va_end(vap);
+	if (UNLIKELY(z < 0)) {
+		return 0U;
+	} else if (UNLIKELY((size_t)z >= bsz)) {
+		/* clamp */
+		z = bsz - 1U;
+	}
+	obuf_adv(ob, z);
+	return z;
+}
+
+/* obuf.c ends here */
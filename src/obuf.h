@@ -0,0 +1,166 @@
+/*** obuf.h -- chunked, record-preserving output buffers
+ *
+ * Copyright (C) 2013-2015 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of blpcli.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if !defined INCLUDED_obuf_h_
+#define INCLUDED_obuf_h_
+#include <stdint.h>
+#include <sys/types.h>
+#include <string.h>
+#include <stdarg.h>
+
+/**
+ * An output buffer is a fixed set of equally sized chunks.
+ * Records (lines) are appended piecemeal and committed with obuf_rec(),
+ * a committed record is never split across chunks and never across
+ * write(2) calls, unless it is larger than a chunk altogether.
+ * Flushing writes all committed records with a single writev(2). */
+typedef struct obuf_s *obuf_t;
+
+struct obuf_stat_s {
+	/* committed records and bytes */
+	size_t nrec;
+	size_t nbyt;
+	/* number of write(2)/writev(2) calls and flushes */
+	size_t nsys;
+	size_t nflu;
+};
+
+struct obuf_s {
+	/* chunk storage, NCHN chunks of CHNZ bytes each */
+	char *base;
+	size_t chnz;
+	size_t nchn;
+	/* current chunk and the committed fill level of all chunks */
+	size_t cur;
+	size_t *fill;
+	/* start of the open record and write offset in chunk CUR */
+	size_t beg;
+	size_t len;
+	/* flush thresholds, pending bytes and nanoseconds since last flush */
+	size_t hiwat;
+	uint64_t maxlat;
+	uint64_t last;
+	size_t pend;
+	int fd;
+	/* errno of the first failed write, 0 if all went well */
+	int err;
+
+	struct obuf_stat_s st;
+};
+
+
+/**
+ * Return an output buffer for FD with NCHN chunks of CHNZ bytes. */
+extern obuf_t make_obuf(int fd, size_t chnz, size_t nchn);
+
+/**
+ * Free resources associated with output buffer OB, no flushing is done. */
+extern void free_obuf(obuf_t ob);
+
+/**
+ * Set flush thresholds of OB, flush when HIWAT bytes are pending
+ * or when MAXLAT nanoseconds have passed since the last flush. */
+extern void obuf_set_thresh(obuf_t ob, size_t hiwat, uint64_t maxlat);
+
+/**
+ * Write all committed records in OB to its descriptor.
+ * Return the number of bytes written or -1 on error.
+ * Errors of this and of implicit flushes are kept in OB->err. */
+extern ssize_t obuf_flush(obuf_t ob);
+
+/**
+ * Make sure at least N bytes can be appended to the open record.
+ * Return a pointer to the write position. */
+extern char *obuf_prep(obuf_t ob, size_t n);
+
+/**
+ * Commit the open record and flush when thresholds are exceeded. */
+extern void obuf_rec(obuf_t ob);
+
+/**
+ * Drop the open record. */
+static inline void
+obuf_undo(obuf_t ob)
+{
+	ob->len = ob->beg;
+	return;
+}
+
+/**
+ * Return a pointer to the beginning of the open record, for patching
+ * headers in place.  Only valid for records that fit into a chunk,
+ * and only until the next call to obuf_prep(). */
+static inline char*
+obuf_head(obuf_t ob)
+{
+	return ob->base + ob->cur * ob->chnz + ob->beg;
+}
+
+/**
+ * Append the N bytes S to the open record. */
+extern void obuf_write(obuf_t ob, const char *s, size_t n);
+
+/**
+ * Append formatted output to the open record. */
+extern __attribute__((format(printf, 2, 3))) size_t
+obuf_printf(obuf_t ob, const char *fmt, ...);
+
+
+static inline void
+obuf_adv(obuf_t ob, size_t n)
+{
+	ob->len += n;
+	return;
+}
+
+
+static inline void
+obuf_puts(obuf_t ob, const char *s)
+{
+	obuf_write(ob, s, strlen(s));
+	return;
+}
+
+static inline void
+obuf_putc(obuf_t ob, char c)
+{
+	char *restrict p = obuf_prep(ob, 1U);
+	*p = c;
+	obuf_adv(ob, 1U);
+	return;
+}
+
+#endif	/* INCLUDED_obuf_h_ */
@@ -0,0 +1,495 @@
+/*** rcache.c -- reference data caches
+ *
+ * Copyright (C) 2013-2015 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of blpcli.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "rcache.h"
+#include "nifty.h"
+
+#define RC_MAGIC	"BLPC"
+#define RC_VERSION	(1U)
+
+/* a fresh cache has room for this many entries and heap bytes */
+#define RC_NSLOT	(4096U)
+#define RC_HEAPZ	(256U * 1024U)
+
+struct rc_hdr_s {
+	char magic[4U];
+	uint16_t ver;
+	uint16_t rsv;
+	uint32_t nslot;
+	uint32_t nused;
+	uint64_t heapz;
+	/* heap bytes handed out, values replaced leave garbage behind
+	 * which is dropped when the heap runs full */
+	uint64_t heapn;
+	uint8_t pad[32U];
+};
+
+struct rc_slot_s {
+	/* 0 if the slot is empty */
+	uint64_t hash;
+	uint64_t fetched;
+	/* the key is SEC\0FLD\0OVR in the heap */
+	uint32_t key;
+	uint16_t keyz;
+	uint8_t vt;
+	uint8_t rsv;
+	union {
+		int64_t i64;
+		double f64;
+		float f32;
+		struct bin_dt_s dt;
+		struct {
+			uint32_t off;
+			uint32_t len;
+		} str;
+	} v;
+};
+
+struct rcache_s {
+	int fd;
+	void *map;
+	size_t mapz;
+	struct rc_hdr_s *hdr;
+	struct rc_slot_s *slot;
+	char *heap;
+};
+
+
+static uint64_t
+rc_hash(const char *sec, const char *fld, const char *ovr, size_t *zp)
+{
+/* FNV-1a over SEC\0FLD\0OVR, put its length into ZP, 0 is not a hash */
+	const char *const k[] = {sec, fld, ovr};
+	uint64_t h = 14695981039346656037ULL;
+	size_t z = 0U;
+
+	for (size_t i = 0U; i < countof(k); i++) {
+		for (const char *s = k[i]; *s; s++, z++) {
+			h ^= (unsigned char)*s;
+			h *= 1099511628211ULL;
+		}
+		if (i + 1U < countof(k)) {
+			/* the separator */
+			h *= 1099511628211ULL;
+			z++;
+		}
+	}
+	*zp = z;
+	return h ? h : 1U;
+}
+
+static bool
+rc_keyp(const struct rcache_s *rc, const struct rc_slot_s *s,
+	const char *sec, const char *fld, const char *ovr)
+{
+/* whether slot S is keyed SEC\0FLD\0OVR */
+	const char *k = rc->heap + s->key;
+	const char *const ke = k + s->keyz;
+	const char *const p[] = {sec, fld, ovr};
+
+	for (size_t i = 0U; i < countof(p); i++) {
+		const size_t z = strlen(p[i]);
+
+		if ((size_t)(ke - k) < z || memcmp(k, p[i], z)) {
+			return false;
+		}
+		k += z;
+		if (i + 1U < countof(p) && (k >= ke || *k++)) {
+			return false;
+		}
+	}
+	return k == ke;
+}
+
+static struct rc_slot_s*
+rc_find(const struct rcache_s *rc, uint64_t h,
+	const char *sec, const char *fld, const char *ovr)
+{
+/* return the slot keyed SEC\0FLD\0OVR or the empty slot it'd go to */
+	const size_t mask = rc->hdr->nslot - 1U;
+
+	for (size_t i = h;; i++) {
+		struct rc_slot_s *s = rc->slot + (i & mask);
+
+		if (!s->hash) {
+			return s;
+		} else if (s->hash == h && rc_keyp(rc, s, sec, fld, ovr)) {
+			return s;
+		}
+	}
+}
+
+static size_t
+rc_size(size_t nslot, size_t heapz)
+{
+	return sizeof(struct rc_hdr_s) +
+		nslot * sizeof(struct rc_slot_s) + heapz;
+}
+
+static int
+rc_map(struct rcache_s *rc, size_t nslot, size_t heapz)
+{
+/* resize the file to hold NSLOT slots and HEAPZ heap bytes, map it */
+	const size_t z = rc_size(nslot, heapz);
+	void *p;
+
+	if (UNLIKELY(ftruncate(rc->fd, z) < 0)) {
+		return -1;
+	}
+	p = mmap(NULL, z, PROT_READ | PROT_WRITE, MAP_SHARED, rc->fd, 0);
+	if (UNLIKELY(p == MAP_FAILED)) {
+		return -1;
+	}
+	rc->map = p;
+	rc->mapz = z;
+	rc->hdr = p;
+	rc->slot = (void*)(rc->hdr + 1U);
+	rc->heap = (char*)(rc->slot + nslot);
+	return 0;
+}
+
+static int
+rc_init(struct rcache_s *rc, size_t nslot, size_t heapz)
+{
+/* start over with an empty cache */
+	if (UNLIKELY(ftruncate(rc->fd, 0) < 0 ||
+		     rc_map(rc, nslot, heapz) < 0)) {
+		return -1;
+	}
+	memcpy(rc->hdr->magic, RC_MAGIC, sizeof(rc->hdr->magic));
+	rc->hdr->ver = RC_VERSION;
+	rc->hdr->nslot = nslot;
+	rc->hdr->heapz = heapz;
+	return 0;
+}
+
+static bool
+rc_okp(const struct rcache_s *rc)
+{
+/* whether the mapping looks like one of our caches */
+	const struct rc_hdr_s *h = rc->hdr;
+
+	if (rc->mapz < sizeof(*h) ||
+	    memcmp(h->magic, RC_MAGIC, sizeof(h->magic)) ||
+	    h->ver != RC_VERSION) {
+		return false;
+	} else if (!h->nslot || (h->nslot & (h->nslot - 1U))) {
+		return false;
+	} else if (rc->mapz != rc_size(h->nslot, h->heapz) ||
+		   h->heapn > h->heapz || h->nused >= h->nslot) {
+		return false;
+	}
+	return true;
+}
+
+static size_t
+rc_live(const struct rcache_s *rc)
+{
+/* heap bytes live slots refer to */
+	size_t n = 0U;
+
+	for (size_t i = 0U; i < rc->hdr->nslot; i++) {
+		const struct rc_slot_s *s = rc->slot + i;
+
+		if (s->hash) {
+			n += s->keyz;
+			n += s->vt == BIN_VT_STR ? s->v.str.len : 0U;
+		}
+	}
+	return n;
+}
+
+static int
+rc_grow(struct rcache_s *rc, size_t nslot, size_t heapz)
+{
+/* rehash into NSLOT slots and a heap of HEAPZ bytes, keeping only what
+ * live slots refer to, HEAPZ must hold at least that much */
+	const struct rc_hdr_s *oh;
+	const struct rc_slot_s *os;
+	const char *ohp;
+	size_t n;
+	void *old;
+
+	if (UNLIKELY((old = malloc(rc->mapz)) == NULL)) {
+		return -1;
+	}
+	memcpy(old, rc->map, rc->mapz);
+	oh = old;
+	os = (const void*)(oh + 1U);
+	ohp = (const char*)(os + oh->nslot);
+	n = oh->nslot;
+
+	munmap(rc->map, rc->mapz);
+	if (UNLIKELY(rc_init(rc, nslot, heapz) < 0)) {
+		/* there's nothing mapped now */
+		rc->map = NULL;
+		free(old);
+		return -1;
+	}
+	for (size_t i = 0U; i < n; i++) {
+		const struct rc_slot_s *s = os + i;
+		struct rc_slot_s *t;
+		size_t z;
+
+		if (!s->hash) {
+			continue;
+		}
+		for (size_t j = s->hash;; j++) {
+			t = rc->slot + (j & (nslot - 1U));
+			if (!t->hash) {
+				break;
+			}
+		}
+		*t = *s;
+		z = s->keyz + (s->vt == BIN_VT_STR ? s->v.str.len : 0U);
+		if (UNLIKELY(rc->hdr->heapn + z > heapz)) {
+			/* can't be, see rc_live() */
+			t->hash = 0U;
+			continue;
+		}
+		t->key = rc->hdr->heapn;
+		memcpy(rc->heap + t->key, ohp + s->key, s->keyz);
+		rc->hdr->heapn += s->keyz;
+		if (s->vt == BIN_VT_STR) {
+			t->v.str.off = rc->hdr->heapn;
+			memcpy(rc->heap + t->v.str.off,
+			       ohp + s->v.str.off, s->v.str.len);
+			rc->hdr->heapn += s->v.str.len;
+		}
+		rc->hdr->nused++;
+	}
+	free(old);
+	return 0;
+}
+
+
+rcache_t
+make_rcache(const char *fn)
+{
+	struct rcache_s *rc;
+	struct stat st;
+
+	if (UNLIKELY((rc = calloc(1U, sizeof(*rc))) == NULL)) {
+		return NULL;
+	} else if ((rc->fd = open(fn, O_RDWR | O_CREAT | O_CLOEXEC, 0666)) < 0) {
+		goto nul;
+	} else if (flock(rc->fd, LOCK_EX | LOCK_NB) < 0) {
+		/* someone else's, don't wait for them */
+		goto clo;
+	} else if (fstat(rc->fd, &st) < 0) {
+		goto clo;
+	} else if (!st.st_size) {
+		goto ini;
+	}
+	rc->mapz = st.st_size;
+	rc->map = mmap(NULL, rc->mapz, PROT_READ | PROT_WRITE,
+		       MAP_SHARED, rc->fd, 0);
+	if (UNLIKELY(rc->map == MAP_FAILED)) {
+		goto clo;
+	}
+	rc->hdr = rc->map;
+	if (LIKELY(rc_okp(rc))) {
+		rc->slot = (void*)(rc->hdr + 1U);
+		rc->heap = (char*)(rc->slot + rc->hdr->nslot);
+		return rc;
+	}
+	/* not ours or truncated, a cache can always start over */
+	munmap(rc->map, rc->mapz);
+ini:
+	if (UNLIKELY(rc_init(rc, RC_NSLOT, RC_HEAPZ) < 0)) {
+		goto clo;
+	}
+	return rc;
+
+clo:
+	with (int e = errno) {
+		close(rc->fd);
+		errno = e;
+	}
+nul:
+	free(rc);
+	return NULL;
+}
+
+void
+free_rcache(rcache_t rc)
+{
+	if (rc->map != NULL) {
+		munmap(rc->map, rc->mapz);
+	}
+	/* releases the lock too */
+	close(rc->fd);
+	free(rc);
+	return;
+}
+
+int
+rcache_get(rcache_t rc, const char *sec, const char *fld, const char *ovr,
+	   struct rcache_val_s *v)
+{
+	const struct rc_slot_s *s;
+	uint64_t h;
+	size_t z;
+
+	if (UNLIKELY(rc->map == NULL)) {
+		return -1;
+	}
+	ovr = ovr ? ovr : "";
+	h = rc_hash(sec, fld, ovr, &z);
+	if (!(s = rc_find(rc, h, sec, fld, ovr))->hash) {
+		return -1;
+	}
+	v->fetched = s->fetched;
+	switch ((v->vt = s->vt)) {
+	case BIN_VT_I64:
+		v->v.i64 = s->v.i64;
+		break;
+	case BIN_VT_F64:
+		v->v.f64 = s->v.f64;
+		break;
+	case BIN_VT_F32:
+		v->v.f32 = s->v.f32;
+		break;
+	case BIN_VT_DT:
+		v->v.dt = s->v.dt;
+		break;
+	case BIN_VT_STR:
+		v->v.str.s = rc->heap + s->v.str.off;
+		v->v.str.len = s->v.str.len;
+		break;
+	default:
+		v->vt = BIN_VT_UNK;
+		break;
+	}
+	return 0;
+}
+
+int
+rcache_put(rcache_t rc, const char *sec, const char *fld, const char *ovr,
+	   const struct rcache_val_s *v)
+{
+	const size_t sz = v->vt == BIN_VT_STR ? v->v.str.len : 0U;
+	struct rc_slot_s *s;
+	size_t nslot, heapz;
+	uint64_t h;
+	size_t z;
+
+	if (UNLIKELY(rc->map == NULL)) {
+		return -1;
+	}
+	ovr = ovr ? ovr : "";
+	h = rc_hash(sec, fld, ovr, &z);
+	if (UNLIKELY(z > UINT16_MAX || sz > UINT32_MAX)) {
+		return -1;
+	}
+	/* keep the load below three quarters */
+	for (nslot = rc->hdr->nslot;
+	     4U * (rc->hdr->nused + 1U) > 3U * nslot; nslot <<= 1U);
+	heapz = rc->hdr->heapz;
+	if (rc->hdr->heapn + z + sz > heapz) {
+		/* compaction drops replaced values, grow only if the live
+		 * bytes (and key and value) would fill more than half */
+		const size_t live = rc_live(rc) + z + sz;
+
+		for (; 2U * live > heapz; heapz <<= 1U);
+		if (UNLIKELY(heapz > UINT32_MAX)) {
+			return -1;
+		} else if (UNLIKELY(rc_grow(rc, nslot, heapz) < 0)) {
+			return -1;
+		}
+	} else if (nslot > rc->hdr->nslot &&
+		   UNLIKELY(rc_grow(rc, nslot, heapz) < 0)) {
+		return -1;
+	}
+
+	if (!(s = rc_find(rc, h, sec, fld, ovr))->hash) {
+		char *k = rc->heap + rc->hdr->heapn;
+
+		k = stpcpy(k, sec) + 1U;
+		k = stpcpy(k, fld) + 1U;
+		memcpy(k, ovr, strlen(ovr));
+		s->key = rc->hdr->heapn;
+		s->keyz = z;
+		s->hash = h;
+		rc->hdr->heapn += z;
+		rc->hdr->nused++;
+	}
+	s->fetched = v->fetched;
+	switch ((s->vt = v->vt)) {
+	case BIN_VT_I64:
+		s->v.i64 = v->v.i64;
+		break;
+	case BIN_VT_F64:
+		s->v.f64 = v->v.f64;
+		break;
+	case BIN_VT_F32:
+		s->v.f32 = v->v.f32;
+		break;
+	case BIN_VT_DT:
+		s->v.dt = v->v.dt;
+		break;
+	case BIN_VT_STR:
+		s->v.str.off = rc->hdr->heapn;
+		s->v.str.len = sz;
+		memcpy(rc->heap + s->v.str.off, v->v.str.s, sz);
+		rc->hdr->heapn += sz;
+		break;
+	default:
+		s->vt = BIN_VT_UNK;
+		break;
+	}
+	return 0;
+}
+
+size_t
+rcache_size(const struct rcache_s *rc)
+{
+	return rc->map != NULL ? rc->hdr->nused : 0U;
+}
+
+/* rcache.c ends here */
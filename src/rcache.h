@@ -0,0 +1,105 @@
+/*** rcache.h -- reference data caches
+ *
+ * Copyright (C) 2013-2015 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of blpcli.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if !defined INCLUDED_rcache_h_
+#define INCLUDED_rcache_h_
+#include <stddef.h>
+#include <stdint.h>
+#include "bin.h"
+
+/**
+ * Reference data caches keep field values of securities in a file,
+ * keyed by security, field and overrides, along with the time they
+ * were fetched.  The file is a hash table that is mapped as is, a
+ * header, power-of-2 slots (open addressing) and a heap for keys and
+ * strings, all integers in host byte order.  Lookups therefore cost a
+ * hash and a probe, no parsing.
+ *
+ * The file is locked for as long as the cache is open, caches are not
+ * thread-safe. */
+typedef struct rcache_s *rcache_t;
+
+/**
+ * A cached value, VT is one of BIN_VT_*, BIN_VT_UNK standing for
+ * a field the security has no value for.  Strings returned by
+ * rcache_get() point into the mapping and are valid until the next
+ * rcache_put(), they are not nul-terminated. */
+struct rcache_val_s {
+	/* nanoseconds since the epoch */
+	uint64_t fetched;
+	uint8_t vt;
+	union {
+		int64_t i64;
+		double f64;
+		float f32;
+		struct bin_dt_s dt;
+		struct {
+			const char *s;
+			size_t len;
+		} str;
+	} v;
+};
+
+
+/**
+ * Open (or create) the cache in file FN.
+ * Return NULL on error, with errno set to EWOULDBLOCK if another
+ * process has the cache open. */
+extern rcache_t make_rcache(const char *fn);
+
+/**
+ * Write back and close cache RC. */
+extern void free_rcache(rcache_t rc);
+
+/**
+ * Look up field FLD of security SEC, requested with overrides OVR
+ * (or NULL for none), and put it into V.
+ * Return 0 if found or -1 if not. */
+extern int rcache_get(rcache_t rc, const char *sec, const char *fld,
+		      const char *ovr, struct rcache_val_s *v);
+
+/**
+ * Store V as field FLD of security SEC with overrides OVR (or NULL),
+ * replacing what's there, V's string must not point into RC.
+ * Return 0 on success or -1 if the cache cannot grow. */
+extern int rcache_put(rcache_t rc, const char *sec, const char *fld,
+		      const char *ovr, const struct rcache_val_s *v);
+
+/**
+ * Return the number of entries in RC. */
+extern size_t rcache_size(const struct rcache_s *rc);
+
+#endif	/* INCLUDED_rcache_h_ */
@@ -0,0 +1,80 @@
+/*** ring.c -- single-producer single-consumer rings
+ *
+ * Copyright (C) 2013-2015 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of blpcli.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <string.h>
+#include "ring.h"
+#include "nifty.h"
+
+
+ring_t
+make_ring(size_t nslot, size_t slotz)
+{
+	size_t n = 1U;
+	ring_t r;
+
+	if (UNLIKELY(!nslot || !slotz)) {
+		return NULL;
+	}
+	/* round up to powers of 2 and to whole words */
+	for (; n < nslot; n <<= 1U);
+	slotz = (slotz + 7U) & ~(size_t)7U;
+
+	if (UNLIKELY(posix_memalign((void**)&r, 64U, sizeof(*r)))) {
+		return NULL;
+	}
+	memset(r, 0, sizeof(*r));
+	if (UNLIKELY((r->slots = malloc(n * slotz)) == NULL)) {
+		free(r);
+		return NULL;
+	}
+	r->mask = n - 1U;
+	r->slotz = slotz;
+	return r;
+}
+
+void
+free_ring(ring_t r)
+{
+	free(r->slots);
+	free(r);
+	return;
+}
+
+/* ring.c ends here */
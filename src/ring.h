@@ -0,0 +1,148 @@
+/*** ring.h -- single-producer single-consumer rings
+ *
+ * Copyright (C) 2013-2015 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of blpcli.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if !defined INCLUDED_ring_h_
+#define INCLUDED_ring_h_
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Rings are a power-of-2 number of fixed-size slots, filled by exactly
+ * one producer thread and drained by exactly one consumer thread,
+ * without locks.  The producer never waits, if there's no free slot
+ * the record is dropped and counted.
+ *
+ * Producer: p = ring_prep(r), fill P, ring_push(r).
+ * Consumer: p = ring_peek(r), read P, ring_pop(r). */
+typedef struct ring_s *ring_t;
+
+struct ring_stat_s {
+	/* records pushed and dropped, most slots ever in use as seen by
+	 * the producer, which may lag behind the consumer */
+	size_t npush;
+	size_t ndrop;
+	size_t hiwat;
+};
+
+struct ring_s {
+	/* next slot to fill, written by the producer only */
+	size_t head __attribute__((aligned(64)));
+	/* producer's view of TAIL, saves on cache line bouncing */
+	size_t tcache;
+	struct ring_stat_s st;
+
+	/* next slot to drain, written by the consumer only */
+	size_t tail __attribute__((aligned(64)));
+
+	size_t mask __attribute__((aligned(64)));
+	size_t slotz;
+	char *slots;
+};
+
+
+/**
+ * Return a ring of at least NSLOT slots of SLOTZ bytes each. */
+extern ring_t make_ring(size_t nslot, size_t slotz);
+
+/**
+ * Free resources associated with ring R. */
+extern void free_ring(ring_t r);
+
+
+/**
+ * Return the number of slots in use, as seen from either side. */
+static inline size_t
+ring_fill(const struct ring_s *r)
+{
+	return __atomic_load_n(&r->head, __ATOMIC_ACQUIRE) -
+		__atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Return the slot to fill next or NULL (and count a drop) if R is full. */
+static inline void*
+ring_prep(struct ring_s *r)
+{
+	const size_t h = r->head;
+
+	if (h - r->tcache > r->mask) {
+		r->tcache = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+		if (h - r->tcache > r->mask) {
+			r->st.ndrop++;
+			return NULL;
+		}
+	}
+	return r->slots + (h & r->mask) * r->slotz;
+}
+
+/**
+ * Publish the slot returned by the last ring_prep(). */
+static inline void
+ring_push(struct ring_s *r)
+{
+	const size_t h = r->head + 1U;
+
+	if (h - r->tcache > r->st.hiwat) {
+		r->st.hiwat = h - r->tcache;
+	}
+	r->st.npush++;
+	__atomic_store_n(&r->head, h, __ATOMIC_RELEASE);
+	return;
+}
+
+/**
+ * Return the oldest published slot of R or NULL if R is empty. */
+static inline void*
+ring_peek(struct ring_s *r)
+{
+	const size_t t = r->tail;
+
+	if (t == __atomic_load_n(&r->head, __ATOMIC_ACQUIRE)) {
+		return NULL;
+	}
+	return r->slots + (t & r->mask) * r->slotz;
+}
+
+/**
+ * Release the slot returned by the last ring_peek(). */
+static inline void
+ring_pop(struct ring_s *r)
+{
+	__atomic_store_n(&r->tail, r->tail + 1U, __ATOMIC_RELEASE);
+	return;
+}
+
+#endif	/* INCLUDED_ring_h_ */
@@ -0,0 +1,289 @@
+/*** rstat.c -- runtime statistics
+ *
+ * Copyright (C) 2013-2015 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of blpcli.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include "rstat.h"
+#include "clk.h"
+#include "nifty.h"
+
+/* registered counters, and how many topics they count */
+static struct rstat_s *thrs;
+static size_t ntop;
+static pthread_mutex_t thrlk = PTHREAD_MUTEX_INITIALIZER;
+static __thread struct rstat_s *self;
+
+/* milliseconds a client gets to take a snapshot off us */
+#define RSTAT_TMO	(1000U)
+
+static const char *const evnam[RSTAT_NEVT] = {
+	[1U] = "admin",
+	[2U] = "session_status",
+	[3U] = "subscription_status",
+	[4U] = "request_status",
+	[5U] = "response",
+	[6U] = "partial_response",
+	[8U] = "subscription_data",
+	[9U] = "service_status",
+	[10U] = "timeout",
+	[11U] = "authorization_status",
+	[12U] = "resolution_status",
+	[13U] = "topic_status",
+	[14U] = "token_status",
+	[15U] = "request",
+};
+
+
+int
+rstat_init(size_t n)
+{
+	ntop = n;
+	return 0;
+}
+
+void
+rstat_fini(void)
+{
+	pthread_mutex_lock(&thrlk);
+	for (struct rstat_s *r = thrs, *nx; r != NULL; r = nx) {
+		nx = r->next;
+		free(r->ntop);
+		free(r);
+	}
+	thrs = NULL;
+	pthread_mutex_unlock(&thrlk);
+	return;
+}
+
+struct rstat_s*
+rstat_self(void)
+{
+	struct rstat_s *r;
+
+	if (LIKELY(self != NULL)) {
+		return self;
+	} else if (UNLIKELY((r = calloc(1U, sizeof(*r))) == NULL)) {
+		return NULL;
+	} else if (ntop &&
+		   UNLIKELY((r->ntop = calloc(ntop, sizeof(*r->ntop))) == NULL)) {
+		free(r);
+		return NULL;
+	}
+	r->ntopz = ntop;
+	/* only registering needs the lock */
+	pthread_mutex_lock(&thrlk);
+	r->next = thrs;
+	thrs = r;
+	pthread_mutex_unlock(&thrlk);
+	return self = r;
+}
+
+void
+rstat_sum(struct rstat_s *tgt)
+{
+	uint64_t *tops = tgt->ntop;
+
+	memset(tgt, 0, sizeof(*tgt));
+	if (tops != NULL) {
+		memset(tops, 0, ntop * sizeof(*tops));
+	}
+	tgt->ntop = tops;
+	tgt->ntopz = tops != NULL ? ntop : 0U;
+
+	pthread_mutex_lock(&thrlk);
+	for (const struct rstat_s *r = thrs; r != NULL; r = r->next) {
+		for (size_t i = 0U; i < RSTAT_NEVT; i++) {
+			tgt->nev[i] += r->nev[i];
+		}
+		tgt->nmsg += r->nmsg;
+		tgt->nbyt += r->nbyt;
+		tgt->nerr += r->nerr;
+		for (size_t i = 0U; i < HIST_NBKT; i++) {
+			tgt->cbk.cnt[i] += r->cbk.cnt[i];
+		}
+		tgt->cbk.n += r->cbk.n;
+		if (r->cbk.max > tgt->cbk.max) {
+			tgt->cbk.max = r->cbk.max;
+		}
+		for (size_t i = 0U; tops != NULL && i < ntop; i++) {
+			tops[i] += r->ntop[i];
+		}
+	}
+	pthread_mutex_unlock(&thrlk);
+	return;
+}
+
+static double
+rate(uint64_t n, uint64_t dt)
+{
+/* per second, of N over DT nanoseconds */
+	return dt ? (double)n * 1000000000U / (double)dt : 0;
+}
+
+size_t
+rstat_prnt(char *restrict buf, size_t bsz,
+	   const struct rstat_s *cur, const struct rstat_s *prev, uint64_t dt)
+{
+	size_t n = 0U;
+
+#define PRNT(...)						\
+	if (n < bsz) {						\
+		n += snprintf(buf + n, bsz - n, __VA_ARGS__);	\
+	}
+	for (size_t i = 0U; i < RSTAT_NEVT; i++) {
+		if (evnam[i] != NULL) {
+			PRNT("ev.%s=%" PRIu64 " ", evnam[i], cur->nev[i]);
+		}
+	}
+	PRNT("msg=%" PRIu64 " msg_rate=%.1f", cur->nmsg,
+	     rate(cur->nmsg - prev->nmsg, dt));
+	PRNT(" bytes=%" PRIu64 " byte_rate=%.1f", cur->nbyt,
+	     rate(cur->nbyt - prev->nbyt, dt));
+	PRNT(" errors=%" PRIu64, cur->nerr);
+	PRNT(" cbk_n=%" PRIu64 " cbk_p50=%" PRIu64 " cbk_p99=%" PRIu64,
+	     cur->cbk.n, hist_qtl(&cur->cbk, 1U, 2U),
+	     hist_qtl(&cur->cbk, 99U, 100U));
+	PRNT(" cbk_p999=%" PRIu64 " cbk_max=%" PRIu64,
+	     hist_qtl(&cur->cbk, 999U, 1000U), cur->cbk.max);
+#undef PRNT
+	return n < bsz ? n : bsz - 1U;
+}
+
+int
+rstat_listen(const char *path)
+{
+	struct sockaddr_un sa = {.sun_family = AF_UNIX};
+	struct stat st;
+	int s;
+
+	if (UNLIKELY(strlen(path) >= sizeof(sa.sun_path))) {
+		return -1;
+	} else if (!lstat(path, &st) && UNLIKELY(!S_ISSOCK(st.st_mode))) {
+		/* not ours to remove */
+		errno = ENOTSOCK;
+		return -1;
+	} else if (UNLIKELY((s = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)) {
+		return -1;
+	}
+	strcpy(sa.sun_path, path);
+	/* a stale socket from an earlier run */
+	unlink(path);
+	if (UNLIKELY(bind(s, (struct sockaddr*)&sa, sizeof(sa)) < 0 ||
+		     listen(s, 8) < 0)) {
+		close(s);
+		return -1;
+	}
+	return s;
+}
+
+int
+rstat_write(int fd, const char *buf, size_t n)
+{
+	for (ssize_t nwr; n > 0U; buf += nwr, n -= nwr) {
+		if (UNLIKELY((nwr = write(fd, buf, n)) <= 0)) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+void*
+rstat_loop(void *arg)
+{
+	const struct rstat_srv_s *srv = arg;
+	uint64_t next = clk_mono() + srv->ivl;
+
+	/* clients hanging up on us are no reason to die */
+	with (sigset_t ss) {
+		sigemptyset(&ss);
+		sigaddset(&ss, SIGPIPE);
+		pthread_sigmask(SIG_BLOCK, &ss, NULL);
+	}
+	for (;;) {
+		struct pollfd p = {.fd = srv->sok, .events = POLLIN};
+		const uint64_t now = clk_mono();
+		int tmo = -1;
+
+		if (srv->ivl) {
+			tmo = next > now ? (next - now + 999999U) / 1000000U : 0;
+		}
+		if (poll(&p, srv->sok >= 0, tmo) > 0) {
+			int c;
+
+			if ((c = accept(srv->sok, NULL, NULL)) >= 0) {
+				/* clients that don't read mustn't keep us */
+				const struct timeval sto = {
+					.tv_sec = RSTAT_TMO / 1000U,
+					.tv_usec = RSTAT_TMO % 1000U * 1000U,
+				};
+
+				setsockopt(c, SOL_SOCKET, SO_SNDTIMEO,
+					   &sto, sizeof(sto));
+				pthread_setcancelstate(
+					PTHREAD_CANCEL_DISABLE, NULL);
+				srv->prnt(c, true, srv->clo);
+				close(c);
+				pthread_setcancelstate(
+					PTHREAD_CANCEL_ENABLE, NULL);
+			}
+		}
+		if (srv->ivl && clk_mono() >= next) {
+			pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+			srv->prnt(STDERR_FILENO, false, srv->clo);
+			pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+			/* skip the lines we're late for */
+			for (next += srv->ivl; next <= clk_mono();
+			     next += srv->ivl);
+		}
+	}
+	return NULL;
+}
+
+/* rstat.c ends here */
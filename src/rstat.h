@@ -0,0 +1,138 @@
+/*** rstat.h -- runtime statistics
+ *
+ * Copyright (C) 2013-2015 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of blpcli.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if !defined INCLUDED_rstat_h_
+#define INCLUDED_rstat_h_
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "hist.h"
+
+/* blpapi event types go from 1 to 15 */
+#define RSTAT_NEVT	(16U)
+
+/**
+ * Counters of one thread, threads register theirs on first use (see
+ * rstat_self()) and only ever touch their own, readers add them all
+ * up (see rstat_sum()).  As with histograms no locking is done, so
+ * readers may see slightly inconsistent counts. */
+struct rstat_s {
+	/* events by blpapi event type */
+	uint64_t nev[RSTAT_NEVT];
+	/* data messages, and updates per topic (see rstat_init()) */
+	uint64_t nmsg;
+	uint64_t *ntop;
+	size_t ntopz;
+	/* bytes sent, and failed sends */
+	uint64_t nbyt;
+	uint64_t nerr;
+	/* nanoseconds spent in callbacks */
+	struct hist_s cbk;
+
+	struct rstat_s *next;
+};
+
+/**
+ * Serve statistics from a thread of its own, see rstat_loop(). */
+struct rstat_srv_s {
+	/* listening socket, or -1 */
+	int sok;
+	/* nanoseconds between lines on stderr, or 0 */
+	uint64_t ivl;
+	/* write statistics to FD, with a line per topic if TOPP */
+	void(*prnt)(int fd, bool topp, void *clo);
+	void *clo;
+};
+
+
+/**
+ * Set up statistics with per-topic counters for NTOP topics.
+ * Return 0 on success or -1 on failure. */
+extern int rstat_init(size_t ntop);
+
+/**
+ * Free the counters of all threads. */
+extern void rstat_fini(void);
+
+/**
+ * Return the calling thread's counters, NULL if they can't be had.
+ * Register them on the first call. */
+extern struct rstat_s *rstat_self(void);
+
+/**
+ * Add up the counters of all threads into TGT, per-topic ones only if
+ * its NTOP slot points to room for as many topics as given to
+ * rstat_init(). */
+extern void rstat_sum(struct rstat_s *tgt);
+
+/**
+ * Print the counters CUR, and rates since PREV taken DT nanoseconds
+ * earlier, to BUF as space-separated KEY=VALUE pairs.
+ * Return the number of bytes written. */
+extern size_t rstat_prnt(char *restrict buf, size_t bsz,
+			 const struct rstat_s *cur, const struct rstat_s *prev,
+			 uint64_t dt);
+
+/**
+ * Return a UNIX socket listening at PATH, or -1 on failure.
+ * A socket already at PATH is replaced, anything else is left alone
+ * and counts as failure (errno ENOTSOCK). */
+extern int rstat_listen(const char *path);
+
+/**
+ * Write N bytes of BUF to FD, for prnt routines of struct rstat_srv_s.
+ * Return 0 on success or -1 on failure, clients get a second to read
+ * what's written to them. */
+extern int rstat_write(int fd, const char *buf, size_t n);
+
+/**
+ * Thread routine to serve statistics as described by the struct
+ * rstat_srv_s ARG, runs until cancelled, with SIGPIPE blocked. */
+extern void *rstat_loop(void *arg);
+
+
+/**
+ * Count an update of topic I in R. */
+static inline void
+rstat_top(struct rstat_s *r, size_t i)
+{
+	if (i < r->ntopz) {
+		r->ntop[i]++;
+	}
+	return;
+}
+
+#endif	/* INCLUDED_rstat_h_ */
@@ -0,0 +1,178 @@
+/*** sopt.c -- blpapi session options
+ *
+ * Copyright (C) 2013-2015 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of blpcli.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include <string.h>
+#include "sopt.h"
+#include "nifty.h"
+
+/* in the absence of servers on the command line */
+static struct sopt_srv_s dflt = {"localhost", SOPT_PORT};
+
+
+static int
+srv_strp(struct sopt_srv_s *restrict tgt, char *s)
+{
+/* HOST, HOST:PORT or [ADDR]:PORT, the latter for v6 addresses */
+	char *p = NULL;
+
+	if (*s == '[') {
+		char *eo;
+
+		if (UNLIKELY((eo = strchr(++s, ']')) == NULL)) {
+			return -1;
+		} else if (eo[1U] == ':') {
+			p = eo + 2U;
+		} else if (eo[1U]) {
+			return -1;
+		}
+		*eo = '\0';
+	} else if ((p = strchr(s, ':')) != NULL) {
+		*p++ = '\0';
+	}
+	tgt->host = s;
+	tgt->port = SOPT_PORT;
+	if (p != NULL) {
+		char *on;
+		unsigned long int port = strtoul(p, &on, 10);
+
+		if (UNLIKELY(*on || !port || port > 65535U)) {
+			return -1;
+		}
+		tgt->port = (unsigned short int)port;
+	}
+	return *s ? 0 : -1;
+}
+
+
+int
+sopt_init(struct sopt_s *so, char *const *srv, size_t nsrv)
+{
+	*so = (struct sopt_s){
+		.qz = SOPT_QZ,
+		.hiwat = SOPT_HIWAT,
+		.lowat = SOPT_LOWAT,
+		.tmo = SOPT_TMO,
+	};
+	if (!nsrv) {
+		so->srv = &dflt;
+		so->nsrv = 1U;
+		return 0;
+	} else if (UNLIKELY((so->srv = calloc(nsrv, sizeof(*so->srv))) == NULL)) {
+		return -1;
+	}
+	for (; so->nsrv < nsrv; so->nsrv++) {
+		if (UNLIKELY(srv_strp(so->srv + so->nsrv, srv[so->nsrv]) < 0)) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+void
+sopt_fini(struct sopt_s *so)
+{
+	if (so->srv != NULL && so->srv != &dflt) {
+		free(so->srv);
+	}
+	return;
+}
+
+blpapi_SessionOptions_t*
+sopt_make(const struct sopt_s *so)
+{
+	blpapi_SessionOptions_t *opt;
+	int rc = 0;
+
+	if (UNLIKELY((opt = blpapi_SessionOptions_create()) == NULL)) {
+		return NULL;
+	}
+	for (size_t i = 0U; i < so->nsrv; i++) {
+		rc |= blpapi_SessionOptions_setServerAddress(
+			opt, so->srv[i].host, so->srv[i].port, i);
+	}
+	/* give every server a go */
+	blpapi_SessionOptions_setNumStartAttempts(opt, (int)so->nsrv);
+	rc |= blpapi_SessionOptions_setConnectTimeout(opt, so->tmo);
+	blpapi_SessionOptions_setMaxEventQueueSize(opt, so->qz);
+	rc |= blpapi_SessionOptions_setSlowConsumerWarningHiWaterMark(
+		opt, so->hiwat);
+	rc |= blpapi_SessionOptions_setSlowConsumerWarningLoWaterMark(
+		opt, so->lowat);
+	/* for latency accounting */
+	blpapi_SessionOptions_setRecordSubscriptionDataReceiveTimes(opt, 1);
+	if (UNLIKELY(rc)) {
+		blpapi_SessionOptions_destroy(opt);
+		return NULL;
+	}
+	return opt;
+}
+
+void
+sopt_prnt(const struct sopt_s *so)
+{
+	for (size_t i = 0U; i < so->nsrv; i++) {
+		const char *h = so->srv[i].host;
+		const char *fmt = strchr(h, ':')
+			? "server %zu: [%s]:%hu\n" : "server %zu: %s:%hu\n";
+
+		fprintf(stderr, fmt, i, h, so->srv[i].port);
+	}
+	fprintf(stderr, "\
+queue: %zu events, warn at %.0f%% full, clear at %.0f%%\n\
+connect timeout: %ums\n",
+		so->qz, so->hiwat * 100, so->lowat * 100, so->tmo);
+	return;
+}
+
+void
+sopt_qprnt(const struct sopt_qst_s *q, size_t i)
+{
+	fprintf(stderr, "\
+queue of session %zu: %zu times above high-water mark, \
+%" PRIu64 ".%03" PRIu64 "s altogether, \
+%zu messages shed, %zu data losses\n",
+		i, q->nhi, q->thi / 1000000000U, q->thi / 1000000U % 1000U,
+		q->ndrop, q->nloss);
+	return;
+}
+
+/* sopt.c ends here */
@@ -0,0 +1,143 @@
+/*** sopt.h -- blpapi session options
+ *
+ * Copyright (C) 2013-2015 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of blpcli.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if !defined INCLUDED_sopt_h_
+#define INCLUDED_sopt_h_
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <blpapi_sessionoptions.h>
+
+/**
+ * Session settings as given on the command line, servers are tried
+ * in turn when a session starts. */
+struct sopt_s {
+	struct sopt_srv_s {
+		const char *host;
+		unsigned short int port;
+	} *srv;
+	size_t nsrv;
+	/* events blpapi queues for us */
+	size_t qz;
+	/* queue fill (fractions of QZ) to warn of slow consumption at,
+	 * and to clear the warning at */
+	float hiwat;
+	float lowat;
+	/* connect timeout in milliseconds */
+	unsigned int tmo;
+};
+
+/**
+ * Times a session's queue went above the high-water mark, and for how
+ * long altogether, see the SlowConsumerWarning admin messages, as well
+ * as messages we dropped (see --slow) and blpapi dropped (DataLoss). */
+struct sopt_qst_s {
+	size_t nhi;
+	uint64_t thi;
+	/* when the queue went above the mark, 0 if below */
+	uint64_t hi0;
+	size_t ndrop;
+	size_t nloss;
+};
+
+#define SOPT_PORT	(8194U)
+#define SOPT_QZ		(8192U)
+#define SOPT_HIWAT	(0.75f)
+#define SOPT_LOWAT	(0.5f)
+#define SOPT_TMO	(5000U)
+
+
+/**
+ * Set up SO from server specs SRV (NSRV of them) of the form HOST,
+ * HOST:PORT or [ADDR]:PORT, localhost if none, and defaults for the
+ * rest.  The host strings are modified in place and must stay around.
+ * Return 0 on success or -1 if a spec doesn't parse. */
+extern int sopt_init(struct sopt_s *so, char *const *srv, size_t nsrv);
+
+/**
+ * Free resources associated with SO. */
+extern void sopt_fini(struct sopt_s *so);
+
+/**
+ * Return blpapi session options according to SO. */
+extern blpapi_SessionOptions_t *sopt_make(const struct sopt_s *so);
+
+/**
+ * Print the settings in SO to stderr. */
+extern void sopt_prnt(const struct sopt_s *so);
+
+/**
+ * Print the queue statistics Q of session I to stderr. */
+extern void sopt_qprnt(const struct sopt_qst_s *q, size_t i);
+
+
+/**
+ * Note that Q went above the high-water mark at NOW,
+ * return whether it was below before. */
+static inline bool
+sopt_qhi(struct sopt_qst_s *q, uint64_t now)
+{
+	if (q->hi0) {
+		return false;
+	}
+	q->nhi++;
+	__atomic_store_n(&q->hi0, now, __ATOMIC_RELEASE);
+	return true;
+}
+
+/**
+ * Note that Q went back below the low-water mark at NOW,
+ * return whether it was above before. */
+static inline bool
+sopt_qlo(struct sopt_qst_s *q, uint64_t now)
+{
+	if (!q->hi0) {
+		return false;
+	}
+	q->thi += now - q->hi0;
+	__atomic_store_n(&q->hi0, 0U, __ATOMIC_RELEASE);
+	return true;
+}
+
+/**
+ * Return whether Q is above the high-water mark. */
+static inline bool
+sopt_qhip(const struct sopt_qst_s *q)
+{
+	return __atomic_load_n(&q->hi0, __ATOMIC_ACQUIRE) != 0U;
+}
+
+#endif	/* INCLUDED_sopt_h_ */
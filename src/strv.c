@@ -0,0 +1,228 @@
+/*** strv.c -- string vectors backed by arenas
+ *
+ * Copyright (C) 2013-2015 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of blpcli.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "strv.h"
+#include "nifty.h"
+
+
+static int
+strv_grow(struct strv_s *sv, size_t n)
+{
+/* make room for N more strings, doubling the index each time */
+	size_t nu;
+	char **v;
+
+	if (LIKELY(sv->n + n <= sv->z)) {
+		return 0;
+	}
+	for (nu = sv->z ? sv->z : 64U; nu < sv->n + n; nu *= 2U);
+	if (UNLIKELY((v = realloc(sv->v, nu * sizeof(*v))) == NULL)) {
+		return -1;
+	}
+	sv->v = v;
+	sv->z = nu;
+	return 0;
+}
+
+static char*
+slurp(int fd, size_t *zp)
+{
+/* read FD into a heap buffer, leaving room for a final \0 */
+	size_t z = 65536U;
+	size_t n = 0U;
+	char *buf = NULL;
+
+	do {
+		char *tmp;
+		ssize_t nrd;
+
+		if (n + 1U >= z || buf == NULL) {
+			z *= 2U;
+			if (UNLIKELY((tmp = realloc(buf, z)) == NULL)) {
+				goto nul;
+			}
+			buf = tmp;
+		}
+		if (UNLIKELY((nrd = read(fd, buf + n, z - n - 1U)) < 0)) {
+			if (errno == EINTR) {
+				continue;
+			}
+			goto nul;
+		} else if (nrd == 0) {
+			break;
+		}
+		n += nrd;
+	} while (1);
+	*zp = n;
+	return buf;
+
+nul:
+	free(buf);
+	return NULL;
+}
+
+static char*
+map(int fd, size_t *zp)
+{
+/* map FD privately so we can split lines in place, or return NULL */
+	const size_t pgsz = sysconf(_SC_PAGESIZE);
+	struct stat st;
+	void *p;
+
+	if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+		return NULL;
+	} else if (!((size_t)st.st_size % pgsz)) {
+		/* no room behind the last byte for a final \0 */
+		return NULL;
+	}
+	p = mmap(NULL, st.st_size + 1U, PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE, fd, 0);
+	if (UNLIKELY(p == MAP_FAILED)) {
+		return NULL;
+	}
+	*zp = st.st_size;
+	return p;
+}
+
+
+int
+strv_add(struct strv_s *sv, char *s)
+{
+	if (UNLIKELY(strv_grow(sv, 1U) < 0)) {
+		return -1;
+	}
+	sv->v[sv->n++] = s;
+	return 0;
+}
+
+int
+strv_addv(struct strv_s *sv, char *const *v, size_t n)
+{
+	if (UNLIKELY(strv_grow(sv, n) < 0)) {
+		return -1;
+	}
+	memcpy(sv->v + sv->n, v, n * sizeof(*v));
+	sv->n += n;
+	return 0;
+}
+
+int
+strv_resv(struct strv_s *sv, size_t n)
+{
+	return strv_grow(sv, n);
+}
+
+ssize_t
+strv_load(struct strv_s *sv, const char *fn)
+{
+	const size_t n0 = sv->n;
+	char *buf;
+	size_t z;
+	int fd;
+
+	if (UNLIKELY(sv->arent != STRV_ARENA_NONE)) {
+		errno = EEXIST;
+		return -1;
+	} else if (fn[0U] == '-' && fn[1U] == '\0') {
+		fd = STDIN_FILENO;
+	} else if ((fd = open(fn, O_RDONLY)) < 0) {
+		return -1;
+	}
+
+	if ((buf = map(fd, &z)) != NULL) {
+		sv->arent = STRV_ARENA_MMAP;
+	} else if ((buf = slurp(fd, &z)) != NULL) {
+		sv->arent = STRV_ARENA_HEAP;
+	}
+	if (fd != STDIN_FILENO) {
+		close(fd);
+	}
+	if (UNLIKELY(buf == NULL)) {
+		return -1;
+	}
+	sv->arena = buf;
+	sv->arenz = z;
+
+	/* split in place, one pass */
+	buf[z] = '\0';
+	for (char *bp = buf, *const ep = buf + z, *eol; bp < ep; bp = eol + 1) {
+		if ((eol = memchr(bp, '\n', ep - bp)) == NULL) {
+			eol = ep;
+		}
+		*eol = '\0';
+		if (eol > bp && eol[-1] == '\r') {
+			eol[-1] = '\0';
+		}
+		if (!*bp) {
+			continue;
+		} else if (UNLIKELY(strv_add(sv, bp) < 0)) {
+			return -1;
+		}
+	}
+	return sv->n - n0;
+}
+
+void
+strv_free(struct strv_s *sv)
+{
+	switch (sv->arent) {
+	case STRV_ARENA_MMAP:
+		munmap(sv->arena, sv->arenz + 1U);
+		break;
+	case STRV_ARENA_HEAP:
+		free(sv->arena);
+		break;
+	default:
+		break;
+	}
+	if (sv->v != NULL) {
+		free(sv->v);
+	}
+	memset(sv, 0, sizeof(*sv));
+	return;
+}
+
+/* strv.c ends here */
@@ -0,0 +1,86 @@
+/*** strv.h -- string vectors backed by arenas
+ *
+ * Copyright (C) 2013-2015 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of blpcli.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if !defined INCLUDED_strv_h_
+#define INCLUDED_strv_h_
+#include <stddef.h>
+#include <sys/types.h>
+
+/**
+ * String vectors are an index array of strings that live elsewhere,
+ * either in argv or in a file mapping (or buffer) owned by the vector. */
+struct strv_s {
+	size_t n;
+	size_t z;
+	char **v;
+
+	/* arena holding the strings read from a file */
+	char *arena;
+	size_t arenz;
+	enum {
+		STRV_ARENA_NONE,
+		STRV_ARENA_MMAP,
+		STRV_ARENA_HEAP,
+	} arent;
+};
+
+
+/**
+ * Append string S to SV, S is not copied.
+ * Return 0 on success or -1 if memory is exhausted. */
+extern int strv_add(struct strv_s *sv, char *s);
+
+/**
+ * Append the N strings V to SV, strings are not copied. */
+extern int strv_addv(struct strv_s *sv, char *const *v, size_t n);
+
+/**
+ * Make room for N more strings, so that adding them won't move SV->v.
+ * Return 0 on success or -1 if memory is exhausted. */
+extern int strv_resv(struct strv_s *sv, size_t n);
+
+/**
+ * Append every non-empty line of file FN (or stdin if FN is `-') to SV.
+ * The file is mapped (or read) in one go and split in place, there can
+ * be only one such file per vector.
+ * Return the number of strings added, or -1 on error. */
+extern ssize_t strv_load(struct strv_s *sv, const char *fn);
+
+/**
+ * Free resources associated with SV. */
+extern void strv_free(struct strv_s *sv);
+
+#endif	/* INCLUDED_strv_h_ */
@@ -0,0 +1,232 @@
+/*** tcol.c -- columnar tick files
+ *
+ * Copyright (C) 2013-2015 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of blpcli.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include "tcol.h"
+#include "nifty.h"
+
+/* average condition codes length we budget the heap for */
+#define TCOL_CCZ	(8U)
+
+static const char *const ttstr[NTCOL_TT] = {
+	[TCOL_TT_TRADE] = "TRADE",
+	[TCOL_TT_BID] = "BID",
+	[TCOL_TT_ASK] = "ASK",
+	[TCOL_TT_BID_BEST] = "BID_BEST",
+	[TCOL_TT_ASK_BEST] = "ASK_BEST",
+	[TCOL_TT_BEST_BID] = "BEST_BID",
+	[TCOL_TT_BEST_ASK] = "BEST_ASK",
+	[TCOL_TT_MID_PRICE] = "MID_PRICE",
+	[TCOL_TT_AT_TRADE] = "AT_TRADE",
+	[TCOL_TT_SETTLE] = "SETTLE",
+};
+
+
+static ssize_t
+xwritev(int fd, struct iovec *iov, int niov)
+{
+	ssize_t tot = 0;
+
+	while (niov > 0) {
+		ssize_t nwr;
+
+		if (UNLIKELY((nwr = writev(fd, iov, niov)) < 0)) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return -1;
+		}
+		tot += nwr;
+		/* skip over fully written vectors */
+		for (; niov > 0 && (size_t)nwr >= iov->iov_len; iov++, niov--) {
+			nwr -= iov->iov_len;
+		}
+		if (niov > 0) {
+			iov->iov_base = (char*)iov->iov_base + nwr;
+			iov->iov_len -= nwr;
+		}
+	}
+	return tot;
+}
+
+
+tcol_t
+make_tcol(size_t cap)
+{
+	/* all columns go right behind the buffer, widest first */
+	const size_t colz = sizeof(int64_t) + sizeof(double) +
+		sizeof(int64_t) + sizeof(uint32_t) + sizeof(uint8_t);
+	tcol_t tc;
+
+	if (UNLIKELY(!cap)) {
+		return NULL;
+	} else if (UNLIKELY((tc = malloc(
+				     sizeof(*tc) + cap * colz +
+				     cap * TCOL_CCZ)) == NULL)) {
+		return NULL;
+	}
+	tc->tim = (void*)(tc + 1U);
+	tc->val = (void*)(tc->tim + cap);
+	tc->siz = (void*)(tc->val + cap);
+	tc->cend = (void*)(tc->siz + cap);
+	tc->typ = (void*)(tc->cend + cap);
+	tc->heap = (void*)(tc->typ + cap);
+	tc->cap = cap;
+	tc->heapcap = cap * TCOL_CCZ;
+	tc->ntick = tc->heapz = 0U;
+	tc->nblk = tc->ntot = 0U;
+	tc->fd = -1;
+	return tc;
+}
+
+void
+free_tcol(tcol_t tc)
+{
+	if (tc->fd >= 0) {
+		close(tc->fd);
+	}
+	free(tc);
+	return;
+}
+
+int
+tcol_open(tcol_t tc, const char *fn, const char *sec, int day)
+{
+	static const char pad[8U];
+	const size_t z = strlen(sec);
+	struct tcol_hdr_s h = {
+		.magic = TCOL_MAGIC,
+		.ver = TCOL_VERSION,
+		.len = z <= UINT16_MAX ? z : UINT16_MAX,
+		.day = day,
+	};
+	struct iovec iov[] = {
+		{&h, sizeof(h)},
+		{deconst(sec), h.len},
+		{deconst(pad), -h.len % 8U},
+	};
+	int fd;
+
+	if (UNLIKELY((fd = open(fn, O_WRONLY | O_CREAT | O_TRUNC, 0666)) < 0)) {
+		return -1;
+	} else if (UNLIKELY(xwritev(fd, iov, countof(iov)) < 0)) {
+		close(fd);
+		return -1;
+	}
+	tc->fd = fd;
+	tc->ntick = tc->heapz = 0U;
+	tc->nblk = tc->ntot = 0U;
+	return 0;
+}
+
+int
+tcol_flush(tcol_t tc)
+{
+	static const char pad[8U];
+	const size_t n = tc->ntick;
+	struct tcol_blk_s b = {
+		.ntick = n,
+		.heapz = tc->heapz,
+	};
+	struct iovec iov[] = {
+		{&b, sizeof(b)},
+		{tc->tim, n * sizeof(*tc->tim)},
+		{tc->val, n * sizeof(*tc->val)},
+		{tc->siz, n * sizeof(*tc->siz)},
+		{tc->cend, n * sizeof(*tc->cend)},
+		{tc->typ, n * sizeof(*tc->typ)},
+		{tc->heap, tc->heapz},
+		{deconst(pad), 0U},
+	};
+	size_t len = 0U;
+	ssize_t nwr;
+
+	if (!n) {
+		return 0;
+	} else if (UNLIKELY(tc->fd < 0)) {
+		return -1;
+	}
+	for (size_t i = 0U; i < countof(iov) - 1U; i++) {
+		len += iov[i].iov_len;
+	}
+	iov[countof(iov) - 1U].iov_len = -len % 8U;
+	b.len = len + -len % 8U;
+
+	nwr = xwritev(tc->fd, iov, countof(iov));
+	/* the ticks are gone either way */
+	tc->ntick = tc->heapz = 0U;
+	if (UNLIKELY(nwr < 0)) {
+		return -1;
+	}
+	tc->nblk++;
+	tc->ntot += n;
+	return 0;
+}
+
+int
+tcol_close(tcol_t tc)
+{
+	int rc;
+
+	if (tc->fd < 0) {
+		return 0;
+	}
+	rc = tcol_flush(tc);
+	rc |= close(tc->fd);
+	tc->fd = -1;
+	return rc;
+}
+
+tcol_tt_t
+tcol_tt(const char *str)
+{
+	for (size_t i = 1U; i < countof(ttstr); i++) {
+		if (!strcmp(str, ttstr[i])) {
+			return (tcol_tt_t)i;
+		}
+	}
+	return TCOL_TT_UNK;
+}
+
+/* tcol.c ends here */
@@ -0,0 +1,179 @@
+/*** tcol.h -- columnar tick files
+ *
+ * Copyright (C) 2013-2015 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of blpcli.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if !defined INCLUDED_tcol_h_
+#define INCLUDED_tcol_h_
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Tick files hold the ticks of one security and day in blocks of
+ * columns, all integers in host byte order, the header's magic and
+ * version double as byte order mark.  A file starts with a struct
+ * tcol_hdr_s and the security name, padded to a multiple of 8 bytes.
+ *
+ * Each block is a struct tcol_blk_s followed by its NTICK ticks, column
+ * after column:
+ *   NTICK int64_t, tick times in nanoseconds since the epoch
+ *   NTICK double, values
+ *   NTICK int64_t, sizes
+ *   NTICK uint32_t, end offsets of the condition codes in the heap
+ *   NTICK uint8_t, TCOL_TT_* tick types
+ *   HEAPZ bytes of condition codes, not nul-terminated
+ * and again padded to a multiple of 8 bytes. */
+#define TCOL_MAGIC	"BLPT"
+#define TCOL_VERSION	(1U)
+
+typedef enum {
+	TCOL_TT_UNK,
+	TCOL_TT_TRADE,
+	TCOL_TT_BID,
+	TCOL_TT_ASK,
+	TCOL_TT_BID_BEST,
+	TCOL_TT_ASK_BEST,
+	TCOL_TT_BEST_BID,
+	TCOL_TT_BEST_ASK,
+	TCOL_TT_MID_PRICE,
+	TCOL_TT_AT_TRADE,
+	TCOL_TT_SETTLE,
+	NTCOL_TT
+} tcol_tt_t;
+
+struct tcol_hdr_s {
+	char magic[4U];
+	uint16_t ver;
+	/* length of the security name that follows */
+	uint16_t len;
+	/* day (since epoch) of the ticks */
+	int32_t day;
+	uint32_t rsv;
+};
+
+struct tcol_blk_s {
+	/* length of the whole block, this header and padding included */
+	uint32_t len;
+	uint32_t ntick;
+	uint32_t heapz;
+	uint32_t rsv;
+};
+
+/**
+ * A tick buffer holds the columns of up to CAP ticks, allocated once,
+ * and the file they're flushed to. */
+typedef struct tcol_s *tcol_t;
+
+struct tcol_s {
+	size_t ntick;
+	size_t cap;
+	int64_t *tim;
+	double *val;
+	int64_t *siz;
+	uint32_t *cend;
+	uint8_t *typ;
+	/* condition codes heap, HEAPZ of HEAPCAP bytes used */
+	char *heap;
+	size_t heapz;
+	size_t heapcap;
+	int fd;
+
+	/* blocks and ticks written so far */
+	size_t nblk;
+	size_t ntot;
+};
+
+
+/**
+ * Return a tick buffer for CAP ticks per block. */
+extern tcol_t make_tcol(size_t cap);
+
+/**
+ * Free resources associated with tick buffer TC, no flushing is done. */
+extern void free_tcol(tcol_t tc);
+
+/**
+ * Create tick file FN for security SEC and day DAY (since epoch),
+ * write its header and attach it to TC.
+ * Return 0 on success or -1 on error. */
+extern int tcol_open(tcol_t tc, const char *fn, const char *sec, int day);
+
+/**
+ * Write the buffered ticks of TC as a block.
+ * Return 0 on success or -1 on error. */
+extern int tcol_flush(tcol_t tc);
+
+/**
+ * Flush TC and close its file.
+ * Return 0 on success or -1 on error. */
+extern int tcol_close(tcol_t tc);
+
+/**
+ * Return the TCOL_TT_* tick type of event type string STR. */
+extern tcol_tt_t tcol_tt(const char *str);
+
+
+/**
+ * Append a tick to TC, flushing a block first if TC is full.
+ * Condition codes CC may be NULL. */
+static inline int
+tcol_add(tcol_t tc, int64_t ns, tcol_tt_t typ, double val, int64_t siz,
+	 const char *cc)
+{
+	size_t ccz = cc != NULL ? strlen(cc) : 0U;
+
+	if (ccz > tc->heapcap) {
+		/* truncate, we don't do overlong condition codes */
+		ccz = tc->heapcap;
+	}
+	if (tc->ntick >= tc->cap || tc->heapz + ccz > tc->heapcap) {
+		if (tcol_flush(tc) < 0) {
+			return -1;
+		}
+	}
+	if (ccz) {
+		memcpy(tc->heap + tc->heapz, cc, ccz);
+		tc->heapz += ccz;
+	}
+	tc->tim[tc->ntick] = ns;
+	tc->val[tc->ntick] = val;
+	tc->siz[tc->ntick] = siz;
+	tc->cend[tc->ntick] = tc->heapz;
+	tc->typ[tc->ntick] = (uint8_t)typ;
+	tc->ntick++;
+	return 0;
+}
+
+#endif	/* INCLUDED_tcol_h_ */
@@ -0,0 +1,104 @@
+/*** ttab.c -- topic tables
+ *
+ * Copyright (C) 2013-2015 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of blpcli.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <string.h>
+#include "ttab.h"
+#include "nifty.h"
+
+
+ttab_t
+make_ttab(size_t n)
+{
+	size_t z = 64U;
+	ttab_t tt;
+
+	/* keep the load below one half */
+	for (; z < 2U * n; z <<= 1U);
+	if (UNLIKELY((tt = malloc(sizeof(*tt))) == NULL)) {
+		return NULL;
+	} else if (UNLIKELY((tt->slot = calloc(z, sizeof(*tt->slot))) == NULL)) {
+		free(tt);
+		return NULL;
+	}
+	tt->mask = z - 1U;
+	tt->n = 0U;
+	return tt;
+}
+
+void
+free_ttab(ttab_t tt)
+{
+	free(tt->slot);
+	free(tt);
+	return;
+}
+
+ssize_t
+ttab_get(ttab_t tt, char *const *tops, const char *top)
+{
+	for (size_t h = strhash(top);; h++) {
+		const uint32_t k = tt->slot[h & tt->mask];
+
+		if (!k) {
+			return -1;
+		} else if (!strcmp(tops[k - 1U], top)) {
+			return k - 1U;
+		}
+	}
+}
+
+int
+ttab_put(ttab_t tt, char *const *tops, size_t i)
+{
+	if (UNLIKELY(2U * (tt->n + 1U) > tt->mask + 1U)) {
+		return -1;
+	}
+	for (size_t h = strhash(tops[i]);; h++) {
+		uint32_t *k = tt->slot + (h & tt->mask);
+
+		if (!*k) {
+			*k = i + 1U;
+			tt->n++;
+			return 0;
+		}
+	}
+}
+
+/* ttab.c ends here */
@@ -0,0 +1,76 @@
+/*** ttab.h -- topic tables
+ *
+ * Copyright (C) 2013-2015 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of blpcli.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if !defined INCLUDED_ttab_h_
+#define INCLUDED_ttab_h_
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/**
+ * Topic tables map topic strings to their index in a topic vector,
+ * which doubles as their correlation id (minus 1).  Indices are handed
+ * out once and never reused, the strings themselves stay with the
+ * caller's vector. */
+typedef struct ttab_s *ttab_t;
+
+struct ttab_s {
+	/* open addressing, power-of-2 slots holding index plus 1 */
+	size_t mask;
+	uint32_t *slot;
+	size_t n;
+};
+
+
+/**
+ * Return a topic table with room for at least N topics. */
+extern ttab_t make_ttab(size_t n);
+
+/**
+ * Free resources associated with topic table TT. */
+extern void free_ttab(ttab_t tt);
+
+/**
+ * Return the index of topic TOP in TT or -1 if not present,
+ * TOPS is the topic vector the indices refer to. */
+extern ssize_t ttab_get(ttab_t tt, char *const *tops, const char *top);
+
+/**
+ * Add topic TOPS[I] to TT.
+ * Return 0 on success or -1 if TT is full. */
+extern int ttab_put(ttab_t tt, char *const *tops, size_t i);
+
+#endif	/* INCLUDED_ttab_h_ */
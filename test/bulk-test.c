@@ -0,0 +1,248 @@
+/*** bulk-test.c -- bulk and nested field values as text
+ *
+ * Copyright (C) 2013-2015 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of blpcli.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+/* the printers are blpcli's own, we just need them */
+#define main	blpcli_main
+int blpcli_main(int argc, char *argv[]);
+#include "blpcli.c"
+#undef main
+
+/* elements we make up, in place of blpapi's, sequences and choices
+ * have KIDS, arrays have N values, in KIDS if complex */
+struct blpapi_Element {
+	const char *nam;
+	int dt;
+	bool arrp;
+	size_t n;
+	blpapi_Element_t **kids;
+	const double *f64;
+	const char *const *str;
+};
+
+/* floats are given as strings, they go through strtod() */
+#define F64(nm, x)						\
+	(&(blpapi_Element_t){					\
+		.nam = nm, .dt = BLPAPI_DATATYPE_FLOAT64, .n = 1U,	\
+		.f64 = (const double[]){strtod(x, NULL)}})
+#define STR(nm, x)						\
+	(&(blpapi_Element_t){					\
+		.nam = nm, .dt = BLPAPI_DATATYPE_STRING, .n = 1U,	\
+		.str = (const char *const[]){x}})
+#define SEQ(nm, nk, ...)					\
+	(&(blpapi_Element_t){					\
+		.nam = nm, .dt = BLPAPI_DATATYPE_SEQUENCE, .n = nk,	\
+		.kids = (blpapi_Element_t*[]){__VA_ARGS__}})
+#define CHC(nm, x)						\
+	(&(blpapi_Element_t){					\
+		.nam = nm, .dt = BLPAPI_DATATYPE_CHOICE, .n = 1U,	\
+		.kids = (blpapi_Element_t*[]){x}})
+#define ARR(nm, t, nk, ...)					\
+	(&(blpapi_Element_t){					\
+		.nam = nm, .dt = t, .arrp = true, .n = nk,		\
+		.kids = (blpapi_Element_t*[]){__VA_ARGS__}})
+
+int
+blpapi_Element_datatype(const blpapi_Element_t *e)
+{
+	return e->dt;
+}
+
+int
+blpapi_Element_isArray(const blpapi_Element_t *e)
+{
+	return e->arrp;
+}
+
+int
+blpapi_Element_isNull(const blpapi_Element_t *UNUSED(e))
+{
+	return 0;
+}
+
+const char*
+blpapi_Element_nameString(const blpapi_Element_t *e)
+{
+	return e->nam;
+}
+
+size_t
+blpapi_Element_numValues(const blpapi_Element_t *e)
+{
+	return e->arrp ? e->n : 1U;
+}
+
+size_t
+blpapi_Element_numElements(const blpapi_Element_t *e)
+{
+	return e->arrp ? 0U : e->n;
+}
+
+int
+blpapi_Element_getChoice(const blpapi_Element_t *e, blpapi_Element_t **r)
+{
+	if (e->dt != BLPAPI_DATATYPE_CHOICE || e->arrp) {
+		return -1;
+	}
+	*r = *e->kids;
+	return 0;
+}
+
+int
+blpapi_Element_getElementAt(
+	const blpapi_Element_t *e, blpapi_Element_t **r, size_t i)
+{
+	if (e->arrp || e->kids == NULL || i >= e->n) {
+		return -1;
+	}
+	*r = e->kids[i];
+	return 0;
+}
+
+int
+blpapi_Element_getValueAsElement(
+	const blpapi_Element_t *e, blpapi_Element_t **r, size_t i)
+{
+	if (!e->arrp || e->kids == NULL || i >= e->n) {
+		return -1;
+	}
+	*r = e->kids[i];
+	return 0;
+}
+
+int
+blpapi_Element_getValueAsFloat64(
+	const blpapi_Element_t *e, blpapi_Float64_t *r, size_t i)
+{
+	if (e->f64 == NULL || i >= blpapi_Element_numValues(e)) {
+		return -1;
+	}
+	*r = e->f64[i];
+	return 0;
+}
+
+int
+blpapi_Element_getValueAsString(
+	const blpapi_Element_t *e, const char **r, size_t i)
+{
+	if (e->str == NULL || i >= blpapi_Element_numValues(e)) {
+		return -1;
+	}
+	*r = e->str[i];
+	return 0;
+}
+
+
+static int rc;
+static FILE *tmp;
+
+static void
+check(struct ctx_s *ctx, const char *exp)
+{
+/* compare what CTX has written so far with EXP, start afresh */
+	static char buf[4096U];
+	size_t n;
+
+	obuf_flush(ctx->out);
+	rewind(tmp);
+	n = fread(buf, 1U, sizeof(buf) - 1U, tmp);
+	buf[n] = '\0';
+	if (strcmp(buf, exp)) {
+		fprintf(stderr, "expected\n%s\ngot\n%s\n", exp, buf);
+		rc = 1;
+	}
+	rewind(tmp);
+	if (ftruncate(fileno(tmp), 0) < 0) {
+		perror("cannot truncate");
+		rc = 1;
+	}
+	return;
+}
+
+int
+main(void)
+{
+	static char *flds[] = {"INDX_MWEIGHT"};
+	static struct ctx_s ctx = {.flds = {.v = flds, .n = 1U}};
+	const struct stmp_s st = {.buf = "T", .len = 1U};
+
+	if ((tmp = tmpfile()) == NULL ||
+	    (ctx.out = make_obuf(fileno(tmp), 4096U, 4U)) == NULL) {
+		perror("cannot set up output");
+		return 1;
+	}
+
+	/* a row per member, each spread over columns */
+	dump_bulk(&ctx, &st, "SPX Index", 0U,
+		  ARR("INDX_MWEIGHT", BLPAPI_DATATYPE_SEQUENCE, 2U,
+		      SEQ("", 2U, STR("Ticker", "AAPL UW"), F64("Weight", "7.5")),
+		      SEQ("", 2U, STR("Ticker", "MSFT UW"), F64("Weight", "6.25"))));
+	check(&ctx, "\
+T\tSPX Index\tINDX_MWEIGHT\tAAPL UW\t7.5\n\
+T\tSPX Index\tINDX_MWEIGHT\tMSFT UW\t6.25\n");
+
+	/* choices are printed nested, but each row has just its own */
+	dump_bulk(&ctx, &st, "SPX Index", 0U,
+		  ARR("INDX_MWEIGHT", BLPAPI_DATATYPE_CHOICE, 3U,
+		      CHC("", F64("Weight", "1")),
+		      CHC("", STR("Ticker", "MSFT UW")),
+		      CHC("", F64("Weight", "2.5"))));
+	check(&ctx, "\
+T\tSPX Index\tINDX_MWEIGHT\t{Weight=1}\n\
+T\tSPX Index\tINDX_MWEIGHT\t{Ticker=MSFT UW}\n\
+T\tSPX Index\tINDX_MWEIGHT\t{Weight=2.5}\n");
+
+	/* nested arrays of sequences in one go */
+	dump_Element(SEQ("t", 2U,
+			 ARR("a", BLPAPI_DATATYPE_SEQUENCE, 2U,
+			     SEQ("", 1U, F64("x", "1")),
+			     SEQ("", 1U, F64("x", "2"))),
+			 CHC("c", STR("s", "y"))), ctx.out);
+	obuf_putc(ctx.out, '\n');
+	obuf_rec(ctx.out);
+	check(&ctx, "{a=[{x=1},{x=2}],c={s=y}}\n");
+
+	free_obuf(ctx.out);
+	fclose(tmp);
+	return rc;
+}
+
+/* bulk-test.c ends here */
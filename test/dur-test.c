@@ -0,0 +1,79 @@
+/*** dur-test.c -- durations on the command line
+ *
+ * Copyright (C) 2013-2015 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of blpcli.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include "dur.c"
+
+int
+main(void)
+{
+	static const struct {
+		const char *in;
+		int64_t exp;
+	} tst[] = {
+		{"1ns", 1}, {"500us", 500000}, {"100ms", 100000000},
+		{"2s", 2000000000}, {"1min", 60000000000},
+		{"1h", 3600000000000}, {"1d", 86400000000000},
+		/* bare numbers are milliseconds */
+		{"5000", 5000000000},
+		{"9223372036854775807ns", INT64_MAX},
+		/* no good */
+		{"", -1}, {"s", -1}, {"0", -1}, {"0s", -1}, {"-1s", -1},
+		{"5x", -1}, {"5 s", -1}, {"5sec", -1}, {"1.5s", -1},
+		{"9223372036854775807s", -1}, {"106752d", -1},
+	};
+	int rc = 0;
+
+	for (size_t i = 0U; i < countof(tst); i++) {
+		const int64_t r = dur_strp(tst[i].in);
+
+		if (r != tst[i].exp) {
+			fprintf(stderr, "\
+`%s' gives %" PRId64 ", expected %" PRId64 "\n",
+				tst[i].in, r, tst[i].exp);
+			rc = 1;
+		}
+	}
+	return rc;
+}
+
+/* dur-test.c ends here */
@@ -0,0 +1,138 @@
+/*** fmt-bench.c -- fmt routines against fprintf
+ *
+ * Copyright (C) 2013-2015 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of blpcli.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include "fmt.c"
+
+/* values per run */
+#define NVAL	(1000000U)
+
+static double val[NVAL];
+static int64_t ival[NVAL];
+
+static uint64_t
+now(void)
+{
+	struct timespec tsp;
+
+	clock_gettime(CLOCK_MONOTONIC, &tsp);
+	return tsp.tv_sec * 1000000000ULL + tsp.tv_nsec;
+}
+
+static void
+prnt(const char *what, uint64_t fmt_ns, uint64_t prf_ns)
+{
+	printf("%-10s fmt %6.1fns  fprintf %6.1fns  per value\n", what,
+	       (double)fmt_ns / NVAL, (double)prf_ns / NVAL);
+	return;
+}
+
+int
+main(void)
+{
+	char buf[FMT_FLT_MAXLEN + 1U];
+	uint64_t s = 88172645463325252ULL;
+	uint64_t t0, t1, t2;
+	FILE *fp;
+
+	if ((fp = fopen("/dev/null", "w")) == NULL) {
+		perror("cannot open /dev/null");
+		return 1;
+	}
+	/* prices with 2 to 4 decimals and sizes, like bbg sends them */
+	for (size_t i = 0U; i < NVAL; i++) {
+		s ^= s << 13U;
+		s ^= s >> 7U;
+		s ^= s << 17U;
+		val[i] = (double)(s % 100000000U) / (i % 2U ? 100 : 10000);
+		ival[i] = (int64_t)(s >> 40U);
+	}
+
+	/* both write to the same stream so stdio costs are alike */
+	t0 = now();
+	for (size_t i = 0U; i < NVAL; i++) {
+		const size_t n = fmt_f64(buf, val[i]);
+
+		buf[n] = '\n';
+		fwrite(buf, 1U, n + 1U, fp);
+	}
+	t1 = now();
+	for (size_t i = 0U; i < NVAL; i++) {
+		fprintf(fp, "%.17g\n", val[i]);
+	}
+	t2 = now();
+	prnt("shortest", t1 - t0, t2 - t1);
+
+	t0 = now();
+	for (size_t i = 0U; i < NVAL; i++) {
+		const size_t n = fmt_f64_fixed(buf, val[i], 4U);
+
+		buf[n] = '\n';
+		fwrite(buf, 1U, n + 1U, fp);
+	}
+	t1 = now();
+	for (size_t i = 0U; i < NVAL; i++) {
+		fprintf(fp, "%.4f\n", val[i]);
+	}
+	t2 = now();
+	prnt("fixed", t1 - t0, t2 - t1);
+
+	t0 = now();
+	for (size_t i = 0U; i < NVAL; i++) {
+		const size_t n = fmt_i64(buf, ival[i]);
+
+		buf[n] = '\n';
+		fwrite(buf, 1U, n + 1U, fp);
+	}
+	t1 = now();
+	for (size_t i = 0U; i < NVAL; i++) {
+		fprintf(fp, "%lld\n", (long long int)ival[i]);
+	}
+	t2 = now();
+	prnt("integer", t1 - t0, t2 - t1);
+
+	fclose(fp);
+	return 0;
+}
+
+/* fmt-bench.c ends here */
@@ -0,0 +1,199 @@
+/*** fmt-test.c -- unit tests for the fmt module
+ *
+ * Copyright (C) 2013-2015 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of blpcli.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include "nifty.h"
+#include "fmt.c"
+
+static int rc;
+
+#define CHECK(buf, n, exp)						\
+	chk(__LINE__, buf, n, exp)
+
+static void
+chk(int ln, const char *buf, size_t n, const char *exp)
+{
+	if (n != strlen(exp) || memcmp(buf, exp, n)) {
+		fprintf(stderr, "line %d: got `%.*s', expected `%s'\n",
+			ln, (int)n, buf, exp);
+		rc = 1;
+	}
+	return;
+}
+
+static void
+test_int(void)
+{
+	char buf[FMT_INT_MAXLEN];
+
+	CHECK(buf, fmt_u64(buf, 0U), "0");
+	CHECK(buf, fmt_u64(buf, 9U), "9");
+	CHECK(buf, fmt_u64(buf, 10U), "10");
+	CHECK(buf, fmt_u64(buf, 1234567890U), "1234567890");
+	CHECK(buf, fmt_u64(buf, UINT64_MAX), "18446744073709551615");
+	CHECK(buf, fmt_i64(buf, -1), "-1");
+	CHECK(buf, fmt_i64(buf, 42), "42");
+	CHECK(buf, fmt_i64(buf, INT64_MAX), "9223372036854775807");
+	CHECK(buf, fmt_i64(buf, INT64_MIN), "-9223372036854775808");
+	CHECK(buf, fmt_u32_pad(buf, 7U, 3U), "007");
+	CHECK(buf, fmt_u32_pad(buf, 2026U, 4U), "2026");
+	CHECK(buf, fmt_u32_pad(buf, 5U, 9U), "000000005");
+	CHECK(buf, fmt_u32_pad(buf, 123456789U, 9U), "123456789");
+
+	/* every power of 10 and its neighbours */
+	for (uint64_t x = 1U; x <= UINT64_MAX / 10U; x *= 10U) {
+		for (uint64_t y = x - 1U; y <= x + 1U; y++) {
+			char exp[32U];
+
+			snprintf(exp, sizeof(exp), "%llu", (unsigned long long)y);
+			CHECK(buf, fmt_u64(buf, y), exp);
+		}
+	}
+	return;
+}
+
+static void
+test_flt(void)
+{
+/* inputs go through strtod() so they can be written as is */
+	static const struct {
+		const char *in;
+		const char *exp;
+	} f64[] = {
+		{"0", "0"}, {"-0", "-0"}, {"1", "1"}, {"100", "100"},
+		{"0.1", "0.1"}, {"1.25", "1.25"}, {"-12.5", "-12.5"},
+		{"0.000001", "0.000001"}, {"1e-7", "1e-7"}, {"1e21", "1e21"},
+		{"123456789012345680000", "123456789012345680000"},
+		{"5e-324", "5e-324"}, {"1.7976931348623157e308", "1.7976931348623157e308"},
+		{"inf", "inf"}, {"-inf", "-inf"}, {"nan", "nan"},
+	}, f32[] = {
+		{"0.1", "0.1"}, {"3.5", "3.5"}, {"-inf", "-inf"},
+		{"16777216", "16777216"}, {"1e-45", "1e-45"},
+	};
+	static const struct {
+		const char *in;
+		unsigned int prec;
+		const char *exp;
+	} fix[] = {
+		{"3.14159", 2U, "3.14"}, {"2.5", 0U, "3"},
+		{"-0.125", 2U, "-0.13"}, {"1", 9U, "1.000000000"},
+		{"0.05", 1U, "0.1"}, {"42", 12U, "42.000000000"},
+		{"1e20", 2U, "100000000000000000000"}, {"nan", 2U, "nan"},
+		/* rounds to zero, no sign then */
+		{"-0.001", 2U, "0.00"}, {"-0.4", 0U, "0"}, {"-0.005", 2U, "-0.01"},
+	};
+	char buf[FMT_FLT_MAXLEN];
+
+	for (size_t i = 0U; i < countof(f64); i++) {
+		const double x = strtod(f64[i].in, NULL);
+
+		CHECK(buf, fmt_f64(buf, x), f64[i].exp);
+	}
+	for (size_t i = 0U; i < countof(f32); i++) {
+		const float x = strtof(f32[i].in, NULL);
+
+		CHECK(buf, fmt_f32(buf, x), f32[i].exp);
+	}
+	for (size_t i = 0U; i < countof(fix); i++) {
+		const double x = strtod(fix[i].in, NULL);
+
+		CHECK(buf, fmt_f64_fixed(buf, x, fix[i].prec), fix[i].exp);
+	}
+	return;
+}
+
+static void
+test_trip(void)
+{
+/* random bit patterns must read back as themselves */
+	char buf[FMT_FLT_MAXLEN + 1U];
+	uint64_t s = 88172645463325252ULL;
+
+	for (size_t i = 0U; i < 1000000U; i++) {
+		uint64_t u;
+		uint32_t v;
+		double x, y;
+		float f, g;
+		size_t n;
+
+		/* xorshift64 */
+		s ^= s << 13U;
+		s ^= s >> 7U;
+		s ^= s << 17U;
+
+		u = s;
+		memcpy(&x, &u, sizeof(x));
+		if (isfinite(x)) {
+			n = fmt_f64(buf, x);
+			buf[n] = '\0';
+			if ((y = strtod(buf, NULL)) != x) {
+				fprintf(stderr, "%a printed as %s reads %a\n",
+					x, buf, y);
+				rc = 1;
+			}
+		}
+		v = (uint32_t)(s >> 32U);
+		memcpy(&f, &v, sizeof(f));
+		if (isfinite(f)) {
+			n = fmt_f32(buf, f);
+			buf[n] = '\0';
+			if ((g = strtof(buf, NULL)) != f) {
+				fprintf(stderr, "%a printed as %s reads %a\n",
+					(double)f, buf, (double)g);
+				rc = 1;
+			}
+		}
+	}
+	return;
+}
+
+int
+main(void)
+{
+	test_int();
+	test_flt();
+	test_trip();
+	return rc;
+}
+
+/* fmt-test.c ends here */
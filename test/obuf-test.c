@@ -0,0 +1,146 @@
+/*** obuf-test.c -- round trips through output buffers
+ *
+ * Copyright (C) 2013-2015 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of blpcli.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include "obuf.c"
+
+/* small chunks so records move between chunks and flushes early */
+#define CHNZ	(64U)
+#define NCHN	(4U)
+
+static int rc;
+
+static void
+fail(const char *msg)
+{
+	fprintf(stderr, "%s\n", msg);
+	rc = 1;
+	return;
+}
+
+int
+main(void)
+{
+	/* every writev(2) arrives as one datagram */
+	static char exp[65536U];
+	static char got[65536U];
+	size_t nexp = 0U;
+	size_t ngot = 0U;
+	int sv[2U];
+	obuf_t ob;
+
+	signal(SIGPIPE, SIG_IGN);
+	if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sv) < 0) {
+		perror("cannot create socket pair");
+		return 1;
+	} else if ((ob = make_obuf(sv[0U], CHNZ, NCHN)) == NULL) {
+		perror("cannot make output buffer");
+		return 1;
+	}
+
+	/* records of 1 to 99 bytes, the larger ones exceed a chunk */
+	for (size_t i = 0U; i < 200U; i++) {
+		const size_t len = 1U + (i * 37U) % 99U;
+		char *p = exp + nexp;
+
+		for (size_t j = 0U; j + 1U < len; j++) {
+			p[j] = (char)('a' + (i + j) % 26U);
+		}
+		p[len - 1U] = '\n';
+		nexp += len;
+
+		/* in two goes, as callers do */
+		obuf_write(ob, p, len / 2U);
+		obuf_write(ob, p + len / 2U, len - 1U - len / 2U);
+		obuf_putc(ob, '\n');
+		obuf_rec(ob);
+		if (i % 50U == 49U) {
+			obuf_printf(ob, "rec %zu\n", i);
+			obuf_undo(ob);
+		}
+	}
+	if (obuf_flush(ob) < 0) {
+		fail("flush failed");
+	}
+	if (ob->st.nrec != 200U || ob->st.nbyt != nexp) {
+		fail("wrong record or byte count");
+	}
+
+	/* whole records per write, unless they're bigger than a chunk */
+	for (ssize_t n; ngot < nexp; ngot += n) {
+		char *p = got + ngot;
+
+		if ((n = recv(sv[1U], p, sizeof(got) - ngot, 0)) <= 0) {
+			fail("short read");
+			break;
+		} else if (exp[ngot + n - 1] != '\n') {
+			/* find the record we're in */
+			size_t b = ngot + n, e = ngot + n;
+
+			for (; b > 0U && exp[b - 1U] != '\n'; b--);
+			for (; exp[e] != '\n'; e++);
+			if (e + 1U - b <= CHNZ) {
+				fail("record split across writes");
+			}
+		}
+	}
+	if (ngot != nexp || memcmp(got, exp, nexp)) {
+		fail("output differs from input");
+	}
+
+	/* errors stick */
+	close(sv[1U]);
+	obuf_write(ob, "x\n", 2U);
+	obuf_rec(ob);
+	if (obuf_flush(ob) >= 0 || ob->err != EPIPE) {
+		fail("write error not reported");
+	}
+
+	free_obuf(ob);
+	close(sv[0U]);
+	return rc;
+}
+
+/* obuf-test.c ends here */
@@ -0,0 +1,213 @@
+/*** rcache-test.c -- round trips through reference data caches
+ *
+ * Copyright (C) 2013-2015 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of blpcli.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "rcache.c"
+
+/* securities we make up, more than fit a fresh cache */
+#define NSEC	(20000U)
+
+static int rc;
+static char fn[64U];
+
+static void
+fail(const char *msg)
+{
+	fprintf(stderr, "%s\n", msg);
+	rc = 1;
+	return;
+}
+
+static void
+mkval(struct rcache_val_s *v, char *buf, size_t bsz, size_t i)
+{
+	memset(v, 0, sizeof(*v));
+	v->fetched = i;
+	if (i % 2U) {
+		v->vt = BIN_VT_I64;
+		v->v.i64 = (int64_t)i * 3;
+	} else {
+		v->vt = BIN_VT_STR;
+		v->v.str.len = snprintf(buf, bsz, "value of %zu", i);
+		v->v.str.s = buf;
+	}
+	return;
+}
+
+static int
+eqvalp(const struct rcache_val_s *v, const struct rcache_val_s *w)
+{
+	if (v->fetched != w->fetched || v->vt != w->vt) {
+		return 0;
+	} else if (v->vt == BIN_VT_I64) {
+		return v->v.i64 == w->v.i64;
+	}
+	return v->v.str.len == w->v.str.len &&
+		!memcmp(v->v.str.s, w->v.str.s, v->v.str.len);
+}
+
+static void
+check(rcache_t c, size_t n)
+{
+	char sec[32U], buf[32U];
+	size_t nbad = 0U;
+
+	if (rcache_size(c) != n) {
+		fprintf(stderr, "%zu entries, expected %zu\n",
+			rcache_size(c), n);
+		rc = 1;
+	}
+	for (size_t i = 0U; i < n; i++) {
+		struct rcache_val_s v, w;
+
+		snprintf(sec, sizeof(sec), "SEC%zu Equity", i);
+		mkval(&v, buf, sizeof(buf), i);
+		nbad += rcache_get(c, sec, "PX_LAST", NULL, &w) < 0 ||
+			!eqvalp(&v, &w);
+	}
+	if (nbad) {
+		fprintf(stderr, "%zu entries differ\n", nbad);
+		rc = 1;
+	}
+	return;
+}
+
+int
+main(void)
+{
+	char sec[32U], buf[32U];
+	struct rcache_val_s v;
+	struct stat st;
+	rcache_t c;
+
+	snprintf(fn, sizeof(fn), "rcache-test.%ld.cache", (long)getpid());
+	unlink(fn);
+	if ((c = make_rcache(fn)) == NULL) {
+		perror("cannot make cache");
+		return 1;
+	}
+	/* it's ours now */
+	if (make_rcache(fn) != NULL || errno != EWOULDBLOCK) {
+		fail("cache opened twice");
+	}
+	/* fill beyond the initial slots so it has to grow */
+	for (size_t i = 0U; i < NSEC; i++) {
+		snprintf(sec, sizeof(sec), "SEC%zu Equity", i);
+		mkval(&v, buf, sizeof(buf), i);
+		if (rcache_put(c, sec, "PX_LAST", NULL, &v) < 0) {
+			fail("cannot put");
+			break;
+		}
+	}
+	check(c, NSEC);
+	/* keys differ by field and overrides, NULL and "" are the same */
+	if (rcache_get(c, "SEC1 Equity", "PX_LAS", NULL, &v) >= 0) {
+		fail("field prefix found");
+	} else if (rcache_get(c, "SEC1 Equity", "PX_LAST", "X=1", &v) >= 0) {
+		fail("overrides ignored");
+	} else if (rcache_get(c, "SEC1 Equity", "PX_LAST", "", &v) < 0) {
+		fail("empty overrides differ from none");
+	}
+	free_rcache(c);
+
+	/* everything's still there after reopening */
+	if ((c = make_rcache(fn)) == NULL) {
+		perror("cannot reopen cache");
+		return 1;
+	}
+	check(c, NSEC);
+	free_rcache(c);
+
+	/* replacing values over and over must not grow the file */
+	unlink(fn);
+	if ((c = make_rcache(fn)) == NULL) {
+		perror("cannot make cache");
+		return 1;
+	}
+	with (char big[1000U]) {
+		memset(big, 'x', sizeof(big));
+		v = (struct rcache_val_s){.vt = BIN_VT_STR};
+		v.v.str.s = big;
+		v.v.str.len = sizeof(big);
+		for (size_t i = 0U; i < 10000U; i++) {
+			snprintf(sec, sizeof(sec), "SEC%zu Equity", i % 100U);
+			v.fetched = i;
+			if (rcache_put(c, sec, "NAME", NULL, &v) < 0) {
+				fail("cannot replace");
+				break;
+			}
+		}
+	}
+	if (rcache_size(c) != 100U) {
+		fail("replacing added entries");
+	}
+	free_rcache(c);
+	if (stat(fn, &st) < 0) {
+		perror("cannot stat cache");
+		rc = 1;
+	} else if ((size_t)st.st_size > rc_size(RC_NSLOT, RC_HEAPZ)) {
+		fprintf(stderr, "cache grew to %jd bytes\n",
+			(intmax_t)st.st_size);
+		rc = 1;
+	}
+
+	/* garbage is discarded, not trusted */
+	with (FILE *f = fopen(fn, "w")) {
+		if (f == NULL) {
+			perror("cannot overwrite cache");
+			return 1;
+		}
+		for (size_t i = 0U; i < 1000U; i++) {
+			fputs("garbage", f);
+		}
+		fclose(f);
+	}
+	if ((c = make_rcache(fn)) == NULL) {
+		fail("cannot open garbage");
+	} else {
+		check(c, 0U);
+		free_rcache(c);
+	}
+	unlink(fn);
+	return rc;
+}
+
+/* rcache-test.c ends here */
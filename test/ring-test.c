@@ -0,0 +1,170 @@
+/*** ring-test.c -- round trips through SPSC rings
+ *
+ * Copyright (C) 2013-2015 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of blpcli.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <sched.h>
+#include "ring.c"
+
+/* records the producer thread pushes */
+#define NREC	(100000U)
+
+struct rec_s {
+	uint64_t seq;
+	uint64_t chk;
+};
+
+static int rc;
+
+static void
+fail(const char *msg)
+{
+	fprintf(stderr, "%s\n", msg);
+	rc = 1;
+	return;
+}
+
+static void*
+prod(void *arg)
+{
+	ring_t r = arg;
+
+	for (uint64_t i = 0U; i < NREC; i++) {
+		struct rec_s *p;
+
+		/* wait rather than lose records */
+		while ((p = ring_prep(r)) == NULL) {
+			sched_yield();
+		}
+		p->seq = i;
+		p->chk = ~i;
+		ring_push(r);
+	}
+	return NULL;
+}
+
+static void
+test_single(void)
+{
+/* fill, overfill and drain across the wrap-around */
+	ring_t r;
+
+	if ((r = make_ring(5U, sizeof(struct rec_s))) == NULL) {
+		fail("cannot make ring");
+		return;
+	} else if (r->mask + 1U != 8U) {
+		fail("slots not rounded up to a power of 2");
+	}
+	for (uint64_t k = 0U, n = 0U; k < 3U; k++) {
+		for (size_t i = 0U; i < 10U; i++) {
+			struct rec_s *p = ring_prep(r);
+
+			if (i < 8U && p == NULL) {
+				fail("ring full too early");
+			} else if (i >= 8U && p != NULL) {
+				fail("ring takes more than it has room for");
+			} else if (p != NULL) {
+				p->seq = n + i;
+				ring_push(r);
+			}
+		}
+		if (ring_fill(r) != 8U) {
+			fail("wrong fill level");
+		}
+		for (const struct rec_s *p; (p = ring_peek(r)) != NULL; n++) {
+			if (p->seq != n) {
+				fail("records out of order");
+			}
+			ring_pop(r);
+		}
+	}
+	if (r->st.npush != 24U || r->st.ndrop != 6U || r->st.hiwat != 8U) {
+		fail("wrong statistics");
+	}
+	free_ring(r);
+	return;
+}
+
+static void
+test_threads(void)
+{
+	uint64_t n = 0U;
+	pthread_t t;
+	ring_t r;
+
+	if ((r = make_ring(1024U, sizeof(struct rec_s))) == NULL) {
+		fail("cannot make ring");
+		return;
+	} else if (pthread_create(&t, NULL, prod, r)) {
+		fail("cannot start producer");
+		free_ring(r);
+		return;
+	}
+	while (n < NREC) {
+		const struct rec_s *p;
+
+		if ((p = ring_peek(r)) == NULL) {
+			sched_yield();
+			continue;
+		} else if (p->seq != n || p->chk != ~n) {
+			fail("record torn or out of order");
+			break;
+		}
+		ring_pop(r);
+		n++;
+	}
+	pthread_join(t, NULL);
+	if (r->st.npush != NREC) {
+		fail("wrong number of records pushed");
+	}
+	free_ring(r);
+	return;
+}
+
+int
+main(void)
+{
+	test_single();
+	test_threads();
+	return rc;
+}
+
+/* ring-test.c ends here */
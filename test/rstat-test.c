@@ -0,0 +1,162 @@
+/*** rstat-test.c -- statistics lines and the statistics socket
+ *
+ * Copyright (C) 2013-2015 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of blpcli.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "rstat.c"
+#include "hist.c"
+#include "fmt.c"
+#include "clk.c"
+
+static int rc;
+
+static void
+fail(const char *msg)
+{
+	fprintf(stderr, "%s\n", msg);
+	rc = 1;
+	return;
+}
+
+static const char*
+kv(const char *buf, const char *key)
+{
+/* return the value of KEY in BUF's KEY=VALUE pairs, or NULL */
+	const size_t z = strlen(key);
+
+	for (const char *p = buf; (p = strstr(p, key)) != NULL; p += z) {
+		if ((p == buf || p[-1] == ' ') && p[z] == '=') {
+			return p + z + 1U;
+		}
+	}
+	return NULL;
+}
+
+int
+main(void)
+{
+	char fn[64U];
+	char buf[4096U];
+	int s;
+
+	/* rates are per second */
+	with (struct rstat_s cur = {.nmsg = 3000U, .nbyt = 1000U},
+	      prev = {.nmsg = 1000U}) {
+		const char *v;
+
+		rstat_prnt(buf, sizeof(buf), &cur, &prev, 500000000U);
+		if ((v = kv(buf, "msg")) == NULL ||
+		    strtoull(v, NULL, 10) != 3000U) {
+			fail("message count wrong");
+		}
+		if ((v = kv(buf, "msg_rate")) == NULL ||
+		    strtod(v, NULL) != strtod("4000", NULL)) {
+			fail("message rate wrong");
+		}
+		if ((v = kv(buf, "byte_rate")) == NULL ||
+		    strtod(v, NULL) != strtod("2000", NULL)) {
+			fail("byte rate wrong");
+		}
+		/* no time, no rates */
+		rstat_prnt(buf, sizeof(buf), &cur, &prev, 0U);
+		if ((v = kv(buf, "msg_rate")) == NULL ||
+		    strtod(v, NULL) != 0) {
+			fail("rate without time");
+		}
+	}
+	/* lines are cut, not overrun */
+	with (struct rstat_s cur = {.nmsg = 1U}) {
+		const size_t n = rstat_prnt(buf, 16U, &cur, &cur, 1U);
+
+		if (n != 15U || strlen(buf) != 15U) {
+			fail("line not cut to size");
+		}
+	}
+
+	/* only sockets are replaced */
+	snprintf(fn, sizeof(fn), "rstat-test.%ld.sock", (long)getpid());
+	unlink(fn);
+	with (FILE *f = fopen(fn, "w")) {
+		if (f == NULL) {
+			perror("cannot create file");
+			return 1;
+		}
+		fclose(f);
+	}
+	if ((s = rstat_listen(fn)) >= 0 || errno != ENOTSOCK) {
+		fail("regular file replaced");
+	} else if (access(fn, F_OK) < 0) {
+		fail("regular file removed");
+	}
+	unlink(fn);
+	if ((s = rstat_listen(fn)) < 0) {
+		perror("cannot listen");
+		return 1;
+	}
+	close(s);
+	/* the socket's still there, a stale one */
+	if ((s = rstat_listen(fn)) < 0) {
+		fail("stale socket not replaced");
+	} else {
+		close(s);
+	}
+	unlink(fn);
+
+	/* writes to a peer that's gone fail rather than kill us */
+	with (int sv[2U]) {
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+			perror("cannot make socket pair");
+			return 1;
+		}
+		if (rstat_write(sv[0U], "stats\n", 6U) < 0) {
+			fail("write failed");
+		}
+		close(sv[1U]);
+		/* as rstat_loop() does */
+		signal(SIGPIPE, SIG_IGN);
+		if (rstat_write(sv[0U], "stats\n", 6U) >= 0) {
+			fail("write to closed peer succeeded");
+		}
+		close(sv[0U]);
+	}
+	return rc;
+}
+
+/* rstat-test.c ends here */
@@ -0,0 +1,166 @@
+/*** sopt-test.c -- parsing of session options
+ *
+ * Copyright (C) 2013-2015 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of blpcli.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "sopt.c"
+
+static int rc;
+
+static void
+fail(const char *msg)
+{
+	fprintf(stderr, "%s\n", msg);
+	rc = 1;
+	return;
+}
+
+static void
+test_srv(void)
+{
+	static const struct {
+		const char *in;
+		const char *host;
+		unsigned short int port;
+	} ok[] = {
+		{"bbg1", "bbg1", SOPT_PORT},
+		{"bbg1:8195", "bbg1", 8195U},
+		{"10.0.0.1:1", "10.0.0.1", 1U},
+		{"[::1]:8196", "::1", 8196U},
+		{"[fe80::1]", "fe80::1", SOPT_PORT},
+	};
+	static const char *const bad[] = {
+		"", ":8194", "bbg1:", "bbg1:0", "bbg1:65536", "bbg1:81x",
+		"[::1", "[::1]x", "[]:8194",
+	};
+	char *srv[countof(ok)];
+	struct sopt_s so;
+
+	for (size_t i = 0U; i < countof(ok); i++) {
+		srv[i] = strdup(ok[i].in);
+	}
+	if (sopt_init(&so, srv, countof(ok)) < 0) {
+		fail("cannot parse good server specs");
+	} else if (so.nsrv != countof(ok)) {
+		fail("wrong number of servers");
+	}
+	for (size_t i = 0U; i < so.nsrv; i++) {
+		if (strcmp(so.srv[i].host, ok[i].host) ||
+		    so.srv[i].port != ok[i].port) {
+			fprintf(stderr, "`%s' parses as %s port %hu\n",
+				ok[i].in, so.srv[i].host, so.srv[i].port);
+			rc = 1;
+		}
+	}
+	sopt_fini(&so);
+	for (size_t i = 0U; i < countof(ok); i++) {
+		free(srv[i]);
+	}
+
+	for (size_t i = 0U; i < countof(bad); i++) {
+		char *s = strdup(bad[i]);
+
+		if (sopt_init(&so, &s, 1U) >= 0) {
+			fprintf(stderr, "`%s' parses\n", bad[i]);
+			rc = 1;
+		}
+		sopt_fini(&so);
+		free(s);
+	}
+
+	/* defaults */
+	if (sopt_init(&so, NULL, 0U) < 0 || so.nsrv != 1U ||
+	    strcmp(so.srv->host, "localhost") || so.srv->port != SOPT_PORT ||
+	    so.qz != SOPT_QZ || so.tmo != SOPT_TMO ||
+	    so.hiwat != SOPT_HIWAT || so.lowat != SOPT_LOWAT) {
+		fail("wrong defaults");
+	}
+	sopt_fini(&so);
+	return;
+}
+
+static void
+test_qst(void)
+{
+	struct sopt_qst_s q = {0U};
+	char buf[256U];
+	FILE *fp;
+
+	if (sopt_qhip(&q) || !sopt_qhi(&q, 1000U) || sopt_qhi(&q, 2000U) ||
+	    !sopt_qhip(&q)) {
+		fail("going above the mark");
+	}
+	if (!sopt_qlo(&q, 1500001000U) || sopt_qlo(&q, 1600000000U) ||
+	    sopt_qhip(&q)) {
+		fail("going below the mark");
+	}
+	if (q.nhi != 1U || q.thi != 1500000000U) {
+		fail("wrong queue statistics");
+	}
+
+	/* statistics go to stderr */
+	if ((fp = tmpfile()) == NULL) {
+		fail("cannot create temporary file");
+		return;
+	}
+	with (FILE *save = stderr) {
+		stderr = fp;
+		sopt_qprnt(&q, 2U);
+		stderr = save;
+	}
+	rewind(fp);
+	if (fgets(buf, sizeof(buf), fp) == NULL ||
+	    strstr(buf, "session 2: 1 times above high-water mark, "
+		   "1.500s altogether") == NULL) {
+		fail("wrong queue statistics line");
+	}
+	fclose(fp);
+	return;
+}
+
+int
+main(void)
+{
+	test_srv();
+	test_qst();
+	return rc;
+}
+
+/* sopt-test.c ends here */
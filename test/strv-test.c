@@ -0,0 +1,153 @@
+/*** strv-test.c -- round trips through string vectors
+ *
+ * Copyright (C) 2013-2015 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of blpcli.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include "strv.c"
+
+static int rc;
+
+static void
+fail(const char *msg)
+{
+	fprintf(stderr, "%s\n", msg);
+	rc = 1;
+	return;
+}
+
+static void
+test_load(size_t fz)
+{
+/* a file of FZ bytes, page-sized ones can't be mapped and get read */
+	static const char *const top[] = {
+		"IBM US Equity", "VOD LN Equity", "EUR Curncy",
+	};
+	const size_t pgsz = sysconf(_SC_PAGESIZE);
+	char fn[] = "strv-test.XXXXXX";
+	struct strv_s sv = {0U};
+	char *buf;
+	size_t n = 0U;
+	int fd;
+
+	if ((fd = mkstemp(fn)) < 0) {
+		perror("cannot create temporary file");
+		rc = 1;
+		return;
+	} else if ((buf = malloc(fz)) == NULL) {
+		close(fd);
+		unlink(fn);
+		rc = 1;
+		return;
+	}
+	/* unix and dos lines, empty ones in between, pad with the
+	 * last topic and leave off the final newline */
+	for (size_t i = 0U; n + 64U < fz; i++) {
+		const char *t = top[i % countof(top)];
+
+		n += sprintf(buf + n, i % 2U ? "%s\r\n\n" : "%s\n", t);
+	}
+	memcpy(buf + n, top[0U], strlen(top[0U]));
+	n += strlen(top[0U]);
+	memset(buf + n, 'x', fz - n);
+	if (write(fd, buf, fz) != (ssize_t)fz) {
+		fail("cannot write temporary file");
+	}
+	close(fd);
+
+	if (strv_load(&sv, fn) < 0) {
+		fail("cannot load file");
+	} else if (strv_load(&sv, fn) >= 0 || errno != EEXIST) {
+		fail("second load into the same vector succeeded");
+	}
+	for (size_t i = 0U; i + 1U < sv.n; i++) {
+		if (strcmp(sv.v[i], top[i % countof(top)])) {
+			fprintf(stderr, "line %zu is `%s'\n", i, sv.v[i]);
+			rc = 1;
+		}
+	}
+	if (!sv.n || strncmp(sv.v[sv.n - 1U], top[0U], strlen(top[0U]))) {
+		fail("last line without newline missing");
+	}
+	if (sv.arent != (fz % pgsz ? STRV_ARENA_MMAP : STRV_ARENA_HEAP)) {
+		fail("unexpected arena");
+	}
+	strv_free(&sv);
+	free(buf);
+	unlink(fn);
+	return;
+}
+
+int
+main(void)
+{
+	static char *argv[] = {"a", "b", "c"};
+	struct strv_s sv = {0U};
+
+	/* strings are not copied */
+	if (strv_add(&sv, argv[0U]) < 0 ||
+	    strv_addv(&sv, argv + 1U, 2U) < 0) {
+		fail("cannot add strings");
+	} else if (sv.n != 3U || sv.v[0U] != argv[0U] || sv.v[2U] != argv[2U]) {
+		fail("strings differ");
+	}
+	/* reserved room doesn't move the index */
+	if (strv_resv(&sv, 1000U) < 0) {
+		fail("cannot reserve");
+	}
+	with (char **v = sv.v) {
+		for (size_t i = 0U; i < 1000U; i++) {
+			strv_add(&sv, argv[i % 3U]);
+		}
+		if (sv.v != v || sv.n != 1003U) {
+			fail("index moved despite reservation");
+		}
+	}
+	strv_free(&sv);
+
+	with (const size_t pgsz = sysconf(_SC_PAGESIZE)) {
+		test_load(pgsz + 1000U);
+		test_load(pgsz);
+	}
+	return rc;
+}
+
+/* strv-test.c ends here */
@@ -0,0 +1,186 @@
+/*** tcol-test.c -- round trips through tick files
+ *
+ * Copyright (C) 2013-2015 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of blpcli.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include "tcol.c"
+
+/* ticks per block and in total */
+#define CAP	(16U)
+#define NTICK	(100U)
+
+static int rc;
+
+static void
+fail(const char *msg)
+{
+	fprintf(stderr, "%s\n", msg);
+	rc = 1;
+	return;
+}
+
+static const char*
+tick_cc(size_t i)
+{
+	static const char *const cc[] = {
+		NULL, "R6", "", "IS,OR", "a condition code of some length",
+	};
+	return cc[i % countof(cc)];
+}
+
+int
+main(void)
+{
+	static const char sec[] = "VOD LN Equity";
+	static char ALGN(buf[65536U], 8U);
+	char fn[] = "tcol-test.XXXXXX";
+	const char *bp, *ep;
+	size_t ntick = 0U;
+	ssize_t z;
+	tcol_t tc;
+	int fd;
+
+	if ((fd = mkstemp(fn)) < 0) {
+		perror("cannot create temporary file");
+		return 1;
+	}
+	close(fd);
+	if ((tc = make_tcol(CAP)) == NULL) {
+		perror("cannot make tick buffer");
+		unlink(fn);
+		return 1;
+	} else if (tcol_open(tc, fn, sec, 20000) < 0) {
+		fail("cannot open tick file");
+	}
+	for (size_t i = 0U; i < NTICK; i++) {
+		const tcol_tt_t tt = (tcol_tt_t)(1U + i % (NTCOL_TT - 1U));
+
+		if (tcol_add(tc, 1000000000LL * i, tt, (double)i / 4,
+			     i * 100U, tick_cc(i)) < 0) {
+			fail("cannot add tick");
+		}
+	}
+	if (tcol_close(tc) < 0) {
+		fail("cannot close tick file");
+	} else if (tc->ntot != NTICK) {
+		fail("wrong number of ticks written");
+	}
+	free_tcol(tc);
+
+	if ((fd = open(fn, O_RDONLY)) < 0 ||
+	    (z = read(fd, buf, sizeof(buf))) <= 0) {
+		perror("cannot read tick file back");
+		unlink(fn);
+		return 1;
+	}
+	close(fd);
+	unlink(fn);
+
+	/* header and name */
+	with (const struct tcol_hdr_s *h = (const void*)buf) {
+		if (memcmp(h->magic, TCOL_MAGIC, sizeof(h->magic)) ||
+		    h->ver != TCOL_VERSION || h->day != 20000 ||
+		    h->len != strlenof(sec) ||
+		    memcmp(h + 1U, sec, strlenof(sec))) {
+			fail("bad header");
+			return rc;
+		}
+	}
+	bp = buf + sizeof(struct tcol_hdr_s) + (strlenof(sec) + 7U) / 8U * 8U;
+	ep = buf + z;
+
+	/* blocks of columns */
+	for (const struct tcol_blk_s *b; bp < ep; bp += b->len) {
+		const int64_t *tim;
+		const double *val;
+		const int64_t *siz;
+		const uint32_t *cend;
+		const uint8_t *typ;
+		const char *heap;
+
+		b = (const void*)bp;
+		if (!b->len || b->len % 8U || bp + b->len > ep) {
+			fail("bad block length");
+			break;
+		}
+		tim = (const void*)(b + 1U);
+		val = (const void*)(tim + b->ntick);
+		siz = (const void*)(val + b->ntick);
+		cend = (const void*)(siz + b->ntick);
+		typ = (const void*)(cend + b->ntick);
+		heap = (const void*)(typ + b->ntick);
+
+		for (size_t j = 0U; j < b->ntick; j++, ntick++) {
+			const size_t i = ntick;
+			const char *cc = tick_cc(i);
+			const uint32_t beg = j ? cend[j - 1U] : 0U;
+
+			if (tim[j] != 1000000000LL * (int64_t)i ||
+			    val[j] != (double)i / 4 ||
+			    siz[j] != (int64_t)i * 100 ||
+			    typ[j] != 1U + i % (NTCOL_TT - 1U)) {
+				fprintf(stderr, "tick %zu differs\n", i);
+				rc = 1;
+			} else if (cend[j] - beg != (cc ? strlen(cc) : 0U) ||
+				   (cc && memcmp(heap + beg, cc, strlen(cc)))) {
+				fprintf(stderr, "tick %zu codes differ\n", i);
+				rc = 1;
+			}
+		}
+		if (b->heapz != (b->ntick ? cend[b->ntick - 1U] : 0U)) {
+			fail("heap size differs from last code end");
+		}
+	}
+	if (ntick != NTICK) {
+		fail("wrong number of ticks read back");
+	}
+
+	/* tick types by name */
+	if (tcol_tt("TRADE") != TCOL_TT_TRADE ||
+	    tcol_tt("SETTLE") != TCOL_TT_SETTLE ||
+	    tcol_tt("TRADES") != TCOL_TT_UNK) {
+		fail("tick type names");
+	}
+	return rc;
+}
+
+/* tcol-test.c ends here */
@@ -0,0 +1,114 @@
+/*** topt-test.c -- per-topic subscription options
+ *
+ * Copyright (C) 2013-2015 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of blpcli.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "topt.c"
+#include "nifty.h"
+
+static int rc;
+
+static void
+fail(const char *msg)
+{
+	fprintf(stderr, "%s\n", msg);
+	rc = 1;
+	return;
+}
+
+int
+main(void)
+{
+	const char *opts[8U];
+	size_t n;
+
+	with (char top[] = "IBM US Equity|interval=1,fields=BID") {
+		const char *o = topt_split(top);
+
+		if (strcmp(top, "IBM US Equity")) {
+			fail("topic not split off");
+		} else if (o == NULL || strcmp(o, "interval=1,fields=BID")) {
+			fail("options not split off");
+		}
+	}
+	with (char top[] = "IBM US Equity\tinterval=1") {
+		const char *o = topt_split(top);
+
+		if (strcmp(top, "IBM US Equity") ||
+		    o == NULL || strcmp(o, "interval=1")) {
+			fail("tab not taken as separator");
+		}
+	}
+	with (char top[] = "IBM US Equity|") {
+		if (topt_split(top) != NULL || strcmp(top, "IBM US Equity")) {
+			fail("empty options not dropped");
+		}
+	}
+	with (char top[] = "IBM US Equity") {
+		if (topt_split(top) != NULL) {
+			fail("options without separator");
+		}
+	}
+
+	/* later options replace earlier ones of the same key */
+	with (char g[] = "interval=1,delayed", t[] = "interval=5,conflate") {
+		n = topt_add(opts, 0U, g);
+		n = topt_add(opts, n, t);
+		if (n != 3U) {
+			fprintf(stderr, "%zu options, expected 3\n", n);
+			rc = 1;
+		} else if (strcmp(opts[0U], "interval=5") ||
+			   strcmp(opts[1U], "delayed") ||
+			   strcmp(opts[2U], "conflate")) {
+			fail("options not merged");
+		}
+	}
+	/* keys are compared whole */
+	with (char g[] = "interval=1", t[] = "inter=2") {
+		n = topt_add(opts, 0U, g);
+		n = topt_add(opts, n, t);
+		if (n != 2U) {
+			fail("key prefix replaced an option");
+		}
+	}
+	return rc;
+}
+
+/* topt-test.c ends here */
@@ -0,0 +1,106 @@
+/*** ttab-test.c -- round trips through topic tables
+ *
+ * Copyright (C) 2013-2015 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of blpcli.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "ttab.c"
+
+/* topics we make up */
+#define NTOP	(5000U)
+
+static int rc;
+
+static void
+fail(const char *msg)
+{
+	fprintf(stderr, "%s\n", msg);
+	rc = 1;
+	return;
+}
+
+int
+main(void)
+{
+	static char names[NTOP][32U];
+	static char *tops[NTOP];
+	size_t nput = 0U;
+	ttab_t tt;
+
+	for (size_t i = 0U; i < NTOP; i++) {
+		snprintf(names[i], sizeof(names[i]), "TOP%zu Equity", i);
+		tops[i] = names[i];
+	}
+	if ((tt = make_ttab(NTOP / 2U)) == NULL) {
+		perror("cannot make topic table");
+		return 1;
+	}
+	/* fill until the table refuses more */
+	for (; nput < NTOP && ttab_put(tt, tops, nput) == 0; nput++);
+	if (nput < NTOP / 2U) {
+		fail("table full before it reached its size");
+	} else if (nput == NTOP) {
+		fail("table never got full");
+	}
+	for (size_t i = 0U; i < NTOP; i++) {
+		const ssize_t k = ttab_get(tt, tops, tops[i]);
+
+		if (i < nput && k != (ssize_t)i) {
+			fprintf(stderr, "%s maps to %zd\n", tops[i], k);
+			rc = 1;
+		} else if (i >= nput && k >= 0) {
+			fprintf(stderr, "%s was never put\n", tops[i]);
+			rc = 1;
+		}
+	}
+	/* lookups go by content, not by pointer */
+	with (char tmp[32U]) {
+		strcpy(tmp, tops[7U]);
+		if (ttab_get(tt, tops, tmp) != 7) {
+			fail("lookup by copy failed");
+		}
+	}
+	if (ttab_get(tt, tops, "TOP7 Equit") >= 0) {
+		fail("prefix found");
+	}
+	free_ttab(tt);
+	return rc;
+}
+
+/* ttab-test.c ends here */